@@ -1,4 +1,5 @@
 #include "ShaderDefinitions.h"
+#include "VertexQuantization.hlsli"
 
 ///////////////////////////////////////////////////////////////////////////
 /////// VERTEX SHADER
@@ -23,7 +24,7 @@ VSOut VSMain(VSInput input) {
 #ifdef ALPHA_TEST
     output.texCoord = input.texCoord;
 #endif
-    output.pos = mul(g_ProjViewMatrix, mul(g_ModelMatrix, float4(input.pos, 1.0f)));
+    output.pos = mul(g_ProjViewMatrix, float4(mul(g_ModelMatrix, float4(DecodePosition(input.pos), 1.0f)), 1.0f));
     return output;
 }
 
@@ -1,4 +1,5 @@
 #include "ShaderDefinitions.h"
+#include "VertexQuantization.hlsli"
 #include "ShadowUtils.hlsli"
 #include "BRDF.hlsli"
 
@@ -8,7 +9,11 @@
 ///////////////////////////////////////////////////////////////////////////
 struct VSInput {
     float3 pos : POSITION;
+#ifdef QUANTIZED_VERTICES
+    float2 normal : NORMAL;
+#else
     float3 normal : NORMAL;
+#endif
     float2 texCoord : TEXCOORD;
 #ifdef NORMAL_MAPPING
     float4 tangent : TANGENT;
@@ -26,22 +31,24 @@ struct VSOut {
 };
 
 VSOut VSMain(VSInput input) {
-    float4 transformedPosition = mul(g_ProjViewMatrix, mul(g_ModelMatrix, float4(input.pos, 1.0f)));
+    float3 worldPos = mul(g_ModelMatrix, float4(DecodePosition(input.pos), 1.0f));
+    float4 transformedPosition = mul(g_ProjViewMatrix, float4(worldPos, 1.0f));
 
-    float3 normalVector = mul((float3x3) g_ModelMatrix, input.normal);
+    float3 normalVector = mul((float3x3) g_ModelMatrix, DecodeNormal(input.normal));
     normalVector = normalize(normalVector);
 
     VSOut vertexOut;
     vertexOut.normal = normalVector;
     vertexOut.pos = transformedPosition;
-    vertexOut.worldPos = (float3) mul(g_ModelMatrix, float4(input.pos, 1.0f));
+    vertexOut.worldPos = worldPos;
     vertexOut.texCoord = input.texCoord;
 
 #ifdef NORMAL_MAPPING
-    float3 tangentVector = mul((float3x3) g_ModelMatrix, input.tangent.xyz);
+    float4 tangent = DecodeTangent(input.tangent);
+    float3 tangentVector = mul((float3x3) g_ModelMatrix, tangent.xyz);
     tangentVector = normalize(tangentVector);
 
-    float3 bitangentVector = normalize(cross(normalVector, tangentVector) * input.tangent.w);
+    float3 bitangentVector = normalize(cross(normalVector, tangentVector) * tangent.w);
 
     float3x3 tbnMatrix = float3x3(tangentVector.x, bitangentVector.x, normalVector.x,
                                   tangentVector.y, bitangentVector.y, normalVector.y,
@@ -102,8 +109,9 @@ float4 PSMain(VSOut input) : SV_Target {
     }
 
 #ifdef NORMAL_MAPPING
-    float3 normalMap = g_NormalTexture.Sample(g_ObjectSampler, input.texCoord).xyz;
-    normalMap = normalMap * 2.0f - 1.0f;
+    // Normal maps are cooked to two channel BC5, z is reconstructed
+    float2 normalMapXY = g_NormalTexture.Sample(g_ObjectSampler, input.texCoord).xy * 2.0f - 1.0f;
+    float3 normalMap = float3(normalMapXY, sqrt(saturate(1.0f - dot(normalMapXY, normalMapXY))));
 
     float3 normalVector = normalize(normalMap);
     normalVector = normalize(mul(input.tbn, normalVector));
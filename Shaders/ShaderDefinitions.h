@@ -64,6 +64,7 @@
 #define SAMPLER_COMPARISON_STATE(name, slotNumber)
 #else
 #define Matrix4 row_major matrix
+#define Matrix3x4 row_major float3x4
 #define Vector4 float4
 #define Vector3 float3
 #define Vector2 float2
@@ -99,12 +100,16 @@ struct DrawMaterial {
 
 ///////////// Constant buffers
 CBUFFER(PerDrawGlobalConstantBuffer, PER_DRAW_CBUFFER_SLOT) {
-    Matrix4 g_ModelMatrix;
+    Matrix3x4 g_ModelMatrix;
 
     uint32_t g_PerDrawExtraData0; // Light index
     uint32_t g_PerDrawExtraData1;
     uint32_t g_PerDrawExtraData2;
     uint32_t g_PerDrawExtraData3;
+
+    // Dequantizes vertex positions, xyz are used
+    Vector4 g_PositionScale;
+    Vector4 g_PositionOffset;
 };
 
 CBUFFER(PerMaterialGlobalConstantBuffer, PER_MATERIAL_CBUFFER_SLOT) {
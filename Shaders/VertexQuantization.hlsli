@@ -0,0 +1,32 @@
+// Decoding of the vertex streams, they are quantized when QUANTIZED_VERTICES is defined. See ASSET_QUANTIZE_VERTICES.
+
+inline float3 DecodePosition(float3 position) {
+#ifdef QUANTIZED_VERTICES
+    return g_PositionOffset.xyz + position * g_PositionScale.xyz;
+#else
+    return position;
+#endif
+}
+
+#ifdef QUANTIZED_VERTICES
+// Octahedral coordinates in [-1, 1] to unit vector
+inline float3 DecodeNormal(float2 normal) {
+    float3 result = float3(normal.xy, 1.0f - abs(normal.x) - abs(normal.y));
+    float t = saturate(-result.z);
+    result.xy += result.xy >= 0.0f ? -t : t;
+    return normalize(result);
+}
+#else
+inline float3 DecodeNormal(float3 normal) {
+    return normal;
+}
+#endif
+
+// Quantized tangents are 10:10:10:2 unorm, bitangent sign in w
+inline float4 DecodeTangent(float4 tangent) {
+#ifdef QUANTIZED_VERTICES
+    return tangent * 2.0f - 1.0f;
+#else
+    return tangent;
+#endif
+}
@@ -0,0 +1,898 @@
+#include "pch.h"
+#include "ecs.h"
+#include "RHI.h"
+#include "AssetLoading.h"
+#include "AssetPackage.h"
+#include "Platform.h"
+#include "Jobs.h"
+#include "TextureCompression.h"
+#include "MeshOptimization.h"
+
+#define CGLTF_IMPLEMENTATION
+#include "cgltf.h"
+
+#define ASSET_VERTEX_STREAM_ALIGNMENT 16
+// Every LOD targets half the indices of the previous one, the error limit doubles from the base, relative to the mesh extent.
+// A LOD that doesn't remove enough of the previous one's indices isn't kept.
+#define ASSET_MESH_LOD_BASE_ERROR 0.01f
+#define ASSET_MESH_LOD_MAX_INDEX_RATIO 0.8f
+
+void GetAssetTextureMipLayout(u32 format, u32 width, u32 height, u32 mip, u32* outPitch, u64* outSize)
+{
+    u32 mipWidth = width >> mip ? width >> mip : 1;
+    u32 mipHeight = height >> mip ? height >> mip : 1;
+    u32 blockSize = GetBlockCompressedBlockSize(format);
+    if (blockSize)
+    {
+        // Pitch of a row of blocks
+        *outPitch = (mipWidth + 3) / 4 * blockSize;
+        *outSize = (u64) *outPitch * ((mipHeight + 3) / 4);
+        return;
+    }
+
+    ASSERT(format == FORMAT_R8G8B8A8_UNORM || format == FORMAT_R8G8B8A8_UNORM_SRGB, "Unsupported package texture format");
+    *outPitch = mipWidth * 4;
+    *outSize = (u64) mipWidth * 4 * mipHeight;
+}
+
+bool ComputeAssetPackageSourceKey(FileAPI* fileAPI, AssetPackageDependency* dependencies, u32 dependencyCount, u64* outKey)
+{
+    for (u32 dependencyIndex = 0; dependencyIndex < dependencyCount; ++dependencyIndex)
+    {
+        AssetPackageDependency* dependency = dependencies + dependencyIndex;
+        PlatformFileInfo fileInfo;
+        if (!fileAPI->GetFileInfo(dependency->path, &fileInfo))
+        {
+            return false;
+        }
+        dependency->size = fileInfo.size;
+        dependency->lastWriteTime = fileInfo.lastWriteTime;
+    }
+
+    *outKey = XXH64(dependencies, sizeof(AssetPackageDependency) * dependencyCount, ASSET_PACKAGE_VERSION);
+    return true;
+}
+
+// Appends a zero padded block to the package
+static u8* AllocPackageBlock(ILinearAllocator* allocator, const u8* package, u64 size, u64 alignment, u64* outOffset)
+{
+    u64 offset = allocator->instance->startOffset - (u64) (package - allocator->instance->pointer);
+    u64 alignedOffset = (offset + alignment - 1) & ~(alignment - 1);
+    u8* block = (u8*) allocator->Alloc(allocator->instance, alignedOffset - offset + size) + (alignedOffset - offset);
+    memset(block - (alignedOffset - offset), 0, alignedOffset - offset + size);
+    *outOffset = alignedOffset;
+    return block;
+}
+
+static void WritePackageIndices(u8* destination, const u32* indices, u32 indexCount, u32 indexStride)
+{
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        if (indexStride == 2)
+        {
+            ((u16*) destination)[index] = (u16) indices[index];
+        }
+        else
+        {
+            ((u32*) destination)[index] = indices[index];
+        }
+    }
+}
+
+static AABB LoadAccessorBounds(const cgltf_accessor* accessor)
+{
+    if (accessor->has_min && accessor->has_max)
+    {
+        return AABBFromMinMax(Vector3(accessor->min[0], accessor->min[1], accessor->min[2]),
+                              Vector3(accessor->max[0], accessor->max[1], accessor->max[2]));
+    }
+
+    // min/max are required for positions by the spec but not every exporter writes them
+    Vector3 minPoint = Vector3(F32Max);
+    Vector3 maxPoint = Vector3(-F32Max);
+    for (cgltf_size index = 0; index < accessor->count; ++index)
+    {
+        f32 position[3];
+        cgltf_accessor_read_float(accessor, index, position, 3);
+        minPoint = Vector3(fminf(minPoint.x, position[0]), fminf(minPoint.y, position[1]), fminf(minPoint.z, position[2]));
+        maxPoint = Vector3(fmaxf(maxPoint.x, position[0]), fmaxf(maxPoint.y, position[1]), fmaxf(maxPoint.z, position[2]));
+    }
+
+    return AABBFromMinMax(minPoint, maxPoint);
+}
+
+#if ASSET_QUANTIZE_VERTICES
+static const u32 gVertexStreamStrides[VERTEX_BUFFER_COUNT] = { 8, 4, 4, 4 };
+
+static i16 QuantizeSnorm16(f32 value)
+{
+    value = fminf(fmaxf(value, -1.0f), 1.0f);
+    return (i16) lrintf(value * 32767.0f);
+}
+
+// Rounds to nearest even, values out of the half range are clamped to the largest half
+static u16 FloatToHalf(f32 value)
+{
+    u32 bits;
+    memcpy(&bits, &value, sizeof(u32));
+    u16 sign = (u16) ((bits >> 16) & 0x8000);
+    u32 absBits = bits & 0x7FFFFFFF;
+    if (absBits > 0x7F800000)
+    {
+        return sign | 0x7E00;
+    }
+    if (absBits >= 0x477FF000)
+    {
+        return sign | 0x7BFF;
+    }
+    if (absBits < 0x38800000)
+    {
+        // Subnormal, in units of 2^-24
+        return sign | (u16) lrintf(fabsf(value) * 16777216.0f);
+    }
+
+    u32 half = (absBits - 0x38000000) >> 13;
+    u32 remainder = absBits & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return sign | (u16) half;
+}
+
+// Unit vector to octahedral coordinates in [-1, 1]
+static void OctahedralEncode(const f32* normal, f32* outX, f32* outY)
+{
+    f32 sum = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    f32 x = sum > 0.0f ? normal[0] / sum : 0.0f;
+    f32 y = sum > 0.0f ? normal[1] / sum : 0.0f;
+    if (normal[2] < 0.0f)
+    {
+        f32 foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        f32 foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    *outX = x;
+    *outY = y;
+}
+
+static void EncodeVertex(u32 stream, const f32* source, const AssetPackageMesh* mesh, u8* destination)
+{
+    switch (stream)
+    {
+        case VERTEX_BUFFER_POSITIONS:
+        {
+            i16* position = (i16*) destination;
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                f32 scale = (&mesh->positionScale.x)[axis];
+                f32 offset = (&mesh->positionOffset.x)[axis];
+                position[axis] = QuantizeSnorm16(scale > 0.0f ? (source[axis] - offset) / scale : 0.0f);
+            }
+            position[3] = 0;
+            break;
+        }
+        case VERTEX_BUFFER_NORMAL:
+        {
+            f32 x, y;
+            OctahedralEncode(source, &x, &y);
+            i16* normal = (i16*) destination;
+            normal[0] = QuantizeSnorm16(x);
+            normal[1] = QuantizeSnorm16(y);
+            break;
+        }
+        case VERTEX_BUFFER_TEXCOORD:
+        {
+            u16* texCoord = (u16*) destination;
+            texCoord[0] = FloatToHalf(source[0]);
+            texCoord[1] = FloatToHalf(source[1]);
+            break;
+        }
+        case VERTEX_BUFFER_TANGENT:
+        {
+            // xyz as unorm of v * 0.5 + 0.5, bitangent sign in w
+            u32 packed = 0;
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                f32 value = fminf(fmaxf(source[axis] * 0.5f + 0.5f, 0.0f), 1.0f);
+                packed |= (u32) lrintf(value * 1023.0f) << (axis * 10);
+            }
+            packed |= (source[3] < 0.0f ? 0u : 3u) << 30;
+            memcpy(destination, &packed, sizeof(u32));
+            break;
+        }
+    }
+}
+#else
+static const u32 gVertexStreamStrides[VERTEX_BUFFER_COUNT] = { 12, 12, 8, 16 };
+
+static void EncodeVertex(u32 stream, const f32* source, const AssetPackageMesh* mesh, u8* destination)
+{
+    memcpy(destination, source, gVertexStreamStrides[stream]);
+}
+#endif
+
+// glTF and buffer files are read through file mappings, so buffer data is used from the page cache without copying it
+#define ASSET_COOK_MAX_MAPPED_FILES 64
+
+struct CookFileMappings
+{
+    FileAPI* fileAPI;
+    PlatformMappedFile files[ASSET_COOK_MAX_MAPPED_FILES];
+    u32 fileCount;
+};
+
+static cgltf_result MapGLTFFile(const cgltf_memory_options* memoryOptions, const cgltf_file_options* fileOptions, const char* path, cgltf_size* size, void** data)
+{
+    CookFileMappings* mappings = (CookFileMappings*) fileOptions->user_data;
+    ASSERT(mappings->fileCount < ASSET_COOK_MAX_MAPPED_FILES, "Too many glTF files are mapped");
+
+    PlatformMappedFile file;
+    if (!mappings->fileAPI->MapFile(path, &file))
+    {
+        return cgltf_result_file_not_found;
+    }
+
+    // Size is the expected buffer size for buffer files
+    if (*size && file.size < *size)
+    {
+        mappings->fileAPI->UnmapFile(&file);
+        return cgltf_result_io_error;
+    }
+
+    mappings->files[mappings->fileCount++] = file;
+    *size = *size ? *size : file.size;
+    *data = (void*) file.data;
+    return cgltf_result_success;
+}
+
+static void UnmapGLTFFile(const cgltf_memory_options* memoryOptions, const cgltf_file_options* fileOptions, void* data)
+{
+    CookFileMappings* mappings = (CookFileMappings*) fileOptions->user_data;
+    for (u32 fileIndex = 0; fileIndex < mappings->fileCount; ++fileIndex)
+    {
+        if (mappings->files[fileIndex].data == data)
+        {
+            mappings->fileAPI->UnmapFile(mappings->files + fileIndex);
+            mappings->files[fileIndex] = mappings->files[--mappings->fileCount];
+            return;
+        }
+    }
+}
+
+// Picks the compression format of an image, an image used for more than one purpose gets the highest usage
+enum ImageUsage
+{
+    IMAGE_USAGE_COLOR,
+    IMAGE_USAGE_DATA,
+    IMAGE_USAGE_NORMAL_MAP
+};
+
+// Images are decoded, mipped and compressed on job workers while the meshes are cooked
+struct ImageCookJob
+{
+    const char* path;
+    FileAPI* fileAPI;
+    ImageUsage usage;
+
+    u8* mipChain;
+    u64 mipChainSize;
+    u32 width;
+    u32 height;
+    u32 mipCount;
+    u32 format;
+};
+
+static u32 GetFullMipCount(u32 width, u32 height)
+{
+    u32 mipCount = 1;
+    while (width > 1 || height > 1)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        mipCount++;
+    }
+    return mipCount;
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes
+static void DownsampleMip(const u8* source, u32 sourceWidth, u32 sourceHeight, u8* destination, u32 width, u32 height)
+{
+    for (u32 y = 0; y < height; ++y)
+    {
+        const u8* row0 = source + (u64) (2 * y < sourceHeight ? 2 * y : sourceHeight - 1) * sourceWidth * 4;
+        const u8* row1 = source + (u64) (2 * y + 1 < sourceHeight ? 2 * y + 1 : sourceHeight - 1) * sourceWidth * 4;
+        u32 x = 0;
+#if defined(MATH_SIMD_SSE)
+        // Two destination pixels from four source pixels of both rows at a time, channels are summed in 16 bits
+        if (2 * y + 1 < sourceHeight)
+        {
+            __m128i zero = _mm_setzero_si128();
+            __m128i rounding = _mm_set1_epi16(2);
+            for (; 2 * x + 3 < sourceWidth && x + 1 < width; x += 2)
+            {
+                __m128i top = _mm_loadu_si128((const __m128i*) (row0 + x * 8));
+                __m128i bottom = _mm_loadu_si128((const __m128i*) (row1 + x * 8));
+                __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+                __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+                left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+                right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+                __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(left, right), rounding), 2);
+                _mm_storel_epi64((__m128i*) (destination + ((u64) y * width + x) * 4), _mm_packus_epi16(sum, zero));
+            }
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            u32 x0 = (2 * x < sourceWidth ? 2 * x : sourceWidth - 1) * 4;
+            u32 x1 = (2 * x + 1 < sourceWidth ? 2 * x + 1 : sourceWidth - 1) * 4;
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                u32 sum = row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel];
+                destination[((u64) y * width + x) * 4 + channel] = (u8) ((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+static void CookGLTFImage(void* userData)
+{
+    ImageCookJob* job = (ImageCookJob*) userData;
+
+    i32 width = 0;
+    i32 height = 0;
+    i32 comp = 0;
+    PlatformMappedFile file;
+    if (!job->fileAPI->MapFile(job->path, &file))
+    {
+        return;
+    }
+    u8* pixels = stbi_load_from_memory(file.data, (i32) file.size, &width, &height, &comp, 4);
+    job->fileAPI->UnmapFile(&file);
+    if (!pixels)
+    {
+        return;
+    }
+
+    job->width = (u32) width;
+    job->height = (u32) height;
+    job->mipCount = GetFullMipCount(job->width, job->height);
+
+    // Block compressed textures need block aligned top mips
+    job->format = FORMAT_R8G8B8A8_UNORM;
+    if (job->width % 4 == 0 && job->height % 4 == 0)
+    {
+        switch (job->usage)
+        {
+            case IMAGE_USAGE_COLOR:
+            {
+                bool opaque = true;
+                for (u64 pixel = 0; pixel < (u64) width * height && opaque; ++pixel)
+                {
+                    opaque = pixels[pixel * 4 + 3] == 255;
+                }
+                job->format = opaque ? FORMAT_BC1_UNORM : FORMAT_BC3_UNORM;
+            } break;
+            case IMAGE_USAGE_DATA:
+            {
+                // Channels of packed data textures are unrelated, which BC1 endpoints can't represent well
+                job->format = FORMAT_BC7_UNORM;
+            } break;
+            case IMAGE_USAGE_NORMAL_MAP:
+            {
+                // Z is reconstructed in the shaders
+                job->format = FORMAT_BC5_UNORM;
+            } break;
+        }
+    }
+
+    u64 uncompressedSize = 0;
+    job->mipChainSize = 0;
+    for (u32 mip = 0; mip < job->mipCount; ++mip)
+    {
+        u32 pitch;
+        u64 mipSize;
+        GetAssetTextureMipLayout(FORMAT_R8G8B8A8_UNORM, job->width, job->height, mip, &pitch, &mipSize);
+        uncompressedSize += mipSize;
+        GetAssetTextureMipLayout(job->format, job->width, job->height, mip, &pitch, &mipSize);
+        job->mipChainSize += mipSize;
+    }
+
+    u8* uncompressedMipChain = (u8*) malloc(uncompressedSize);
+    u8* mipData = uncompressedMipChain;
+    memcpy(mipData, pixels, (u64) width * height * 4);
+    stbi_image_free(pixels);
+
+    u32 mipWidth = job->width;
+    u32 mipHeight = job->height;
+    for (u32 mip = 1; mip < job->mipCount; ++mip)
+    {
+        u32 nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        u32 nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+        u8* nextMipData = mipData + (u64) mipWidth * mipHeight * 4;
+        DownsampleMip(mipData, mipWidth, mipHeight, nextMipData, nextWidth, nextHeight);
+        mipData = nextMipData;
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    if (job->format == FORMAT_R8G8B8A8_UNORM)
+    {
+        job->mipChain = uncompressedMipChain;
+        return;
+    }
+
+    job->mipChain = (u8*) malloc(job->mipChainSize);
+    mipData = uncompressedMipChain;
+    u8* compressedMipData = job->mipChain;
+    for (u32 mip = 0; mip < job->mipCount; ++mip)
+    {
+        u32 pitch;
+        u64 mipSize;
+        mipWidth = job->width >> mip ? job->width >> mip : 1;
+        mipHeight = job->height >> mip ? job->height >> mip : 1;
+        CompressTextureMip(mipData, mipWidth, mipHeight, job->format, compressedMipData);
+        GetAssetTextureMipLayout(job->format, job->width, job->height, mip, &pitch, &mipSize);
+        compressedMipData += mipSize;
+        mipData += (u64) mipWidth * mipHeight * 4;
+    }
+    free(uncompressedMipChain);
+}
+
+static u32 GetTextureImageIndex(const cgltf_data* data, const cgltf_texture_view* textureView)
+{
+    if (!textureView->texture || !textureView->texture->image)
+    {
+        return NULL_INDEX;
+    }
+    return (u32) (textureView->texture->image - data->images);
+}
+
+static void SetDependencyPath(AssetPackageDependency* dependency, const char* directory, const char* uri)
+{
+    TempAllocator tempAllocator;
+    const char* path = directory ? tempAllocator.Printf("%s/%s", directory, uri) : uri;
+    ASSERT(strlen(path) < ASSET_PACKAGE_PATH_LENGTH, "Asset path is too long for the package");
+    strcpy(dependency->path, path);
+}
+
+// Waits for the image jobs of a failed cook and frees what they decoded
+static void DiscardImageJobs(JobAPI* jobAPI, JobCounter* counter, ImageCookJob* jobs, u32 jobCount)
+{
+    jobAPI->WaitForCounter(counter);
+    for (u32 jobIndex = 0; jobIndex < jobCount; ++jobIndex)
+    {
+        free(jobs[jobIndex].mipChain);
+    }
+    free(jobs);
+}
+
+void* CookGLTFFile(const char* filepath, JobAPI* jobAPI, FileAPI* fileAPI, ILinearAllocator* allocator, u64* outSize)
+{
+    char fileDirectory[ASSET_PACKAGE_PATH_LENGTH];
+    ASSERT(strlen(filepath) < ASSET_PACKAGE_PATH_LENGTH, "Asset path is too long for the package");
+    strcpy(fileDirectory, filepath);
+    PathRemoveFilename(fileDirectory);
+
+    CookFileMappings mappings = {};
+    mappings.fileAPI = fileAPI;
+    cgltf_options options = {};
+    options.file.read = MapGLTFFile;
+    options.file.release = UnmapGLTFFile;
+    options.file.user_data = &mappings;
+    cgltf_data* data = NULL;
+    cgltf_result result = cgltf_parse_file(&options, filepath, &data);
+    if (result != cgltf_result_success)
+    {
+        return nullptr;
+    }
+
+    // Start decoding images, buffers are loaded and meshes are cooked while they are decoded
+    u32 imageCount = (u32) data->images_count;
+    ImageCookJob* imageJobs = (ImageCookJob*) malloc(sizeof(ImageCookJob) * imageCount);
+    JobDecl* imageJobDecls = (JobDecl*) malloc(sizeof(JobDecl) * imageCount);
+    AssetPackageDependency* imageDependencies = (AssetPackageDependency*) malloc(sizeof(AssetPackageDependency) * imageCount);
+    for (u32 imageIndex = 0; imageIndex < imageCount; ++imageIndex)
+    {
+        ASSERT(data->images[imageIndex].uri, "Only images with uris are supported");
+        imageDependencies[imageIndex] = {};
+        SetDependencyPath(imageDependencies + imageIndex, fileDirectory, data->images[imageIndex].uri);
+        imageJobs[imageIndex] = {};
+        imageJobs[imageIndex].path = imageDependencies[imageIndex].path;
+        imageJobs[imageIndex].fileAPI = fileAPI;
+        imageJobs[imageIndex].usage = IMAGE_USAGE_COLOR;
+        imageJobDecls[imageIndex] = JobDecl { CookGLTFImage, imageJobs + imageIndex };
+    }
+    for (u32 materialIndex = 0; materialIndex < data->materials_count; ++materialIndex)
+    {
+        const cgltf_material* gltfMaterial = data->materials + materialIndex;
+        u32 dataImages[2] = { GetTextureImageIndex(data, &gltfMaterial->pbr_metallic_roughness.metallic_roughness_texture),
+                              GetTextureImageIndex(data, &gltfMaterial->occlusion_texture) };
+        for (u32 dataImage = 0; dataImage < 2; ++dataImage)
+        {
+            if (dataImages[dataImage] != NULL_INDEX && imageJobs[dataImages[dataImage]].usage < IMAGE_USAGE_DATA)
+            {
+                imageJobs[dataImages[dataImage]].usage = IMAGE_USAGE_DATA;
+            }
+        }
+
+        u32 normalImage = GetTextureImageIndex(data, &gltfMaterial->normal_texture);
+        if (normalImage != NULL_INDEX)
+        {
+            imageJobs[normalImage].usage = IMAGE_USAGE_NORMAL_MAP;
+        }
+    }
+    JobCounter imageCounter = {};
+    jobAPI->RunJobs(imageJobDecls, imageCount, &imageCounter);
+    free(imageJobDecls);
+
+    result = cgltf_load_buffers(&options, data, filepath);
+    if (result != cgltf_result_success)
+    {
+        DiscardImageJobs(jobAPI, &imageCounter, imageJobs, imageCount);
+        free(imageDependencies);
+        // Unmaps the buffers that were loaded
+        cgltf_free(data);
+        return nullptr;
+    }
+
+    u32 externalBufferCount = 0;
+    for (u32 bufferIndex = 0; bufferIndex < data->buffers_count; ++bufferIndex)
+    {
+        const char* uri = data->buffers[bufferIndex].uri;
+        externalBufferCount += uri && strncmp(uri, "data:", 5) != 0;
+    }
+
+    // Primitives of a glTF mesh are consecutive package meshes
+    u32* firstMeshOfGltfMesh = (u32*) malloc(sizeof(u32) * (data->meshes_count + 1));
+    u32 meshCount = 0;
+    for (u32 gltfMeshIndex = 0; gltfMeshIndex < data->meshes_count; ++gltfMeshIndex)
+    {
+        firstMeshOfGltfMesh[gltfMeshIndex] = meshCount;
+        meshCount += (u32) data->meshes[gltfMeshIndex].primitives_count;
+    }
+
+    u32 childNodeCount = 0;
+    for (u32 nodeIndex = 0; nodeIndex < data->nodes_count; ++nodeIndex)
+    {
+        childNodeCount += (u32) data->nodes[nodeIndex].children_count;
+    }
+
+    const cgltf_scene* gltfScene = data->scene ? data->scene : (data->scenes_count ? data->scenes : nullptr);
+    u32 rootNodeCount = gltfScene ? (u32) gltfScene->nodes_count : 0;
+
+    u32 dependencyCount = 1 + externalBufferCount + imageCount;
+    u64 tablesSize = sizeof(AssetPackageHeader) + sizeof(AssetPackageDependency) * dependencyCount + sizeof(AssetPackageTexture) * imageCount +
+                     sizeof(AssetPackageMaterial) * data->materials_count + sizeof(AssetPackageMesh) * meshCount +
+                     sizeof(AssetPackageNode) * data->nodes_count + sizeof(u32) * (rootNodeCount + childNodeCount);
+    u8* package = (u8*) allocator->Alloc(allocator->instance, tablesSize);
+    memset(package, 0, tablesSize);
+
+    AssetPackageHeader* header = (AssetPackageHeader*) package;
+    header->magic = ASSET_PACKAGE_MAGIC;
+    header->version = ASSET_PACKAGE_VERSION;
+    header->dependencyCount = dependencyCount;
+    header->textureCount = imageCount;
+    header->materialCount = (u32) data->materials_count;
+    header->meshCount = meshCount;
+    header->nodeCount = (u32) data->nodes_count;
+    header->rootNodeCount = rootNodeCount;
+    header->childNodeCount = childNodeCount;
+
+    AssetPackageDependency* dependencies = (AssetPackageDependency*) (header + 1);
+    AssetPackageTexture* textures = (AssetPackageTexture*) (dependencies + dependencyCount);
+    AssetPackageMaterial* materials = (AssetPackageMaterial*) (textures + imageCount);
+    AssetPackageMesh* meshes = (AssetPackageMesh*) (materials + data->materials_count);
+    AssetPackageNode* nodes = (AssetPackageNode*) (meshes + meshCount);
+    u32* rootNodes = (u32*) (nodes + data->nodes_count);
+    u32* childNodes = rootNodes + rootNodeCount;
+
+    // Dependencies
+    u32 dependencyIndex = 0;
+    SetDependencyPath(dependencies + dependencyIndex++, nullptr, filepath);
+    for (u32 bufferIndex = 0; bufferIndex < data->buffers_count; ++bufferIndex)
+    {
+        const char* uri = data->buffers[bufferIndex].uri;
+        if (uri && strncmp(uri, "data:", 5) != 0)
+        {
+            SetDependencyPath(dependencies + dependencyIndex++, fileDirectory, uri);
+        }
+    }
+    memcpy(dependencies + dependencyIndex, imageDependencies, sizeof(AssetPackageDependency) * imageCount);
+    bool dependenciesExist = ComputeAssetPackageSourceKey(fileAPI, dependencies, dependencyCount, &header->sourceKey);
+    ASSERT(dependenciesExist, "Asset dependency is missing");
+
+    // Materials
+    for (u32 materialIndex = 0; materialIndex < data->materials_count; ++materialIndex)
+    {
+        const cgltf_material* gltfMaterial = data->materials + materialIndex;
+        const cgltf_pbr_metallic_roughness* pbr = &gltfMaterial->pbr_metallic_roughness;
+        AssetPackageMaterial* material = materials + materialIndex;
+
+        material->baseColor = Vector4(pbr->base_color_factor[0], pbr->base_color_factor[1], pbr->base_color_factor[2], pbr->base_color_factor[3]);
+        material->emissiveColor = Vector4(gltfMaterial->emissive_factor[0], gltfMaterial->emissive_factor[1], gltfMaterial->emissive_factor[2], 1.0f);
+        material->roughness = pbr->roughness_factor;
+        material->metallic = pbr->metallic_factor;
+        for (u32 textureIndex = 0; textureIndex < ASSET_MATERIAL_TEXTURE_COUNT; ++textureIndex)
+        {
+            material->textures[textureIndex] = NULL_INDEX;
+        }
+        material->textures[ASSET_MATERIAL_TEXTURE_BASE_COLOR] = GetTextureImageIndex(data, &pbr->base_color_texture);
+        material->textures[ASSET_MATERIAL_TEXTURE_ROUGHNESS_METALLIC] = GetTextureImageIndex(data, &pbr->metallic_roughness_texture);
+        material->textures[ASSET_MATERIAL_TEXTURE_OCCLUSION] = GetTextureImageIndex(data, &gltfMaterial->occlusion_texture);
+        material->textures[ASSET_MATERIAL_TEXTURE_NORMAL_MAP] = GetTextureImageIndex(data, &gltfMaterial->normal_texture);
+        material->textures[ASSET_MATERIAL_TEXTURE_EMISSIVE] = GetTextureImageIndex(data, &gltfMaterial->emissive_texture);
+    }
+
+    // Indices are optimized for the vertex cache and overdraw, grouped into meshlets and LODs are simplified from them,
+    // then vertices are reordered by first use.
+    // Non indexed primitives get sequential indices first.
+    u32** meshIndices = (u32**) malloc(sizeof(u32*) * meshCount);
+    u32** meshVertexRemaps = (u32**) malloc(sizeof(u32*) * meshCount);
+    u32** meshLodIndices = (u32**) malloc(sizeof(u32*) * meshCount * MESH_MAX_LOD_COUNT);
+    Meshlet** meshMeshlets = (Meshlet**) malloc(sizeof(Meshlet*) * meshCount);
+    const cgltf_accessor** meshStreams = (const cgltf_accessor**) malloc(sizeof(cgltf_accessor*) * meshCount * VERTEX_BUFFER_COUNT);
+    for (u32 gltfMeshIndex = 0; gltfMeshIndex < data->meshes_count; ++gltfMeshIndex)
+    {
+        const cgltf_mesh* gltfMesh = data->meshes + gltfMeshIndex;
+        for (u32 primitiveIndex = 0; primitiveIndex < gltfMesh->primitives_count; ++primitiveIndex)
+        {
+            const cgltf_primitive* primitive = gltfMesh->primitives + primitiveIndex;
+            u32 meshIndex = firstMeshOfGltfMesh[gltfMeshIndex] + primitiveIndex;
+            AssetPackageMesh* mesh = meshes + meshIndex;
+            mesh->materialIndex = primitive->material ? (u32) (primitive->material - data->materials) : 0;
+            ASSERT(primitive->type == cgltf_primitive_type_triangles, "Only triangle lists are supported");
+
+            const cgltf_accessor** streams = meshStreams + meshIndex * VERTEX_BUFFER_COUNT;
+            memset(streams, 0, sizeof(cgltf_accessor*) * VERTEX_BUFFER_COUNT);
+            for (u32 attributeIndex = 0; attributeIndex < primitive->attributes_count; ++attributeIndex)
+            {
+                const cgltf_attribute* attribute = primitive->attributes + attributeIndex;
+                switch (attribute->type)
+                {
+                    case cgltf_attribute_type_position: streams[VERTEX_BUFFER_POSITIONS] = attribute->data; break;
+                    case cgltf_attribute_type_normal: streams[VERTEX_BUFFER_NORMAL] = attribute->data; break;
+                    case cgltf_attribute_type_texcoord: streams[VERTEX_BUFFER_TEXCOORD] = attribute->index == 0 ? attribute->data : streams[VERTEX_BUFFER_TEXCOORD]; break;
+                    case cgltf_attribute_type_tangent: streams[VERTEX_BUFFER_TANGENT] = attribute->data; break;
+                    default: break;
+                }
+            }
+
+            ASSERT(streams[VERTEX_BUFFER_POSITIONS], "Primitive doesn't have positions");
+            u32 sourceVertexCount = (u32) streams[VERTEX_BUFFER_POSITIONS]->count;
+            mesh->bounds = LoadAccessorBounds(streams[VERTEX_BUFFER_POSITIONS]);
+#if ASSET_QUANTIZE_VERTICES
+            mesh->positionScale = mesh->bounds.extents;
+            mesh->positionOffset = mesh->bounds.center;
+#else
+            mesh->positionScale = Vector3(1.0f, 1.0f, 1.0f);
+            mesh->positionOffset = Vector3(0.0f, 0.0f, 0.0f);
+#endif
+
+            const cgltf_accessor* indices = primitive->indices;
+            mesh->indexCount = indices ? (u32) indices->count : sourceVertexCount;
+            u32* optimizedIndices = (u32*) malloc(sizeof(u32) * mesh->indexCount);
+            for (u32 index = 0; index < mesh->indexCount; ++index)
+            {
+                optimizedIndices[index] = indices ? (u32) cgltf_accessor_read_index(indices, index) : index;
+            }
+
+            f32* positions = (f32*) malloc(sizeof(f32) * 3 * sourceVertexCount);
+            cgltf_accessor_unpack_floats(streams[VERTEX_BUFFER_POSITIONS], positions, (cgltf_size) sourceVertexCount * 3);
+            OptimizeVertexCache(optimizedIndices, mesh->indexCount, sourceVertexCount);
+            OptimizeOverdraw(optimizedIndices, mesh->indexCount, positions, sourceVertexCount);
+            Meshlet* meshlets = (Meshlet*) malloc(sizeof(Meshlet) * (mesh->indexCount / 3));
+            mesh->meshletCount = BuildMeshlets(optimizedIndices, mesh->indexCount, positions, sourceVertexCount, meshlets);
+            meshMeshlets[meshIndex] = meshlets;
+
+            // Every LOD is simplified from the previous one, so their errors add up
+            u32** lodIndices = meshLodIndices + meshIndex * MESH_MAX_LOD_COUNT;
+            const u32* previousIndices = optimizedIndices;
+            u32 previousIndexCount = mesh->indexCount;
+            f32 error = 0.0f;
+            for (u32 lod = 0; lod < MESH_MAX_LOD_COUNT; ++lod)
+            {
+                u32* simplifiedIndices = (u32*) malloc(sizeof(u32) * previousIndexCount);
+                f32 simplifyError;
+                u32 simplifiedIndexCount = SimplifyMesh(simplifiedIndices, previousIndices, previousIndexCount, positions, sourceVertexCount,
+                                                        previousIndexCount / 2, ASSET_MESH_LOD_BASE_ERROR * (1 << lod), &simplifyError);
+                if (simplifiedIndexCount == 0 || simplifiedIndexCount > previousIndexCount * ASSET_MESH_LOD_MAX_INDEX_RATIO)
+                {
+                    free(simplifiedIndices);
+                    break;
+                }
+
+                OptimizeVertexCache(simplifiedIndices, simplifiedIndexCount, sourceVertexCount);
+                error += simplifyError;
+                mesh->lods[lod].indexCount = simplifiedIndexCount;
+                mesh->lods[lod].error = error;
+                mesh->lodCount++;
+                lodIndices[lod] = simplifiedIndices;
+                previousIndices = simplifiedIndices;
+                previousIndexCount = simplifiedIndexCount;
+            }
+            free(positions);
+
+            // LODs use a subset of the full mesh's vertices
+            u32* remap = (u32*) malloc(sizeof(u32) * sourceVertexCount);
+            mesh->vertexCount = OptimizeVertexFetch(optimizedIndices, mesh->indexCount, sourceVertexCount, remap);
+            for (u32 lod = 0; lod < mesh->lodCount; ++lod)
+            {
+                for (u32 index = 0; index < mesh->lods[lod].indexCount; ++index)
+                {
+                    lodIndices[lod][index] = remap[lodIndices[lod][index]];
+                }
+            }
+            meshVertexRemaps[meshIndex] = remap;
+            meshIndices[meshIndex] = optimizedIndices;
+        }
+    }
+
+    // Vertex streams are unpacked to floats, whatever the source layout is, and written in the ASSET_VERTEX_*_FORMATs
+    AllocPackageBlock(allocator, package, 0, ASSET_PACKAGE_ALIGNMENT, &header->vertexDataOffset);
+#if ASSET_QUANTIZE_VERTICES
+    header->flags |= ASSET_PACKAGE_FLAG_QUANTIZED_VERTICES;
+#endif
+    const u32 streamComponentCounts[VERTEX_BUFFER_COUNT] = { 3, 3, 2, 4 };
+    for (u32 meshIndex = 0; meshIndex < meshCount; ++meshIndex)
+    {
+        AssetPackageMesh* mesh = meshes + meshIndex;
+        const cgltf_accessor** streams = meshStreams + meshIndex * VERTEX_BUFFER_COUNT;
+        u32 sourceVertexCount = (u32) streams[VERTEX_BUFFER_POSITIONS]->count;
+        const u32* remap = meshVertexRemaps[meshIndex];
+        for (u32 stream = 0; stream < VERTEX_BUFFER_COUNT; ++stream)
+        {
+            const cgltf_accessor* accessor = streams[stream];
+            if (!accessor)
+            {
+                continue;
+            }
+
+            u32 componentCount = streamComponentCounts[stream];
+            ASSERT(cgltf_num_components(accessor->type) == componentCount && accessor->count == sourceVertexCount, "Unsupported vertex attribute");
+            f32* sourceData = (f32*) malloc(sizeof(f32) * componentCount * sourceVertexCount);
+            cgltf_accessor_unpack_floats(accessor, sourceData, (cgltf_size) componentCount * sourceVertexCount);
+
+            u32 stride = gVertexStreamStrides[stream];
+            u64 streamOffset;
+            u8* streamData = AllocPackageBlock(allocator, package, (u64) mesh->vertexCount * stride, ASSET_VERTEX_STREAM_ALIGNMENT, &streamOffset);
+            for (u32 vertex = 0; vertex < sourceVertexCount; ++vertex)
+            {
+                if (remap[vertex] != NULL_INDEX)
+                {
+                    EncodeVertex(stream, sourceData + (u64) vertex * componentCount, mesh, streamData + (u64) remap[vertex] * stride);
+                }
+            }
+            free(sourceData);
+
+            mesh->vertexOffsets[stream] = (u32) (streamOffset - header->vertexDataOffset);
+            mesh->vertexStrides[stream] = stride;
+        }
+        free(meshVertexRemaps[meshIndex]);
+    }
+    free(meshVertexRemaps);
+    free(meshStreams);
+    header->vertexDataSize = allocator->instance->startOffset - (u64) (package - allocator->instance->pointer) - header->vertexDataOffset;
+    ASSERT(header->vertexDataSize <= U32Max, "Vertex data is too big for 32 bit offsets");
+
+    // 16 bit indices where the vertices fit, LODs follow the full mesh
+    AllocPackageBlock(allocator, package, 0, ASSET_PACKAGE_ALIGNMENT, &header->indexDataOffset);
+    for (u32 meshIndex = 0; meshIndex < meshCount; ++meshIndex)
+    {
+        AssetPackageMesh* mesh = meshes + meshIndex;
+        mesh->indexStride = mesh->vertexCount <= U16Max ? 2 : 4;
+
+        u32 totalIndexCount = mesh->indexCount;
+        for (u32 lod = 0; lod < mesh->lodCount; ++lod)
+        {
+            totalIndexCount += mesh->lods[lod].indexCount;
+        }
+
+        u64 indexOffset;
+        u8* indexData = AllocPackageBlock(allocator, package, (u64) totalIndexCount * mesh->indexStride, 4, &indexOffset);
+        mesh->indexOffset = (u32) (indexOffset - header->indexDataOffset);
+        WritePackageIndices(indexData, meshIndices[meshIndex], mesh->indexCount, mesh->indexStride);
+        free(meshIndices[meshIndex]);
+
+        u32 lodIndexOffset = mesh->indexOffset + mesh->indexCount * mesh->indexStride;
+        for (u32 lod = 0; lod < mesh->lodCount; ++lod)
+        {
+            u32* lodIndices = meshLodIndices[meshIndex * MESH_MAX_LOD_COUNT + lod];
+            mesh->lods[lod].indexOffset = lodIndexOffset;
+            WritePackageIndices(indexData + (lodIndexOffset - mesh->indexOffset), lodIndices, mesh->lods[lod].indexCount, mesh->indexStride);
+            lodIndexOffset += mesh->lods[lod].indexCount * mesh->indexStride;
+            free(lodIndices);
+        }
+    }
+    free(meshIndices);
+    free(meshLodIndices);
+    header->indexDataSize = allocator->instance->startOffset - (u64) (package - allocator->instance->pointer) - header->indexDataOffset;
+
+    // Meshlets of every mesh in one table
+    u32 meshletCount = 0;
+    for (u32 meshIndex = 0; meshIndex < meshCount; ++meshIndex)
+    {
+        meshes[meshIndex].firstMeshlet = meshletCount;
+        meshletCount += meshes[meshIndex].meshletCount;
+    }
+    header->meshletDataSize = sizeof(Meshlet) * meshletCount;
+    Meshlet* meshletData = (Meshlet*) AllocPackageBlock(allocator, package, header->meshletDataSize, ASSET_PACKAGE_ALIGNMENT, &header->meshletDataOffset);
+    for (u32 meshIndex = 0; meshIndex < meshCount; ++meshIndex)
+    {
+        memcpy(meshletData + meshes[meshIndex].firstMeshlet, meshMeshlets[meshIndex], sizeof(Meshlet) * meshes[meshIndex].meshletCount);
+        free(meshMeshlets[meshIndex]);
+    }
+    free(meshMeshlets);
+
+    // Nodes
+    for (u32 nodeIndex = 0; nodeIndex < data->nodes_count; ++nodeIndex)
+    {
+        const cgltf_node* gltfNode = data->nodes + nodeIndex;
+        AssetPackageNode* node = nodes + nodeIndex;
+        node->translation = gltfNode->has_translation ? Vector3(gltfNode->translation[0], gltfNode->translation[1], gltfNode->translation[2]) : Vector3(0.0f, 0.0f, 0.0f);
+        node->scale = gltfNode->has_scale ? Vector3(gltfNode->scale[0], gltfNode->scale[1], gltfNode->scale[2]) : Vector3(1.0f, 1.0f, 1.0f);
+        node->orientation = gltfNode->has_rotation ? Quaternion(gltfNode->rotation[0], gltfNode->rotation[1], gltfNode->rotation[2], gltfNode->rotation[3]) : Quaternion();
+        if (gltfNode->mesh)
+        {
+            u32 gltfMeshIndex = (u32) (gltfNode->mesh - data->meshes);
+            node->firstMesh = firstMeshOfGltfMesh[gltfMeshIndex];
+            node->meshCount = (u32) gltfNode->mesh->primitives_count;
+        }
+    }
+
+    u32 childIndex = 0;
+    for (u32 nodeIndex = 0; nodeIndex < data->nodes_count; ++nodeIndex)
+    {
+        const cgltf_node* gltfNode = data->nodes + nodeIndex;
+        nodes[nodeIndex].firstChild = childIndex;
+        nodes[nodeIndex].childCount = (u32) gltfNode->children_count;
+        for (u32 child = 0; child < gltfNode->children_count; ++child)
+        {
+            childNodes[childIndex++] = (u32) (gltfNode->children[child] - data->nodes);
+        }
+    }
+
+    for (u32 rootIndex = 0; rootIndex < rootNodeCount; ++rootIndex)
+    {
+        rootNodes[rootIndex] = (u32) (gltfScene->nodes[rootIndex] - data->nodes);
+    }
+    free(firstMeshOfGltfMesh);
+
+    // Textures
+    jobAPI->WaitForCounter(&imageCounter);
+    // Image jobs read their paths from the dependencies
+    free(imageDependencies);
+    for (u32 imageIndex = 0; imageIndex < imageCount; ++imageIndex)
+    {
+        if (!imageJobs[imageIndex].mipChain)
+        {
+            // Gives the package back to the allocator
+            allocator->Free(allocator->instance, allocator->instance->startOffset - (u64) (package - allocator->instance->pointer));
+            DiscardImageJobs(jobAPI, &imageCounter, imageJobs, imageCount);
+            cgltf_free(data);
+            return nullptr;
+        }
+    }
+    for (u32 imageIndex = 0; imageIndex < imageCount; ++imageIndex)
+    {
+        ImageCookJob* job = imageJobs + imageIndex;
+
+        AssetPackageTexture* texture = textures + imageIndex;
+        texture->width = job->width;
+        texture->height = job->height;
+        texture->format = job->format;
+        texture->mipCount = job->mipCount;
+        texture->dataSize = job->mipChainSize;
+        u8* textureData = AllocPackageBlock(allocator, package, job->mipChainSize, ASSET_PACKAGE_ALIGNMENT, &texture->dataOffset);
+        memcpy(textureData, job->mipChain, job->mipChainSize);
+        free(job->mipChain);
+    }
+    free(imageJobs);
+
+    cgltf_free(data);
+
+    header->size = allocator->instance->startOffset - (u64) (package - allocator->instance->pointer);
+    *outSize = header->size;
+    return package;
+}
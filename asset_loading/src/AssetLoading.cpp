@@ -1,318 +1,1132 @@
 #include "pch.h"
+#include "ecs.h"
 #include "AssetLoading.h"
 #include "Log.h"
 #include "ApiRegistry.h"
 #include "Platform.h"
 #include "RHI.h"
-#include "ecs.h"
-
-#define CGLTF_IMPLEMENTATION
-#include "cgltf.h"
+#include "Jobs.h"
+#include "AssetPackage.h"
 
 static APIRegistry* gAPIRegistry = nullptr;
 
+#define MAX_ASSET_REQUEST_COUNT 256
+
+// Source being cooked. Only the I/O thread writes and reads the filename, the cook job clears active when the package is written.
+struct AssetCookSlot
+{
+    char filename[ASSET_PACKAGE_PATH_LENGTH];
+    volatile u32 active;
+};
+
+// Requests go from the pending list to the I/O thread, which maps the package. Missing or stale packages are cooked
+// on job workers. Loaded requests wait in the completed queue until the main thread instantiates them.
+struct AssetRequest
+{
+    char filename[ASSET_PACKAGE_PATH_LENGTH];
+    EntityContext* context;
+    AssetRequestPriority priority;
+    AssetLoadedCallback callback;
+    void* userData;
+    u32 sequence;
+
+    PlatformMappedFile packageFile;
+    ILinearAllocator* cookAllocator;
+    AssetCookSlot* cook;
+    const u8* package;
+};
+
 struct AssetAPIState
 {
-    ILinearAllocator* tempAllocator;
+    AssetRequest requests[MAX_ASSET_REQUEST_COUNT];
+    u32 freeRequests[MAX_ASSET_REQUEST_COUNT];
+    u32 freeRequestCount;
+    u32 nextSequence;
+
+    u32 pendingRequests[MAX_ASSET_REQUEST_COUNT];
+    u32 pendingRequestCount;
+    SpinLock pendingLock;
+
+    // Ring buffer, head and tail grow forever and wrap with the count
+    u32 completedRequests[MAX_ASSET_REQUEST_COUNT];
+    u32 completedHead;
+    u32 completedTail;
+    SpinLock completedLock;
+
+    JobCounter cookCounter;
+    // Requests of a source that's being cooked wait here, and map its package when the cook is done
+    AssetCookSlot cooks[MAX_ASSET_REQUEST_COUNT];
+    u32 deferredRequests[MAX_ASSET_REQUEST_COUNT];
+    u32 deferredRequestCount;
+    volatile u32 activeRequestCount;
+
+    PlatformSemaphore* ioSemaphore;
+    PlatformThread* ioThread;
+    volatile u32 quitRequested;
+
+    // Meshlets of the loaded meshes, one contiguous table
+    ILinearAllocator* meshletAllocator;
+    u32 meshletCount;
 };
 
 static AssetAPIState* gState = nullptr;
 
-static void LoadNode(RHIAPI* rhiAPI, EntityAPI* entityAPI, const cgltf_data* data, const cgltf_node* node, Component components[2],
-                     MaterialComponentData* materials, GPUBuffer* buffers, EntityContext* entityContext, bool leftHandedNormalMap)
+struct NodeComponents
+{
+    Component mesh;
+    Component material;
+    Component transform;
+    Component worldMatrix;
+    Component bounds;
+    Component parent;
+    Component children;
+};
+
+// Where a mesh's vertices and indices are in the buffers it's drawn from
+struct MeshPlacement
+{
+    u32 vertexOffsets[VertexBuffers::VERTEX_BUFFER_COUNT];
+    u32 vertexStrides[VertexBuffers::VERTEX_BUFFER_COUNT];
+    u32 baseVertex;
+    u32 indexStride;
+    // LOD indices follow the mesh's like in the package
+    u32 indexStart;
+};
+
+struct PackageResources
+{
+    const u8* package;
+    const AssetPackageHeader* header;
+    const AssetPackageMesh* meshes;
+    const AssetPackageNode* nodes;
+    const u32* childNodes;
+    MaterialComponentData* materials;
+    GPUBuffer vertexBuffer;
+    GPUBuffer indexBuffer;
+    const MeshPlacement* placements;
+    // Where the package's meshlets start in the meshlet table
+    u32 firstMeshlet;
+};
+
+static void LoadPrimitive(const PackageResources& resources, u32 meshIndex, MeshComponentData* outMesh, u64* outMaterialIndex, BoundsComponentData* outBounds)
+{
+    const AssetPackageMesh* packageMesh = resources.meshes + meshIndex;
+    const MeshPlacement* placement = resources.placements + meshIndex;
+
+    MeshComponentData& mesh = *outMesh;
+    mesh = {};
+    *outMaterialIndex = packageMesh->materialIndex;
+
+    for (u32 stream = 0; stream < VertexBuffers::VERTEX_BUFFER_COUNT; ++stream)
+    {
+        if (placement->vertexStrides[stream])
+        {
+            mesh.vertexBuffers[stream] = resources.vertexBuffer;
+            mesh.vertexStrides[stream] = placement->vertexStrides[stream];
+            mesh.vertexOffsets[stream] = placement->vertexOffsets[stream];
+        }
+    }
+    mesh.baseVertex = placement->baseVertex;
+
+    mesh.indexBuffer = resources.indexBuffer;
+    mesh.indexBufferStride = placement->indexStride;
+    mesh.indexStart = placement->indexStart;
+    mesh.indexCount = packageMesh->indexCount;
+    mesh.positionScale = packageMesh->positionScale;
+    mesh.positionOffset = packageMesh->positionOffset;
+    mesh.lodCount = packageMesh->lodCount;
+    for (u32 lod = 0; lod < packageMesh->lodCount; ++lod)
+    {
+        mesh.lods[lod].indexStart = placement->indexStart + (packageMesh->lods[lod].indexOffset - packageMesh->indexOffset) / packageMesh->indexStride;
+        mesh.lods[lod].indexCount = packageMesh->lods[lod].indexCount;
+        mesh.lods[lod].error = packageMesh->lods[lod].error;
+    }
+    mesh.firstMeshlet = resources.firstMeshlet + packageMesh->firstMeshlet;
+    mesh.meshletCount = packageMesh->meshletCount;
+
+    BoundsComponentData& bounds = *outBounds;
+    bounds.localBounds = packageMesh->bounds;
+    bounds.worldBounds = packageMesh->bounds;
+}
+
+// Links the child to the front of the parent's children list
+static void LinkChild(EntityAPI* entityAPI, EntityContext* entityContext, const NodeComponents& components, Entity parent, Entity child)
+{
+    ChildrenComponentData* childrenData = (ChildrenComponentData*) entityAPI->GetComponentData(entityContext, parent, components.children);
+    ParentComponentData* parentData = (ParentComponentData*) entityAPI->GetComponentData(entityContext, child, components.parent);
+    parentData->nextSibling = childrenData->firstChild;
+    childrenData->firstChild = child;
+    childrenData->childCount++;
+}
+
+// Every node becomes an entity with the first primitive of its mesh. Rest of the primitives are attached as children
+// with identity transforms. Pass INVALID_HANDLE parent for scene root nodes.
+static Entity LoadNode(EntityAPI* entityAPI, const PackageResources& resources, u32 nodeIndex, const NodeComponents& components,
+                       EntityContext* entityContext, Entity parent)
 {
+    const AssetPackageNode* node = resources.nodes + nodeIndex;
+    MaterialComponentData* materials = resources.materials;
 
-    // TODO: Parent transformation!!
     TransformComponentData transformComponentData = {};
-    transformComponentData.translation = Vector3(0.0f, 0.0f, 0.0f);
-    transformComponentData.scale = Vector3(1.0f, 1.0f, 1.0f);
-    transformComponentData.orientation = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
-    if (node->has_scale) {
-        transformComponentData.scale *= Vector3(node->scale[0], node->scale[1], node->scale[2]);
+    transformComponentData.translation = node->translation;
+    transformComponentData.scale = node->scale;
+    transformComponentData.orientation = node->orientation;
+    transformComponentData.dirty = true;
+
+    // World matrix is computed by the transform and hierarchy systems
+    WorldMatrixComponentData worldMatrixComponentData = {};
+    ParentComponentData parentComponentData = { parent, { INVALID_HANDLE } };
+    ChildrenComponentData childrenComponentData = { { INVALID_HANDLE }, 0 };
+    MeshComponentData mesh = {};
+    BoundsComponentData bounds = {};
+    u64 materialIndex = 0;
+
+    u32 numPrimitives = node->meshCount;
+    u32 numChildren = node->childCount + (numPrimitives > 1 ? numPrimitives - 1 : 0);
+
+    Component nodeComponents[7];
+    void* componentDatas[7];
+    u32 numComponents = 0;
+    nodeComponents[numComponents] = components.transform;
+    componentDatas[numComponents++] = &transformComponentData;
+    nodeComponents[numComponents] = components.worldMatrix;
+    componentDatas[numComponents++] = &worldMatrixComponentData;
+    if (parent.handle != INVALID_HANDLE)
+    {
+        nodeComponents[numComponents] = components.parent;
+        componentDatas[numComponents++] = &parentComponentData;
     }
-    if (node->has_translation) {
-        transformComponentData.translation += Vector3(node->translation[0], node->translation[1], node->translation[2]);
+    if (numChildren > 0)
+    {
+        nodeComponents[numComponents] = components.children;
+        componentDatas[numComponents++] = &childrenComponentData;
     }
-    if (node->has_rotation) {
-        transformComponentData.orientation = Vector4(node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3]);
+    if (numPrimitives > 0)
+    {
+        LoadPrimitive(resources, node->firstMesh, &mesh, &materialIndex, &bounds);
+        nodeComponents[numComponents] = components.mesh;
+        componentDatas[numComponents++] = &mesh;
+        nodeComponents[numComponents] = components.material;
+        componentDatas[numComponents++] = materials + materialIndex;
+        nodeComponents[numComponents] = components.bounds;
+        componentDatas[numComponents++] = &bounds;
     }
 
-    if (node->mesh)
+    Entity entity = entityAPI->CreateEntityWithComponents(entityContext, nodeComponents, componentDatas, numComponents);
+
+    // Rest of the primitives have the same components. Material is shared, so they are batched per material.
+    if (numPrimitives > 1)
     {
-        const cgltf_mesh* gltfMesh = node->mesh;
+        u32 primitiveCount = numPrimitives - 1;
+        TransformComponentData* primitiveTransforms = (TransformComponentData*) malloc(sizeof(TransformComponentData) * primitiveCount);
+        WorldMatrixComponentData* primitiveWorldMatrices = (WorldMatrixComponentData*) malloc(sizeof(WorldMatrixComponentData) * primitiveCount);
+        ParentComponentData* primitiveParents = (ParentComponentData*) malloc(sizeof(ParentComponentData) * primitiveCount);
+        MeshComponentData* primitiveMeshes = (MeshComponentData*) malloc(sizeof(MeshComponentData) * primitiveCount);
+        u64* primitiveMaterialIndices = (u64*) malloc(sizeof(u64) * primitiveCount);
+        BoundsComponentData* primitiveBounds = (BoundsComponentData*) malloc(sizeof(BoundsComponentData) * primitiveCount);
+        Entity* primitiveEntities = (Entity*) malloc(sizeof(Entity) * primitiveCount);
 
-        u32 numPrimitives = gltfMesh->primitives_count;
-        for (u32 primitiveIndex = 0; primitiveIndex < numPrimitives; ++primitiveIndex)
+        // Insertion sort by material, so primitives with the same material are next to each other
+        for (u32 primitiveIndex = 0; primitiveIndex < primitiveCount; ++primitiveIndex)
         {
-            const cgltf_primitive* prim = gltfMesh->primitives + primitiveIndex;
-            const cgltf_accessor* indices = prim->indices;
-            const cgltf_buffer_view* indexBufferView = indices->buffer_view;
-            const cgltf_buffer* buffer = indexBufferView->buffer;
-
-            MeshComponentData mesh = {};
-            u64 materialIndex = 0;
-            if (prim->material)
+            MeshComponentData primitiveMesh;
+            BoundsComponentData primitiveBound;
+            LoadPrimitive(resources, node->firstMesh + primitiveIndex + 1, &primitiveMesh, &materialIndex, &primitiveBound);
+
+            u32 insertIndex = primitiveIndex;
+            while (insertIndex > 0 && primitiveMaterialIndices[insertIndex - 1] > materialIndex)
             {
-                materialIndex = (u64) (prim->material - data->materials);
+                primitiveMeshes[insertIndex] = primitiveMeshes[insertIndex - 1];
+                primitiveBounds[insertIndex] = primitiveBounds[insertIndex - 1];
+                primitiveMaterialIndices[insertIndex] = primitiveMaterialIndices[insertIndex - 1];
+                insertIndex--;
             }
+            primitiveMeshes[insertIndex] = primitiveMesh;
+            primitiveBounds[insertIndex] = primitiveBound;
+            primitiveMaterialIndices[insertIndex] = materialIndex;
+
+            TransformComponentData* primitiveTransform = primitiveTransforms + primitiveIndex;
+            *primitiveTransform = {};
+            primitiveTransform->scale = Vector3(1.0f, 1.0f, 1.0f);
+            primitiveTransform->orientation = Quaternion();
+            primitiveTransform->dirty = true;
+            primitiveWorldMatrices[primitiveIndex] = {};
+            primitiveParents[primitiveIndex] = { entity, { INVALID_HANDLE } };
+        }
 
-            if (indices)
+        Component primitiveComponents[6] = { components.transform, components.worldMatrix, components.parent,
+                                             components.mesh, components.material, components.bounds };
+        u32 batchStart = 0;
+        while (batchStart < primitiveCount)
+        {
+            u32 batchEnd = batchStart + 1;
+            while (batchEnd < primitiveCount && primitiveMaterialIndices[batchEnd] == primitiveMaterialIndices[batchStart])
             {
-                u64 bufferViewIndex =  (u64) (indices->buffer_view - data->buffer_views);
-                mesh.indexBuffer = buffers[bufferViewIndex];
-                mesh.indexBufferStride = (u32) indices->stride;
-                mesh.indexStart = (u32) indices->offset / indices->stride;
-                mesh.indexCount = (u32) indices->count;
+                batchEnd++;
             }
 
-            bool hasTangents = false;
-            cgltf_buffer_view* positionBufferView;
-            cgltf_buffer_view* normalBufferView;
-            cgltf_buffer_view* texCoordBufferView;
+            void* primitiveColumns[6] = { primitiveTransforms + batchStart, primitiveWorldMatrices + batchStart, primitiveParents + batchStart,
+                                          primitiveMeshes + batchStart, materials + primitiveMaterialIndices[batchStart], primitiveBounds + batchStart };
+            entityAPI->CreateEntitiesBatch(entityContext, primitiveComponents, 6, primitiveColumns, batchEnd - batchStart, primitiveEntities + batchStart);
+            batchStart = batchEnd;
+        }
 
-            u32 numAttributes = prim->attributes_count;
-            for (u32 attributeIndex = 0; attributeIndex < numAttributes; ++attributeIndex)
-            {
-                const cgltf_attribute* attribute = prim->attributes + attributeIndex;
-                const cgltf_attribute_type type = attribute->type;
+        for (u32 primitiveIndex = 0; primitiveIndex < primitiveCount; ++primitiveIndex)
+        {
+            LinkChild(entityAPI, entityContext, components, entity, primitiveEntities[primitiveIndex]);
+        }
 
-                const cgltf_accessor* accessor = attribute->data;
-                cgltf_buffer_view* bufferView = accessor->buffer_view;
-                u64 bufferViewIndex = (u64) (bufferView - data->buffer_views);
+        free(primitiveTransforms);
+        free(primitiveWorldMatrices);
+        free(primitiveParents);
+        free(primitiveMeshes);
+        free(primitiveMaterialIndices);
+        free(primitiveBounds);
+        free(primitiveEntities);
+    }
 
-                u32 stride = accessor->stride;
-                u32 offset = accessor->offset;
+    for (u32 childIndex = 0; childIndex < node->childCount; ++childIndex)
+    {
+        u32 childNodeIndex = resources.childNodes[node->firstChild + childIndex];
+        Entity childEntity = LoadNode(entityAPI, resources, childNodeIndex, components, entityContext, entity);
+        LinkChild(entityAPI, entityContext, components, entity, childEntity);
+    }
 
-                if (type == cgltf_attribute_type_position)
-                {
-                    ASSERT(stride == 12, "Unsupported position stride");
-                    mesh.vertexBuffers[VertexBuffers::VERTEX_BUFFER_POSITIONS] = buffers[bufferViewIndex];
-                    mesh.vertexStrides[VertexBuffers::VERTEX_BUFFER_POSITIONS] = stride;
-                    mesh.vertexOffsets[VertexBuffers::VERTEX_BUFFER_POSITIONS] = offset;
-                    positionBufferView = bufferView;
+    return entity;
+}
 
-                }
-                else if (type == cgltf_attribute_type_normal)
-                {
-                    ASSERT(stride == 12, "Unsupported normal stride");
-                    mesh.vertexBuffers[VertexBuffers::VERTEX_BUFFER_NORMAL] = buffers[bufferViewIndex];
-                    mesh.vertexStrides[VertexBuffers::VERTEX_BUFFER_NORMAL] = stride;
-                    mesh.vertexOffsets[VertexBuffers::VERTEX_BUFFER_NORMAL] = offset;
-                    normalBufferView = bufferView;
-                }
-                else if (type == cgltf_attribute_type_texcoord)
-                {
-                    ASSERT(stride == 8, "Unsupported texcoord stride");
-                    mesh.vertexBuffers[VertexBuffers::VERTEX_BUFFER_TEXCOORD] = buffers[bufferViewIndex];
-                    mesh.vertexStrides[VertexBuffers::VERTEX_BUFFER_TEXCOORD] = stride;
-                    mesh.vertexOffsets[VertexBuffers::VERTEX_BUFFER_TEXCOORD] = offset;
-                    texCoordBufferView = bufferView;
-                }
-                else if (type == cgltf_attribute_type_tangent)
-                {
-                    ASSERT(stride == 16, "Unsupported tangent stride");
-                    mesh.vertexBuffers[VertexBuffers::VERTEX_BUFFER_TANGENT] = buffers[bufferViewIndex];
-                    mesh.vertexStrides[VertexBuffers::VERTEX_BUFFER_TANGENT] = stride;
-                    mesh.vertexOffsets[VertexBuffers::VERTEX_BUFFER_TANGENT] = offset;
-                    hasTangents = true;
-                }
-            }
+static GPUShaderResourceView CreatePackageTexture(const u8* package, const AssetPackageTexture* packageTexture, RHIAPI* rhiAPI)
+{
+    // Mips are uploaded from the package as they are
+    SubresourceData* subresources = (SubresourceData*) alloca(sizeof(SubresourceData) * packageTexture->mipCount);
+    u64 mipOffset = packageTexture->dataOffset;
+    for (u32 mip = 0; mip < packageTexture->mipCount; ++mip)
+    {
+        u64 mipSize;
+        subresources[mip] = {};
+        subresources[mip].data = package + mipOffset;
+        GetAssetTextureMipLayout(packageTexture->format, packageTexture->width, packageTexture->height, mip, &subresources[mip].memPitch, &mipSize);
+        mipOffset += mipSize;
+    }
+    ASSERT(mipOffset - packageTexture->dataOffset == packageTexture->dataSize, "Package texture size mismatch");
+
+    Texture2DDesc initParams = {};
+    initParams.arraySize = 1;
+    initParams.format = (DataFormat) packageTexture->format;
+    initParams.width = packageTexture->width;
+    initParams.height = packageTexture->height;
+    initParams.sampleCount = 1;
+    initParams.mipCount = packageTexture->mipCount;
+    initParams.flags = GPUResourceFlags::BIND_SHADER_RESOURCE | GPUResourceFlags::USAGE_IMMUTABLE;
+    GPUTexture2D texture = rhiAPI->CreateTexture2D(&initParams, subresources, 0);
+
+    GPUResourceViewDesc resourceDesc = {};
+    resourceDesc.firstArraySlice = 0;
+    resourceDesc.firstMip = 0;
+    resourceDesc.sliceArrayCount = 1;
+    resourceDesc.mipCount = packageTexture->mipCount;
+    return rhiAPI->CreateShaderResourceView(texture, resourceDesc, 0);
+}
+
+static const AssetPackageMesh* GetAssetPackageMeshes(const u8* package)
+{
+    const AssetPackageHeader* header = (const AssetPackageHeader*) package;
+    const AssetPackageDependency* dependencies = (const AssetPackageDependency*) (header + 1);
+    const AssetPackageTexture* packageTextures = (const AssetPackageTexture*) (dependencies + header->dependencyCount);
+    const AssetPackageMaterial* packageMaterials = (const AssetPackageMaterial*) (packageTextures + header->textureCount);
+    return (const AssetPackageMesh*) (packageMaterials + header->materialCount);
+}
 
-            void* componentDatas[3] = { &mesh, (materials + materialIndex), &transformComponentData };
-            entityAPI->CreateEntityWithComponents(entityContext, components, componentDatas, 3);
+// Indices of the mesh and its LODs, one block in the package
+static u32 GetAssetPackageMeshIndexCount(const AssetPackageMesh* packageMesh)
+{
+    u32 indexCount = packageMesh->indexCount;
+    for (u32 lod = 0; lod < packageMesh->lodCount; ++lod)
+    {
+        indexCount += packageMesh->lods[lod].indexCount;
+    }
+    return indexCount;
+}
+
+// Creates the entities of a package whose meshes are drawn from the given buffers, with a placement per mesh
+static void InstantiateAssetPackageWithGeometry(const u8* package, GPUBuffer vertexBuffer, GPUBuffer indexBuffer, const MeshPlacement* placements,
+                                                RHIAPI* rhiAPI, EntityAPI* entityAPI, EntityContext* entityContext)
+{
+    PackageResources resources = {};
+    resources.package = package;
+    resources.header = (const AssetPackageHeader*) package;
+    const AssetPackageHeader* header = resources.header;
+    const AssetPackageDependency* dependencies = (const AssetPackageDependency*) (header + 1);
+    const AssetPackageTexture* packageTextures = (const AssetPackageTexture*) (dependencies + header->dependencyCount);
+    const AssetPackageMaterial* packageMaterials = (const AssetPackageMaterial*) (packageTextures + header->textureCount);
+    resources.meshes = (const AssetPackageMesh*) (packageMaterials + header->materialCount);
+    resources.nodes = (const AssetPackageNode*) (resources.meshes + header->meshCount);
+    const u32* rootNodes = (const u32*) (resources.nodes + header->nodeCount);
+    resources.childNodes = rootNodes + header->rootNodeCount;
+    resources.vertexBuffer = vertexBuffer;
+    resources.indexBuffer = indexBuffer;
+    resources.placements = placements;
+
+    // Meshlet index starts become absolute in the index buffer
+    ASSERT(gState, "Asset API has not been initialized!");
+    u32 packageMeshletCount = (u32) (header->meshletDataSize / sizeof(Meshlet));
+    resources.firstMeshlet = gState->meshletCount;
+    Meshlet* meshlets = (Meshlet*) gState->meshletAllocator->Alloc(gState->meshletAllocator->instance, header->meshletDataSize);
+    memcpy(meshlets, package + header->meshletDataOffset, header->meshletDataSize);
+    for (u32 meshIndex = 0; meshIndex < header->meshCount; ++meshIndex)
+    {
+        const AssetPackageMesh* packageMesh = resources.meshes + meshIndex;
+        for (u32 meshlet = packageMesh->firstMeshlet; meshlet < packageMesh->firstMeshlet + packageMesh->meshletCount; ++meshlet)
+        {
+            meshlets[meshlet].indexStart += placements[meshIndex].indexStart;
         }
     }
+    gState->meshletCount += packageMeshletCount;
 
-    u32 numChildren = node->children_count;
-    for (u32 childrenIndex = 0; childrenIndex < numChildren; ++childrenIndex)
+    GPUShaderResourceView* textures = (GPUShaderResourceView*) malloc(sizeof(GPUShaderResourceView) * header->textureCount);
+    for (u32 textureIndex = 0; textureIndex < header->textureCount; ++textureIndex)
     {
-        const cgltf_node* children = data->nodes + childrenIndex;
-        LoadNode(rhiAPI, entityAPI, data, children, components, materials, buffers, entityContext, leftHandedNormalMap);
+        textures[textureIndex] = CreatePackageTexture(package, packageTextures + textureIndex, rhiAPI);
     }
+
+    // Material textures are laid out in AssetMaterialTexture order
+    resources.materials = (MaterialComponentData*) malloc(sizeof(MaterialComponentData) * header->materialCount);
+    for (u32 materialIndex = 0; materialIndex < header->materialCount; ++materialIndex)
+    {
+        const AssetPackageMaterial* packageMaterial = packageMaterials + materialIndex;
+        MaterialComponentData material = {};
+        material.baseColor = packageMaterial->baseColor;
+        material.emissiveColor = packageMaterial->emissiveColor;
+        material.roughness = packageMaterial->roughness;
+        material.metallic = packageMaterial->metallic;
+
+        GPUShaderResourceView* materialTextures = &material.baseColorTexture;
+        for (u32 texture = 0; texture < ASSET_MATERIAL_TEXTURE_COUNT; ++texture)
+        {
+            if (packageMaterial->textures[texture] != NULL_INDEX)
+            {
+                materialTextures[texture] = textures[packageMaterial->textures[texture]];
+            }
+        }
+
+        resources.materials[materialIndex] = material;
+    }
+    free(textures);
+
+    NodeComponents components = {};
+    components.mesh = entityAPI->RegisterComponent(entityContext, MESH_COMPONENT_NAME, sizeof(MeshComponentData));
+    components.material = entityAPI->RegisterSharedComponent(entityContext, MATERIAL_COMPONENT_NAME, sizeof(MaterialComponentData));
+    components.transform = entityAPI->RegisterComponent(entityContext, TRANSFORM_COMPONENT_NAME, sizeof(TransformComponentData));
+    components.worldMatrix = entityAPI->RegisterComponent(entityContext, WORLD_MATRIX_COMPONENT_NAME, sizeof(WorldMatrixComponentData));
+    components.bounds = entityAPI->RegisterComponent(entityContext, BOUNDS_COMPONENT_NAME, sizeof(BoundsComponentData));
+    components.parent = entityAPI->RegisterComponent(entityContext, PARENT_COMPONENT_NAME, sizeof(ParentComponentData));
+    components.children = entityAPI->RegisterComponent(entityContext, CHILDREN_COMPONENT_NAME, sizeof(ChildrenComponentData));
+
+    // So snapshots can relocate the handles
+    entityAPI->RegisterComponentHandle(entityContext, components.parent, offsetof(ParentComponentData, parent), ENTITY_HANDLE_TYPE);
+    entityAPI->RegisterComponentHandle(entityContext, components.parent, offsetof(ParentComponentData, nextSibling), ENTITY_HANDLE_TYPE);
+    entityAPI->RegisterComponentHandle(entityContext, components.children, offsetof(ChildrenComponentData, firstChild), ENTITY_HANDLE_TYPE);
+    for (u32 vertexBufferIndex = 0; vertexBufferIndex < VertexBuffers::VERTEX_BUFFER_COUNT; ++vertexBufferIndex)
+    {
+        u32 fieldOffset = (u32) (offsetof(MeshComponentData, vertexBuffers) + sizeof(GPUBuffer) * vertexBufferIndex);
+        entityAPI->RegisterComponentHandle(entityContext, components.mesh, fieldOffset, ASSET_HANDLE_GPU_BUFFER);
+    }
+    entityAPI->RegisterComponentHandle(entityContext, components.mesh, offsetof(MeshComponentData, indexBuffer), ASSET_HANDLE_GPU_BUFFER);
+    for (u32 textureOffset = offsetof(MaterialComponentData, baseColorTexture); textureOffset <= offsetof(MaterialComponentData, emissiveTexture); textureOffset += sizeof(GPUShaderResourceView))
+    {
+        entityAPI->RegisterComponentHandle(entityContext, components.material, textureOffset, ASSET_HANDLE_SHADER_RESOURCE_VIEW);
+    }
+
+    // Only the root nodes of the scene, children are loaded recursively
+    for (u32 rootIndex = 0; rootIndex < header->rootNodeCount; ++rootIndex)
+    {
+        LoadNode(entityAPI, resources, rootNodes[rootIndex], components, entityContext, Entity { INVALID_HANDLE });
+    }
+    free(resources.materials);
 }
 
-GPUTexture2D LoadGLTFImage(const cgltf_image* gltfImage, RHIAPI* rhiAPI, const char* directory, bool generateMips = true, bool srgb = false) {
+// Every mesh of the package shares one vertex and one index buffer, created from the package's data as it is
+static void InstantiateAssetPackage(const u8* package, RHIAPI* rhiAPI, EntityAPI* entityAPI, EntityContext* entityContext)
+{
+    const AssetPackageHeader* header = (const AssetPackageHeader*) package;
+    const AssetPackageMesh* packageMeshes = GetAssetPackageMeshes(package);
+    MeshPlacement* placements = (MeshPlacement*) malloc(sizeof(MeshPlacement) * header->meshCount);
+    for (u32 meshIndex = 0; meshIndex < header->meshCount; ++meshIndex)
+    {
+        const AssetPackageMesh* packageMesh = packageMeshes + meshIndex;
+        MeshPlacement* placement = placements + meshIndex;
+        memcpy(placement->vertexOffsets, packageMesh->vertexOffsets, sizeof(placement->vertexOffsets));
+        memcpy(placement->vertexStrides, packageMesh->vertexStrides, sizeof(placement->vertexStrides));
+        placement->baseVertex = 0;
+        placement->indexStride = packageMesh->indexStride;
+        placement->indexStart = packageMesh->indexOffset / packageMesh->indexStride;
+    }
 
-    TempAllocator tempAllocator;
-    tempAllocator.Printf("%s/%s", directory, gltfImage->uri);
+    SubresourceData bufferSubresource = {};
+    bufferSubresource.data = package + header->vertexDataOffset;
+    GPUBuffer vertexBuffer = rhiAPI->CreateBuffer(&bufferSubresource, (u32) header->vertexDataSize, GPUResourceFlags::USAGE_IMMUTABLE | GPUResourceFlags::BIND_VERTEX_BUFFER, 0);
+    bufferSubresource.data = package + header->indexDataOffset;
+    GPUBuffer indexBuffer = rhiAPI->CreateBuffer(&bufferSubresource, (u32) header->indexDataSize, GPUResourceFlags::USAGE_IMMUTABLE | GPUResourceFlags::BIND_INDEX_BUFFER, 0);
 
-    i32 width = 0;
-    i32 height = 0;
-    i32 comp = 0;
-    u8* imageData = stbi_load(tempAllocator.buffer, &width, &height, &comp, 4);
+    InstantiateAssetPackageWithGeometry(package, vertexBuffer, indexBuffer, placements, rhiAPI, entityAPI, entityContext);
+    free(placements);
+}
 
-    // Subresources
-    SubresourceData subresource;
-    subresource.data = imageData;
-    subresource.memPitch = width * 4;
-    subresource.memSlicePitch = 0;
+// Cached package is valid if it's from this version and none of its sources changed since it's cooked
+static bool IsAssetPackageValid(FileAPI* fileAPI, const PlatformMappedFile* file)
+{
+    if (file->size < sizeof(AssetPackageHeader))
+    {
+        return false;
+    }
 
-    // TODO: Determine the format using image's pixel informations!
-    Texture2DDesc initParams = {};
-    initParams.arraySize = 1;
-    initParams.format = srgb ? FORMAT_R8G8B8A8_UNORM_SRGB : FORMAT_R8G8B8A8_UNORM;
-    initParams.width = width;
-    initParams.height = height;
-    initParams.sampleCount = 1;
-    initParams.mipCount = generateMips ? 0 : 1;
-    initParams.flags = GPUResourceFlags::BIND_SHADER_RESOURCE;
-    if (generateMips) {
-        initParams.flags |= (GPUResourceFlags::MISC_GENERATE_MIPS | GPUResourceFlags::BIND_RENDER_TARGET);
-    } else {
-        initParams.flags |= GPUResourceFlags::USAGE_IMMUTABLE;
+    const AssetPackageHeader* header = (const AssetPackageHeader*) file->data;
+    u32 expectedFlags = ASSET_QUANTIZE_VERTICES ? ASSET_PACKAGE_FLAG_QUANTIZED_VERTICES : 0;
+    if (header->magic != ASSET_PACKAGE_MAGIC || header->version != ASSET_PACKAGE_VERSION || header->flags != expectedFlags || header->size != file->size)
+    {
+        return false;
     }
 
-    return rhiAPI->CreateTexture2D(&initParams, &subresource, 0);
+    u64 dependenciesSize = sizeof(AssetPackageDependency) * header->dependencyCount;
+    AssetPackageDependency* dependencies = (AssetPackageDependency*) malloc(dependenciesSize);
+    memcpy(dependencies, header + 1, dependenciesSize);
+    u64 sourceKey = 0;
+    bool sourcesExist = ComputeAssetPackageSourceKey(fileAPI, dependencies, header->dependencyCount, &sourceKey);
+    free(dependencies);
+
+    return sourcesExist && sourceKey == header->sourceKey;
 }
 
+static bool WriteAssetPackage(const char* packageFilename, const void* package, u64 size)
+{
+    FILE* file = fopen(packageFilename, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool written = fwrite(package, 1, size, file) == size;
+    fclose(file);
+    return written;
+}
+
+static bool IsAssetPackageFilename(const char* filename)
+{
+    const char* extension = strrchr(filename, '.');
+    return extension && strcmp(extension, ASSET_PACKAGE_EXTENSION) == 0;
+}
+
+static bool MapAssetPackage(FileAPI* fileAPI, const char* packageFilename, PlatformMappedFile* outFile)
+{
+    if (!fileAPI->MapFile(packageFilename, outFile))
+    {
+        return false;
+    }
+
+    if (!IsAssetPackageValid(fileAPI, outFile))
+    {
+        fileAPI->UnmapFile(outFile);
+        return false;
+    }
 
-void LoadGLTFFile(const char* filepath, RHIAPI* rhiAPI, EntityAPI* entityAPI, EntityContext* entityContext)
+    return true;
+}
+
+// Returns the package in the allocator, nullptr if the file can't be cooked
+static void* CookAndWriteAssetPackage(const char* sourceFilename, const char* packageFilename, ILinearAllocator* allocator, bool* outWritten)
 {
+    JobAPI* jobAPI = (JobAPI*) gAPIRegistry->Get(JOB_API_NAME);
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
 
-    const char* filename = PathGetFilename(filepath);
-    const char* extension = PathGetExtension(filepath);
-    char fileDirectory[1024];
-    strcpy(fileDirectory, filepath);
-    PathRemoveFilename(fileDirectory);
+    u64 packageSize = 0;
+    void* package = CookGLTFFile(sourceFilename, jobAPI, platformAPI->fileAPI, allocator, &packageSize);
+    *outWritten = package && WriteAssetPackage(packageFilename, package, packageSize);
+    return package;
+}
 
-    cgltf_options options = {};
-    cgltf_data* data = NULL;
-    cgltf_result result = cgltf_parse_file(&options, filepath, &data);
+bool CookAsset(const char* sourceFilename, const char* packageFilename)
+{
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    ILinearAllocator* cookAllocator = allocatorAPI->CreateLinearAllocator(Gigabyte(16ULL), Megabyte(1));
+    bool written = false;
+    CookAndWriteAssetPackage(sourceFilename, packageFilename, cookAllocator, &written);
+    allocatorAPI->DestroyLinearAllocator(cookAllocator);
 
-    if (result != cgltf_result_success) {
-        return;
+    return written;
+}
+
+// glTF files are cooked to a package next to them on the first load, later loads map the package.
+// Returns the package in the mapped file or in the cook allocator, nullptr if it can't be loaded.
+static const u8* AcquireAssetPackage(const char* filename, PlatformMappedFile* outPackageFile, ILinearAllocator** outCookAllocator)
+{
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+    FileAPI* fileAPI = platformAPI->fileAPI;
+    *outPackageFile = {};
+    *outCookAllocator = nullptr;
+
+    if (IsAssetPackageFilename(filename))
+    {
+        return MapAssetPackage(fileAPI, filename, outPackageFile) ? outPackageFile->data : nullptr;
     }
 
-    // Load textures
-    u32 numGltfImages = data->images_count;
-    GPUShaderResourceView* textures = (GPUShaderResourceView*) alloca(sizeof(GPUShaderResourceView) * numGltfImages);
-    for (u32 imageIndex = 0; imageIndex < numGltfImages; ++imageIndex)
+    TempAllocator tempAllocator;
+    const char* packageFilename = tempAllocator.Printf("%s%s", filename, ASSET_PACKAGE_EXTENSION);
+    if (MapAssetPackage(fileAPI, packageFilename, outPackageFile))
     {
-        cgltf_image* gltfImage = data->images + imageIndex;
+        return outPackageFile->data;
+    }
 
-        GPUTexture2D texture = LoadGLTFImage(gltfImage, rhiAPI, fileDirectory, false, false);
-        GPUResourceViewDesc resourceDesc = {};
-        resourceDesc.firstArraySlice = 0;
-        resourceDesc.firstMip = 0;
-        resourceDesc.sliceArrayCount = 1;
-        resourceDesc.mipCount = 1;
-        GPUShaderResourceView resourceView = rhiAPI->CreateShaderResourceView(texture, resourceDesc, 0);
-        textures[imageIndex] = resourceView;
+    // Stale or missing package. Cook it and instantiate from memory, a failed write only costs the next load a cook.
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    *outCookAllocator = allocatorAPI->CreateLinearAllocator(Gigabyte(16ULL), Megabyte(1));
+    bool written = false;
+    return (const u8*) CookAndWriteAssetPackage(filename, packageFilename, *outCookAllocator, &written);
+}
+
+static void ReleaseAssetPackage(PlatformMappedFile* packageFile, ILinearAllocator* cookAllocator)
+{
+    if (packageFile->data)
+    {
+        PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+        platformAPI->fileAPI->UnmapFile(packageFile);
+    }
+    if (cookAllocator)
+    {
+        AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+        allocatorAPI->DestroyLinearAllocator(cookAllocator);
     }
+}
 
-    // Load materials
-    u32 numGltfMaterials = data->materials_count;
-    MaterialComponentData* materials = (MaterialComponentData*) alloca(sizeof(MaterialComponentData) * numGltfMaterials);
-    for (u32 materialIndex = 0; materialIndex < numGltfMaterials; ++materialIndex) {
-        cgltf_material* gltfMaterial = data->materials + materialIndex;
-        MaterialComponentData material = {};
+void LoadAsset(EntityContext* context, const char* filename)
+{
+    RHIAPI* rhiAPI = (RHIAPI*) gAPIRegistry->Get(RHI_API_NAME);
+    EntityAPI* entityAPI = (EntityAPI*) gAPIRegistry->Get(ENTITY_API_NAME);
+
+    PlatformMappedFile packageFile;
+    ILinearAllocator* cookAllocator;
+    const u8* package = AcquireAssetPackage(filename, &packageFile, &cookAllocator);
+    ASSERT(package || !IsAssetPackageFilename(filename), "Invalid asset package");
+    if (package)
+    {
+        InstantiateAssetPackage(package, rhiAPI, entityAPI, context);
+    }
+    ReleaseAssetPackage(&packageFile, cookAllocator);
+}
 
-        cgltf_pbr_metallic_roughness pbr = gltfMaterial->pbr_metallic_roughness;
+// Scene loads put the geometry of many packages into shared buffers of up to this size each
+#define SCENE_GEOMETRY_BUFFER_SIZE Megabyte(128)
+#define MAX_SCENE_BATCH_PACKAGE_COUNT 256
+#define SCENE_VERTEX_STREAM_ALIGNMENT 256
 
-        material.baseColor = Vector4((float)pbr.base_color_factor[0], (float)pbr.base_color_factor[1], (float)pbr.base_color_factor[2], (float)pbr.base_color_factor[3]);
-        material.emissiveColor = Vector4((float)gltfMaterial->emissive_factor[0], (float)gltfMaterial->emissive_factor[1], (float)gltfMaterial->emissive_factor[2], 1.0f);
-        material.roughness = (float) pbr.roughness_factor;
-        material.metallic = (float) pbr.metallic_factor;
+// Packages of a scene load that share one vertex and one index buffer
+struct SceneBatch
+{
+    PlatformMappedFile packageFiles[MAX_SCENE_BATCH_PACKAGE_COUNT];
+    ILinearAllocator* cookAllocators[MAX_SCENE_BATCH_PACKAGE_COUNT];
+    const u8* packages[MAX_SCENE_BATCH_PACKAGE_COUNT];
+    u32 packageCount;
+    u32 meshCount;
+    u64 vertexCount;
+    u64 indexCount;
+    u32 vertexStrides[VertexBuffers::VERTEX_BUFFER_COUNT];
+    u32 indexStride;
+};
 
-        cgltf_texture_view baseColor = pbr.base_color_texture;
-        if (baseColor.texture) {
-            const cgltf_texture* baseColorTexture = baseColor.texture;
-            const cgltf_image* baseColorImage = baseColorTexture->image;
-            u64 imageIndex = (u64) (baseColorImage - data->images);
-            material.baseColorTexture = textures[imageIndex];
+struct SceneLoad
+{
+    EntityContext* context;
+    RHIAPI* rhiAPI;
+    EntityAPI* entityAPI;
+    SceneBatch batch;
+    u32 loadedCount;
+};
+
+// Every stream is a region of the vertex buffer, sized for all the vertices of the batch
+static u64 ComputeSceneVertexRegions(u64 vertexCount, const u32* vertexStrides, u64* outRegionOffsets)
+{
+    u64 vertexDataSize = 0;
+    for (u32 stream = 0; stream < VertexBuffers::VERTEX_BUFFER_COUNT; ++stream)
+    {
+        if (outRegionOffsets)
+        {
+            outRegionOffsets[stream] = vertexDataSize;
         }
+        vertexDataSize += (vertexCount * vertexStrides[stream] + SCENE_VERTEX_STREAM_ALIGNMENT - 1) & ~(u64) (SCENE_VERTEX_STREAM_ALIGNMENT - 1);
+    }
+    return vertexDataSize;
+}
+
+// Meshes keep their package indices and draw with a base vertex, so every mesh of the batch binds the same buffers with the same offsets.
+// Streams a mesh doesn't have are zero, like unbound streams read.
+static void FlushSceneBatch(SceneLoad* load)
+{
+    SceneBatch* batch = &load->batch;
+    if (batch->packageCount == 0)
+    {
+        return;
+    }
+
+    u64 regionOffsets[VertexBuffers::VERTEX_BUFFER_COUNT];
+    u64 vertexDataSize = ComputeSceneVertexRegions(batch->vertexCount, batch->vertexStrides, regionOffsets);
+    u64 indexDataSize = batch->indexCount * batch->indexStride;
+    ASSERT(vertexDataSize <= U32Max && indexDataSize <= U32Max, "Scene batch is too big for one buffer");
 
-        cgltf_texture_view metallicRoughness = pbr.metallic_roughness_texture;
-        if (metallicRoughness.texture) {
-            const cgltf_texture* metallicRoughnessTexture = metallicRoughness.texture;
-            const cgltf_image* metallicRoughnessImage = metallicRoughnessTexture->image;
-            u64 imageIndex = (u64) (metallicRoughnessImage - data->images);
-            material.roughnessMetallicTexture = textures[imageIndex];
+    u8* vertexData = (u8*) malloc(vertexDataSize);
+    memset(vertexData, 0, vertexDataSize);
+    u8* indexData = (u8*) malloc(indexDataSize);
+    MeshPlacement* placements = (MeshPlacement*) malloc(sizeof(MeshPlacement) * batch->meshCount);
+
+    u32 baseVertex = 0;
+    u32 indexStart = 0;
+    MeshPlacement* placement = placements;
+    for (u32 packageIndex = 0; packageIndex < batch->packageCount; ++packageIndex)
+    {
+        const u8* package = batch->packages[packageIndex];
+        const AssetPackageHeader* header = (const AssetPackageHeader*) package;
+        const AssetPackageMesh* packageMeshes = GetAssetPackageMeshes(package);
+        for (u32 meshIndex = 0; meshIndex < header->meshCount; ++meshIndex, ++placement)
+        {
+            const AssetPackageMesh* packageMesh = packageMeshes + meshIndex;
+            *placement = {};
+            for (u32 stream = 0; stream < VertexBuffers::VERTEX_BUFFER_COUNT; ++stream)
+            {
+                u32 stride = batch->vertexStrides[stream];
+                placement->vertexOffsets[stream] = (u32) regionOffsets[stream];
+                placement->vertexStrides[stream] = stride;
+                if (packageMesh->vertexStrides[stream])
+                {
+                    ASSERT(packageMesh->vertexStrides[stream] == stride, "Vertex stream strides differ between packages");
+                    memcpy(vertexData + regionOffsets[stream] + (u64) baseVertex * stride, package + header->vertexDataOffset + packageMesh->vertexOffsets[stream],
+                           (u64) packageMesh->vertexCount * stride);
+                }
+            }
+            placement->baseVertex = baseVertex;
+            placement->indexStride = batch->indexStride;
+            placement->indexStart = indexStart;
+
+            // 16 bit indices are widened if another mesh of the batch needs 32 bit ones
+            u32 meshIndexCount = GetAssetPackageMeshIndexCount(packageMesh);
+            const u8* sourceIndices = package + header->indexDataOffset + packageMesh->indexOffset;
+            u8* indices = indexData + (u64) indexStart * batch->indexStride;
+            if (packageMesh->indexStride == batch->indexStride)
+            {
+                memcpy(indices, sourceIndices, (u64) meshIndexCount * batch->indexStride);
+            }
+            else
+            {
+                for (u32 index = 0; index < meshIndexCount; ++index)
+                {
+                    ((u32*) indices)[index] = ((const u16*) sourceIndices)[index];
+                }
+            }
+
+            baseVertex += packageMesh->vertexCount;
+            indexStart += meshIndexCount;
         }
+    }
+
+    SubresourceData bufferSubresource = {};
+    bufferSubresource.data = vertexData;
+    GPUBuffer vertexBuffer = load->rhiAPI->CreateBuffer(&bufferSubresource, (u32) vertexDataSize, GPUResourceFlags::USAGE_IMMUTABLE | GPUResourceFlags::BIND_VERTEX_BUFFER, 0);
+    bufferSubresource.data = indexData;
+    GPUBuffer indexBuffer = load->rhiAPI->CreateBuffer(&bufferSubresource, (u32) indexDataSize, GPUResourceFlags::USAGE_IMMUTABLE | GPUResourceFlags::BIND_INDEX_BUFFER, 0);
+
+    placement = placements;
+    for (u32 packageIndex = 0; packageIndex < batch->packageCount; ++packageIndex)
+    {
+        const u8* package = batch->packages[packageIndex];
+        InstantiateAssetPackageWithGeometry(package, vertexBuffer, indexBuffer, placement, load->rhiAPI, load->entityAPI, load->context);
+        placement += ((const AssetPackageHeader*) package)->meshCount;
+        ReleaseAssetPackage(batch->packageFiles + packageIndex, batch->cookAllocators[packageIndex]);
+    }
+
+    free(vertexData);
+    free(indexData);
+    free(placements);
+    *batch = {};
+}
 
-        cgltf_texture_view emissive = gltfMaterial->emissive_texture;
-        if (emissive.texture) {
-            const cgltf_texture* emissiveTexture = emissive.texture;
-            const cgltf_image* emissiveImage = emissiveTexture->image;
-            u64 imageIndex = (u64) (emissiveImage - data->images);
-            material.emissiveTexture = textures[imageIndex];
+static void AddSceneFile(const char* path, void* userData)
+{
+    SceneLoad* load = (SceneLoad*) userData;
+    PlatformMappedFile packageFile;
+    ILinearAllocator* cookAllocator;
+    const u8* package = AcquireAssetPackage(path, &packageFile, &cookAllocator);
+    if (!package)
+    {
+        ReleaseAssetPackage(&packageFile, cookAllocator);
+        return;
+    }
+
+    const AssetPackageHeader* header = (const AssetPackageHeader*) package;
+    const AssetPackageMesh* packageMeshes = GetAssetPackageMeshes(package);
+    u64 vertexCount = 0;
+    u64 indexCount = 0;
+    u32 vertexStrides[VertexBuffers::VERTEX_BUFFER_COUNT] = {};
+    u32 indexStride = 2;
+    for (u32 meshIndex = 0; meshIndex < header->meshCount; ++meshIndex)
+    {
+        const AssetPackageMesh* packageMesh = packageMeshes + meshIndex;
+        vertexCount += packageMesh->vertexCount;
+        indexCount += GetAssetPackageMeshIndexCount(packageMesh);
+        for (u32 stream = 0; stream < VertexBuffers::VERTEX_BUFFER_COUNT; ++stream)
+        {
+            if (packageMesh->vertexStrides[stream] > vertexStrides[stream])
+            {
+                vertexStrides[stream] = packageMesh->vertexStrides[stream];
+            }
+        }
+        if (packageMesh->indexStride > indexStride)
+        {
+            indexStride = packageMesh->indexStride;
+        }
+    }
+
+    // Starts a new batch if the package doesn't fit the buffers of the current one
+    SceneBatch* batch = &load->batch;
+    u32 batchVertexStrides[VertexBuffers::VERTEX_BUFFER_COUNT];
+    for (u32 stream = 0; stream < VertexBuffers::VERTEX_BUFFER_COUNT; ++stream)
+    {
+        batchVertexStrides[stream] = vertexStrides[stream] > batch->vertexStrides[stream] ? vertexStrides[stream] : batch->vertexStrides[stream];
+    }
+    u32 batchIndexStride = indexStride > batch->indexStride ? indexStride : batch->indexStride;
+    u64 vertexDataSize = ComputeSceneVertexRegions(batch->vertexCount + vertexCount, batchVertexStrides, nullptr);
+    u64 indexDataSize = (batch->indexCount + indexCount) * batchIndexStride;
+    if (batch->packageCount == MAX_SCENE_BATCH_PACKAGE_COUNT || vertexDataSize > SCENE_GEOMETRY_BUFFER_SIZE || indexDataSize > SCENE_GEOMETRY_BUFFER_SIZE)
+    {
+        FlushSceneBatch(load);
+        memcpy(batchVertexStrides, vertexStrides, sizeof(vertexStrides));
+        batchIndexStride = indexStride;
+    }
+
+    batch->packageFiles[batch->packageCount] = packageFile;
+    batch->cookAllocators[batch->packageCount] = cookAllocator;
+    batch->packages[batch->packageCount] = package;
+    batch->packageCount++;
+    batch->meshCount += header->meshCount;
+    batch->vertexCount += vertexCount;
+    batch->indexCount += indexCount;
+    memcpy(batch->vertexStrides, batchVertexStrides, sizeof(batchVertexStrides));
+    batch->indexStride = batchIndexStride;
+    load->loadedCount++;
+}
+
+u32 LoadScene(EntityContext* context, const char* pattern)
+{
+    ASSERT(gState, "Asset API has not been initialized!");
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+
+    SceneLoad* load = (SceneLoad*) malloc(sizeof(SceneLoad));
+    memset(load, 0, sizeof(SceneLoad));
+    load->context = context;
+    load->rhiAPI = (RHIAPI*) gAPIRegistry->Get(RHI_API_NAME);
+    load->entityAPI = (EntityAPI*) gAPIRegistry->Get(ENTITY_API_NAME);
+
+    platformAPI->fileAPI->FindFiles(pattern, AddSceneFile, load);
+    FlushSceneBatch(load);
+
+    u32 loadedCount = load->loadedCount;
+    free(load);
+    return loadedCount;
+}
+
+static void PushCompletedRequest(u32 requestIndex)
+{
+    SpinLockAcquire(&gState->completedLock);
+    gState->completedRequests[gState->completedTail % MAX_ASSET_REQUEST_COUNT] = requestIndex;
+    gState->completedTail++;
+    SpinLockRelease(&gState->completedLock);
+}
+
+static void CookRequestJob(void* userData)
+{
+    AssetRequest* request = (AssetRequest*) userData;
+
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    request->cookAllocator = allocatorAPI->CreateLinearAllocator(Gigabyte(16ULL), Megabyte(1));
+
+    TempAllocator tempAllocator;
+    const char* packageFilename = tempAllocator.Printf("%s%s", request->filename, ASSET_PACKAGE_EXTENSION);
+    bool written = false;
+    request->package = (const u8*) CookAndWriteAssetPackage(request->filename, packageFilename, request->cookAllocator, &written);
+
+    // Deferred requests of the same source can map the package now
+    AtomicStore(&request->cook->active, 0);
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+    platformAPI->threadAPI->SignalSemaphore(gState->ioSemaphore, 1);
+
+    PushCompletedRequest((u32) (request - gState->requests));
+}
+
+// Highest priority first, then in request order
+static bool PopPendingRequest(u32* outRequestIndex)
+{
+    SpinLockAcquire(&gState->pendingLock);
+    u32 bestPending = NULL_INDEX;
+    for (u32 pendingIndex = 0; pendingIndex < gState->pendingRequestCount; ++pendingIndex)
+    {
+        const AssetRequest* request = gState->requests + gState->pendingRequests[pendingIndex];
+        const AssetRequest* bestRequest = bestPending != NULL_INDEX ? gState->requests + gState->pendingRequests[bestPending] : nullptr;
+        if (!bestRequest || request->priority < bestRequest->priority ||
+            (request->priority == bestRequest->priority && request->sequence - bestRequest->sequence > U32Max / 2))
+        {
+            bestPending = pendingIndex;
         }
+    }
+
+    if (bestPending != NULL_INDEX)
+    {
+        *outRequestIndex = gState->pendingRequests[bestPending];
+        gState->pendingRequests[bestPending] = gState->pendingRequests[--gState->pendingRequestCount];
+    }
+    SpinLockRelease(&gState->pendingLock);
 
-        cgltf_texture_view occlusion = gltfMaterial->occlusion_texture;
-        if (occlusion.texture) {
-            const cgltf_texture* occlusionTexture = occlusion.texture;
-            const cgltf_image* occlusionImage = occlusionTexture->image;
-            u64 imageIndex = (u64) (occlusionImage - data->images);
-            material.occlusionTexture = textures[imageIndex];
+    return bestPending != NULL_INDEX;
+}
+
+static AssetCookSlot* FindActiveCook(const char* filename)
+{
+    for (u32 cookIndex = 0; cookIndex < MAX_ASSET_REQUEST_COUNT; ++cookIndex)
+    {
+        AssetCookSlot* cook = gState->cooks + cookIndex;
+        if (AtomicLoad(&cook->active) && strcmp(cook->filename, filename) == 0)
+        {
+            return cook;
         }
+    }
+    return nullptr;
+}
 
-        cgltf_texture_view normals = gltfMaterial->normal_texture;
-        if (normals.texture) {
-            const cgltf_texture* normalTexture = normals.texture;
-            const cgltf_image* normalImage = normalTexture->image;
-            u64 imageIndex = (u64) (normalImage - data->images);
-            material.normalMapTexture = textures[imageIndex];
+static void RequeueDeferredRequests()
+{
+    for (u32 deferredIndex = 0; deferredIndex < gState->deferredRequestCount;)
+    {
+        u32 requestIndex = gState->deferredRequests[deferredIndex];
+        if (FindActiveCook(gState->requests[requestIndex].filename))
+        {
+            deferredIndex++;
+            continue;
         }
 
-        *(materials + materialIndex) = material;
+        SpinLockAcquire(&gState->pendingLock);
+        gState->pendingRequests[gState->pendingRequestCount++] = requestIndex;
+        SpinLockRelease(&gState->pendingLock);
+        gState->deferredRequests[deferredIndex] = gState->deferredRequests[--gState->deferredRequestCount];
     }
+}
 
+static void AssetIOThreadFunction(void* userData)
+{
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+    JobAPI* jobAPI = (JobAPI*) gAPIRegistry->Get(JOB_API_NAME);
+    ThreadAPI* threadAPI = platformAPI->threadAPI;
+    FileAPI* fileAPI = platformAPI->fileAPI;
 
-    // Load meshes
-    cgltf_load_buffers(&options, data, filepath);
-    u32 numBuffers = data->buffer_views_count;
-    GPUBuffer* buffers = (GPUBuffer*) alloca(sizeof(GPUBuffer) * numBuffers);
-    for (size_t bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex) {
-        const cgltf_buffer_view* gltfBufferView = data->buffer_views + bufferIndex;
-        const cgltf_buffer* gltfBuffer = gltfBufferView->buffer;
+    while (!AtomicLoad(&gState->quitRequested))
+    {
+        RequeueDeferredRequests();
 
-        uint32_t bufferFlags = GPUResourceFlags::USAGE_IMMUTABLE;
-        if (gltfBufferView->type == cgltf_buffer_view_type_invalid) {
+        u32 requestIndex;
+        if (!PopPendingRequest(&requestIndex))
+        {
+            threadAPI->WaitSemaphore(gState->ioSemaphore);
             continue;
         }
-        switch (gltfBufferView->type) {
-            case cgltf_buffer_view_type_vertices:
-            {
-                bufferFlags |= GPUResourceFlags::BIND_VERTEX_BUFFER;
-            } break;
-            case cgltf_buffer_view_type_indices:
+
+        AssetRequest* request = gState->requests + requestIndex;
+        TempAllocator tempAllocator;
+        const char* packageFilename = IsAssetPackageFilename(request->filename) ? request->filename : tempAllocator.Printf("%s%s", request->filename, ASSET_PACKAGE_EXTENSION);
+        if (MapAssetPackage(fileAPI, packageFilename, &request->packageFile))
+        {
+            // Fault the pages in here, so instantiating doesn't block the main thread on disk reads
+            u8 pageSum = 0;
+            for (u64 offset = 0; offset < request->packageFile.size; offset += VM_PAGE_SIZE)
             {
-                bufferFlags |= GPUResourceFlags::BIND_INDEX_BUFFER;
-            } break;
-            default:
+                pageSum += ((volatile const u8*) request->packageFile.data)[offset];
+            }
+            (void) pageSum;
+
+            request->package = request->packageFile.data;
+            PushCompletedRequest(requestIndex);
+        }
+        else if (IsAssetPackageFilename(request->filename))
+        {
+            PushCompletedRequest(requestIndex);
+        }
+        else if (FindActiveCook(request->filename))
+        {
+            // Cooking the same source twice would write its package from two jobs at once
+            gState->deferredRequests[gState->deferredRequestCount++] = requestIndex;
+        }
+        else
+        {
+            // Every request in flight has at most one cook, so there's always a free slot
+            u32 cookIndex = 0;
+            while (cookIndex < MAX_ASSET_REQUEST_COUNT && AtomicLoad(&gState->cooks[cookIndex].active))
             {
-                ASSERT(false, "Unsupported bufferView target");
-            } break;
+                cookIndex++;
+            }
+            ASSERT(cookIndex < MAX_ASSET_REQUEST_COUNT, "Too many asset cooks in flight");
+            AssetCookSlot* cook = gState->cooks + cookIndex;
+            strcpy(cook->filename, request->filename);
+            AtomicStore(&cook->active, 1);
+            request->cook = cook;
+
+            JobDecl cookJob = { CookRequestJob, request };
+            jobAPI->RunJobs(&cookJob, 1, &gState->cookCounter);
         }
+    }
+}
 
-        SubresourceData bufferSubresource = {};
-        bufferSubresource.data = ((u8*) gltfBuffer->data) + gltfBufferView->offset;
-        GPUBuffer buffer = rhiAPI->CreateBuffer(&bufferSubresource, gltfBufferView->size, bufferFlags, 0);
+void AssetSystemInit(AllocatorAPI* allocatorAPI, ILinearAllocator* applicationAllocator)
+{
+    gState = (AssetAPIState*) applicationAllocator->Alloc(applicationAllocator->instance, sizeof(AssetAPIState));
+    memset(gState, 0, sizeof(AssetAPIState));
+    // Update state pointer in api
+    AssetAPI* api = (AssetAPI*) gAPIRegistry->Get(ASSET_API_NAME);
+    api->state = (void*) gState;
 
-        *(buffers + bufferIndex) = buffer;
+    for (u32 requestIndex = 0; requestIndex < MAX_ASSET_REQUEST_COUNT; ++requestIndex)
+    {
+        gState->freeRequests[requestIndex] = MAX_ASSET_REQUEST_COUNT - requestIndex - 1;
     }
+    gState->freeRequestCount = MAX_ASSET_REQUEST_COUNT;
+    gState->meshletAllocator = allocatorAPI->CreateLinearAllocator(Megabyte(256), Megabyte(1));
+
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+    ThreadAPI* threadAPI = platformAPI->threadAPI;
+    gState->ioSemaphore = threadAPI->CreatePlatformSemaphore(applicationAllocator, 0, I32Max);
+    gState->ioThread = threadAPI->CreatePlatformThread(applicationAllocator, AssetIOThreadFunction, nullptr, "Asset IO");
+}
+
+void RequestAsset(EntityContext* context, const char* filename, AssetRequestPriority priority, AssetLoadedCallback callback, void* userData)
+{
+    ASSERT(gState, "Asset API has not been initialized!");
+    ASSERT(strlen(filename) + strlen(ASSET_PACKAGE_EXTENSION) < ASSET_PACKAGE_PATH_LENGTH, "Asset path is too long");
 
-    Component meshComponent = entityAPI->RegisterComponent(entityContext, MESH_COMPONENT_NAME, sizeof(MeshComponentData));
-    Component materialComponent = entityAPI->RegisterComponent(entityContext, MATERIAL_COMPONENT_NAME, sizeof(MaterialComponentData));
-    Component transformComponent = entityAPI->RegisterComponent(entityContext, TRANSFORM_COMPONENT_NAME, sizeof(TransformComponentData));
-    Component components[3] = { meshComponent, materialComponent, transformComponent };
+    // Only the main thread requests and frees requests
+    ASSERT(gState->freeRequestCount > 0, "Too many asset requests in flight");
+    u32 requestIndex = gState->freeRequests[--gState->freeRequestCount];
+    AssetRequest* request = gState->requests + requestIndex;
+    *request = {};
+    strcpy(request->filename, filename);
+    request->context = context;
+    request->priority = priority;
+    request->callback = callback;
+    request->userData = userData;
+    request->sequence = gState->nextSequence++;
+    AtomicIncrement(&gState->activeRequestCount);
 
-    const cgltf_scene* gltfScene = data->scene;
-    u32 numNodes = gltfScene->nodes_count;
-    for (u32 nodeIndex = 0; nodeIndex < numNodes; ++nodeIndex) {
-        const cgltf_node* node = data->nodes + nodeIndex;
-        LoadNode(rhiAPI, entityAPI, data, node, components, materials, buffers, entityContext, false);
+    SpinLockAcquire(&gState->pendingLock);
+    gState->pendingRequests[gState->pendingRequestCount++] = requestIndex;
+    SpinLockRelease(&gState->pendingLock);
+
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+    platformAPI->threadAPI->SignalSemaphore(gState->ioSemaphore, 1);
+}
+
+static void FinishRequest(u32 requestIndex)
+{
+    AssetRequest* request = gState->requests + requestIndex;
+    if (request->packageFile.data)
+    {
+        PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+        platformAPI->fileAPI->UnmapFile(&request->packageFile);
+    }
+    if (request->cookAllocator)
+    {
+        AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+        allocatorAPI->DestroyLinearAllocator(request->cookAllocator);
     }
-    
 
+    *request = {};
+    gState->freeRequests[gState->freeRequestCount++] = requestIndex;
+    AtomicDecrement(&gState->activeRequestCount);
 }
 
-void LoadAsset(EntityContext* context, const char* filename)
+static bool PopCompletedRequest(u32* outRequestIndex)
+{
+    bool hasRequest = false;
+    SpinLockAcquire(&gState->completedLock);
+    if (gState->completedHead != gState->completedTail)
+    {
+        *outRequestIndex = gState->completedRequests[gState->completedHead % MAX_ASSET_REQUEST_COUNT];
+        gState->completedHead++;
+        hasRequest = true;
+    }
+    SpinLockRelease(&gState->completedLock);
+
+    return hasRequest;
+}
+
+u32 ProcessCompletedRequests(u64 timeBudgetNanoseconds)
 {
+    ASSERT(gState, "Asset API has not been initialized!");
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
     RHIAPI* rhiAPI = (RHIAPI*) gAPIRegistry->Get(RHI_API_NAME);
     EntityAPI* entityAPI = (EntityAPI*) gAPIRegistry->Get(ENTITY_API_NAME);
+    TimeAPI* timeAPI = platformAPI->timeAPI;
+
+    // At least one request is instantiated per call, so a small budget still makes progress
+    u64 startTime = timeAPI->GetPerformanceCounterTimeNanoseconds();
+    u32 processedCount = 0;
+    u32 requestIndex;
+    while (PopCompletedRequest(&requestIndex))
+    {
+        AssetRequest* request = gState->requests + requestIndex;
+        if (request->package)
+        {
+            InstantiateAssetPackage(request->package, rhiAPI, entityAPI, request->context);
+        }
+        if (request->callback)
+        {
+            request->callback(request->context, request->filename, request->package != nullptr, request->userData);
+        }
+        FinishRequest(requestIndex);
+        processedCount++;
 
-    LoadGLTFFile(filename, rhiAPI, entityAPI, context);
+        if (timeAPI->GetPerformanceCounterTimeNanoseconds() - startTime >= timeBudgetNanoseconds)
+        {
+            break;
+        }
+    }
+
+    return processedCount;
+}
+
+u32 GetActiveRequestCount()
+{
+    ASSERT(gState, "Asset API has not been initialized!");
+    return AtomicLoad(&gState->activeRequestCount);
+}
+
+const Meshlet* GetMeshlets()
+{
+    ASSERT(gState, "Asset API has not been initialized!");
+    return (const Meshlet*) gState->meshletAllocator->instance->pointer;
+}
+
+// Pending requests are dropped without callbacks
+void AssetSystemShutdown()
+{
+    ASSERT(gState, "Asset API has not been initialized!");
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+    JobAPI* jobAPI = (JobAPI*) gAPIRegistry->Get(JOB_API_NAME);
+    ThreadAPI* threadAPI = platformAPI->threadAPI;
+
+    AtomicStore(&gState->quitRequested, 1);
+    threadAPI->SignalSemaphore(gState->ioSemaphore, 1);
+    threadAPI->JoinPlatformThread(gState->ioThread);
+    jobAPI->WaitForCounter(&gState->cookCounter);
+
+    u32 requestIndex;
+    while (PopCompletedRequest(&requestIndex))
+    {
+        FinishRequest(requestIndex);
+    }
+    threadAPI->DestroyPlatformSemaphore(gState->ioSemaphore);
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    allocatorAPI->DestroyLinearAllocator(gState->meshletAllocator);
 }
 
 extern "C"
@@ -321,7 +1135,23 @@ extern "C"
     {
         gAPIRegistry = registry;
         AssetAPI assetAPI = {};
+        if (reload)
+        {
+            AssetAPI* api = (AssetAPI*) registry->Get(ASSET_API_NAME);
+            ASSERT(api, "Can't find API on reload");
+            gState = (AssetAPIState*) api->state;
+        }
+
+        assetAPI.state = (void*) gState;
+        assetAPI.Init = AssetSystemInit;
         assetAPI.LoadAsset = LoadAsset;
+        assetAPI.LoadScene = LoadScene;
+        assetAPI.CookAsset = CookAsset;
+        assetAPI.RequestAsset = RequestAsset;
+        assetAPI.ProcessCompletedRequests = ProcessCompletedRequests;
+        assetAPI.GetActiveRequestCount = GetActiveRequestCount;
+        assetAPI.GetMeshlets = GetMeshlets;
+        assetAPI.Shutdown = AssetSystemShutdown;
 
         registry->Set(ASSET_API_NAME, &assetAPI, sizeof(AssetAPI));
     }
@@ -9,6 +9,29 @@ enum VertexBuffers : uint8_t {
     VERTEX_BUFFER_COUNT
 };
 
+// Cooks vertex streams quantized: positions to 16 bit snorm relative to the mesh bounds, normals to 16 bit octahedral,
+// tangents to 10:10:10:2 and texcoords to half floats. Shaders decode them when QUANTIZED_VERTICES is defined.
+#define ASSET_QUANTIZE_VERTICES 1
+
+#if ASSET_QUANTIZE_VERTICES
+#define ASSET_VERTEX_POSITION_FORMAT FORMAT_R16G16B16A16_SNORM
+#define ASSET_VERTEX_NORMAL_FORMAT FORMAT_R16G16_SNORM
+#define ASSET_VERTEX_TEXCOORD_FORMAT FORMAT_R16G16_FLOAT
+#define ASSET_VERTEX_TANGENT_FORMAT FORMAT_R10G10B10A2_UNORM
+#else
+#define ASSET_VERTEX_POSITION_FORMAT FORMAT_R32G32B32_FLOAT
+#define ASSET_VERTEX_NORMAL_FORMAT FORMAT_R32G32B32_FLOAT
+#define ASSET_VERTEX_TEXCOORD_FORMAT FORMAT_R32G32_FLOAT
+#define ASSET_VERTEX_TANGENT_FORMAT FORMAT_R32G32B32A32_FLOAT
+#endif
+
+// Handle types of asset components in ECS snapshots. Zero is ENTITY_HANDLE_TYPE.
+enum AssetHandleType : u32
+{
+    ASSET_HANDLE_GPU_BUFFER = 1,
+    ASSET_HANDLE_SHADER_RESOURCE_VIEW = 2
+};
+
 #define MATERIAL_COMPONENT_NAME "MaterialComponent"
 struct MaterialComponentData
 {
@@ -26,13 +49,40 @@ struct MaterialComponentData
     GPUShaderResourceView emissiveTexture;
 };
 
+#define MESH_MAX_LOD_COUNT 3
+
+// Simplified version of a mesh in the same vertex and index buffers
+struct MeshLOD
+{
+    uint32_t indexStart;
+    uint32_t indexCount;
+    // Object space distance to the full mesh
+    f32 error;
+};
+
+// Meshlet limits, the sizes mesh shader pipelines work best with
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Cluster of a mesh's triangles for culling, a contiguous range of its indices. Bounds are in object space.
+// Triangle normals are within the cone around coneAxis, coneCutoff is the sine of its half angle, 1 if it can't be back face culled.
+struct Meshlet
+{
+    BoundingSphere bounds;
+    Vector3 coneAxis;
+    f32 coneCutoff;
+    uint32_t indexStart;
+    uint32_t indexCount;
+};
+
 #define MESH_COMPONENT_NAME "MeshComponent"
 struct MeshComponentData
 {
     GPUBuffer vertexBuffers[VertexBuffers::VERTEX_BUFFER_COUNT];
     uint32_t vertexStrides[VertexBuffers::VERTEX_BUFFER_COUNT] = {0};
     uint32_t vertexOffsets[VertexBuffers::VERTEX_BUFFER_COUNT] = {0};
-
+    // Added to the indices, meshes of a scene load share the buffers
+    uint32_t baseVertex = 0;
 
     GPUBuffer indexBuffer;
     uint32_t indexBufferStride = 0;
@@ -40,21 +90,98 @@ struct MeshComponentData
 
     uint32_t indexStart = 0;
     uint32_t indexCount = 0;
+
+    // From the most detailed, the full mesh is indexStart and indexCount
+    MeshLOD lods[MESH_MAX_LOD_COUNT];
+    uint32_t lodCount = 0;
+
+    // Meshlets of the full mesh, in the table of AssetAPI::GetMeshlets
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+
+    // Object space position is positionOffset + vertex position * positionScale
+    Vector3 positionScale;
+    Vector3 positionOffset;
 };
 
+// Local transform, relative to the parent if the entity has a ParentComponent.
+// Set dirty and call MarkComponentChanged after changing it, so the entity and its children are updated.
 #define TRANSFORM_COMPONENT_NAME "TransformComponent"
 struct TransformComponentData
 {
     Vector3 scale;
     Vector3 translation;
-    Vector4 orientation;
+    Quaternion orientation;
+    bool dirty;
+};
+
+// Children of the same parent are linked with nextSibling
+#define PARENT_COMPONENT_NAME "ParentComponent"
+struct ParentComponentData
+{
+    Entity parent;
+    Entity nextSibling;
+};
+
+#define CHILDREN_COMPONENT_NAME "ChildrenComponent"
+struct ChildrenComponentData
+{
+    Entity firstChild;
+    u32 childCount;
+};
+
+#define WORLD_MATRIX_COMPONENT_NAME "WorldMatrixComponent"
+struct WorldMatrixComponentData
+{
+    Matrix3x4 worldMatrix;
+};
+
+// Local bounds come from the mesh, world bounds are computed by the bounds system each frame
+#define BOUNDS_COMPONENT_NAME "BoundsComponent"
+struct BoundsComponentData
+{
+    AABB localBounds;
+    AABB worldBounds;
 };
 
 struct EntityContext;
+struct AllocatorAPI;
+struct ILinearAllocator;
 
 #define ASSET_API_NAME "AssetAPI"
 
+// Requests with higher priority are read first
+enum AssetRequestPriority : u32
+{
+    ASSET_REQUEST_PRIORITY_HIGH,
+    ASSET_REQUEST_PRIORITY_NORMAL,
+    ASSET_REQUEST_PRIORITY_LOW
+};
+
+// Called on the main thread after the entities of the asset are created. Loaded is false if the asset couldn't be loaded.
+typedef void (*AssetLoadedCallback)(EntityContext* entityContext, const char* filename, bool loaded, void* userData);
+
 struct AssetAPI
 {
+    void* state;
+
+    void (*Init)(AllocatorAPI* allocatorAPI, ILinearAllocator* applicationAllocator);
+    // glTF files are loaded from a cooked package next to them, which is cooked first if it's missing or stale.
+    // Packages can be loaded directly too.
     void (*LoadAsset)(EntityContext* entityContext, const char* filename);
+    // Loads every glTF file or package matching the pattern, like LoadAsset. Their vertices and indices are put into a few shared buffers,
+    // so their meshes are drawn without rebinding buffers. Returns the loaded file count.
+    u32 (*LoadScene)(EntityContext* entityContext, const char* pattern);
+    // Cooks a glTF file offline. Returns false if the file can't be parsed or the package can't be written.
+    bool (*CookAsset)(const char* sourceFilename, const char* packageFilename);
+
+    // Loads the asset in the background. Packages are read on an I/O thread and cooked on job workers if needed.
+    void (*RequestAsset)(EntityContext* entityContext, const char* filename, AssetRequestPriority priority, AssetLoadedCallback callback, void* userData);
+    // Creates the entities of loaded requests until the budget runs out, call it once per frame. Returns the processed request count.
+    u32 (*ProcessCompletedRequests)(u64 timeBudgetNanoseconds);
+    // Requests that are not processed yet
+    u32 (*GetActiveRequestCount)();
+    // Meshlets of every loaded mesh, indexed by MeshComponentData::firstMeshlet. Index starts are in the mesh's index buffer.
+    const Meshlet* (*GetMeshlets)();
+    void (*Shutdown)();
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+struct JobAPI;
+struct FileAPI;
+
+// Cooked asset package. Data is ready for upload, loading a package is mapping the file and creating GPU resources from it.
+// Layout, offsets are relative to the start of the package:
+// AssetPackageHeader
+// AssetPackageDependency[dependencyCount]
+// AssetPackageTexture[textureCount]
+// AssetPackageMaterial[materialCount]
+// AssetPackageMesh[meshCount]
+// AssetPackageNode[nodeCount]
+// u32 root node indices[rootNodeCount]
+// u32 child node indices[childNodeCount]
+// Vertex, index, meshlet and texture data, every block starts at ASSET_PACKAGE_ALIGNMENT
+#define ASSET_PACKAGE_MAGIC 0x4B504D49 // IMPK
+#define ASSET_PACKAGE_VERSION 6
+#define ASSET_PACKAGE_ALIGNMENT 64
+#define ASSET_PACKAGE_PATH_LENGTH 256
+#define ASSET_PACKAGE_EXTENSION ".imgepkg"
+
+// Header flags
+#define ASSET_PACKAGE_FLAG_QUANTIZED_VERTICES 0x1
+
+// Same order as the textures of MaterialComponentData
+enum AssetMaterialTexture
+{
+    ASSET_MATERIAL_TEXTURE_BASE_COLOR,
+    ASSET_MATERIAL_TEXTURE_ROUGHNESS,
+    ASSET_MATERIAL_TEXTURE_METALLIC,
+    ASSET_MATERIAL_TEXTURE_ROUGHNESS_METALLIC,
+    ASSET_MATERIAL_TEXTURE_OCCLUSION,
+    ASSET_MATERIAL_TEXTURE_NORMAL_MAP,
+    ASSET_MATERIAL_TEXTURE_EMISSIVE,
+
+    ASSET_MATERIAL_TEXTURE_COUNT
+};
+
+struct AssetPackageHeader
+{
+    u32 magic;
+    u32 version;
+    // XXH64 of the dependency stamps. The package is stale when the source files don't hash to the same key.
+    u64 sourceKey;
+    u32 dependencyCount;
+    u32 textureCount;
+    u32 materialCount;
+    u32 meshCount;
+    u32 nodeCount;
+    u32 rootNodeCount;
+    u32 childNodeCount;
+    u32 flags;
+    u64 vertexDataOffset;
+    u64 vertexDataSize;
+    u64 indexDataOffset;
+    u64 indexDataSize;
+    // Meshlet[], index starts are relative to their mesh's first index
+    u64 meshletDataOffset;
+    u64 meshletDataSize;
+    u64 size;
+};
+
+// Source file the package was cooked from
+struct AssetPackageDependency
+{
+    char path[ASSET_PACKAGE_PATH_LENGTH];
+    u64 size;
+    u64 lastWriteTime;
+};
+
+// Mips are stored one after another, starting from the largest. Block compressed mips are rows of 4x4 blocks.
+struct AssetPackageTexture
+{
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 mipCount;
+    u64 dataOffset;
+    u64 dataSize;
+};
+
+struct AssetPackageMaterial
+{
+    Vector4 baseColor;
+    Vector4 emissiveColor;
+    f32 roughness;
+    f32 metallic;
+    // NULL_INDEX if the material doesn't have the texture
+    u32 textures[ASSET_MATERIAL_TEXTURE_COUNT];
+};
+
+// Indices of a simplified mesh, with the stride of the full mesh's indices
+struct AssetPackageMeshLOD
+{
+    u32 indexOffset;
+    u32 indexCount;
+    f32 error;
+};
+
+// A glTF primitive. Offsets are relative to the vertex and index data, missing vertex streams have zero stride.
+// Indices are ordered for the vertex cache and overdraw, then grouped by meshlet. Vertices are in the order of their first use.
+// Stream formats are the ASSET_VERTEX_*_FORMATs, positions are dequantized with positionScale and positionOffset.
+struct AssetPackageMesh
+{
+    u32 vertexOffsets[VERTEX_BUFFER_COUNT];
+    u32 vertexStrides[VERTEX_BUFFER_COUNT];
+    u32 vertexCount;
+    u32 indexOffset;
+    u32 indexStride;
+    u32 indexCount;
+    u32 materialIndex;
+    AABB bounds;
+    Vector3 positionScale;
+    Vector3 positionOffset;
+    u32 lodCount;
+    AssetPackageMeshLOD lods[MESH_MAX_LOD_COUNT];
+    // Meshlets of the full mesh, LODs are drawn whole
+    u32 firstMeshlet;
+    u32 meshletCount;
+};
+
+// Meshes of a node are the primitives of its glTF mesh
+struct AssetPackageNode
+{
+    Vector3 translation;
+    Vector3 scale;
+    Quaternion orientation;
+    u32 firstMesh;
+    u32 meshCount;
+    u32 firstChild;
+    u32 childCount;
+};
+
+// Row pitch and size of a texture mip
+void GetAssetTextureMipLayout(u32 format, u32 width, u32 height, u32 mip, u32* outPitch, u64* outSize);
+
+// Stamps the dependencies with their current size and write time and hashes them.
+// Returns false if one of them doesn't exist anymore.
+bool ComputeAssetPackageSourceKey(FileAPI* fileAPI, AssetPackageDependency* dependencies, u32 dependencyCount, u64* outKey);
+
+// Cooks a glTF file and its buffers and images into a package, nullptr if the file can't be parsed
+void* CookGLTFFile(const char* filepath, JobAPI* jobAPI, FileAPI* fileAPI, ILinearAllocator* allocator, u64* outSize);
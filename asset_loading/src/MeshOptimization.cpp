@@ -0,0 +1,1127 @@
+#include "pch.h"
+#include "ecs.h"
+#include "RHI.h"
+#include "AssetLoading.h"
+#include "MeshOptimization.h"
+
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_MAX_VALENCE 32
+// FIFO size of the simulated cache when splitting clusters for overdraw
+#define OVERDRAW_CACHE_SIZE 16
+// Triangles join a meshlet within about 45 degrees of its mean normal, so the cones stay narrow enough to cull
+#define MESHLET_MIN_NORMAL_DOT 0.7f
+
+static f32 gCachePositionScores[FORSYTH_CACHE_SIZE];
+static f32 gValenceScores[FORSYTH_MAX_VALENCE];
+static volatile u32 gScoreTablesInitialized = 0;
+
+static void InitScoreTables()
+{
+    if (AtomicLoad(&gScoreTablesInitialized))
+    {
+        return;
+    }
+
+    // Vertices of the last triangle get a fixed score so the next triangle doesn't just reuse them
+    for (u32 position = 0; position < FORSYTH_CACHE_SIZE; ++position)
+    {
+        gCachePositionScores[position] = position < 3 ? 0.75f : powf(1.0f - (f32) (position - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+
+    // Vertices with few remaining triangles are preferred, so they leave the mesh
+    gValenceScores[0] = 0.0f;
+    for (u32 valence = 1; valence < FORSYTH_MAX_VALENCE; ++valence)
+    {
+        gValenceScores[valence] = 2.0f / sqrtf((f32) valence);
+    }
+    AtomicStore(&gScoreTablesInitialized, 1);
+}
+
+static f32 GetVertexScore(i32 cachePosition, u32 remainingValence)
+{
+    if (remainingValence == 0)
+    {
+        return -1.0f;
+    }
+
+    f32 score = cachePosition >= 0 ? gCachePositionScores[cachePosition] : 0.0f;
+    return score + gValenceScores[remainingValence < FORSYTH_MAX_VALENCE ? remainingValence : FORSYTH_MAX_VALENCE - 1];
+}
+
+void OptimizeVertexCache(u32* indices, u32 indexCount, u32 vertexCount)
+{
+    InitScoreTables();
+    u32 triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles of every vertex, emitted triangles are swapped to the end of the vertex's range
+    u32* vertexTriangleOffsets = (u32*) calloc(vertexCount + 1, sizeof(u32));
+    u32* vertexRemainingCounts = (u32*) calloc(vertexCount, sizeof(u32));
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        vertexRemainingCounts[indices[index]]++;
+    }
+    for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        vertexTriangleOffsets[vertex + 1] = vertexTriangleOffsets[vertex] + vertexRemainingCounts[vertex];
+        vertexRemainingCounts[vertex] = 0;
+    }
+    u32* vertexTriangles = (u32*) malloc(sizeof(u32) * indexCount);
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        u32 vertex = indices[index];
+        vertexTriangles[vertexTriangleOffsets[vertex] + vertexRemainingCounts[vertex]++] = index / 3;
+    }
+
+    i32* vertexCachePositions = (i32*) malloc(sizeof(i32) * vertexCount);
+    f32* vertexScores = (f32*) malloc(sizeof(f32) * vertexCount);
+    for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        vertexCachePositions[vertex] = -1;
+        vertexScores[vertex] = GetVertexScore(-1, vertexRemainingCounts[vertex]);
+    }
+
+    f32* triangleScores = (f32*) malloc(sizeof(f32) * triangleCount);
+    bool* trianglesEmitted = (bool*) calloc(triangleCount, sizeof(bool));
+    for (u32 triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const u32* triangleIndices = indices + triangle * 3;
+        triangleScores[triangle] = vertexScores[triangleIndices[0]] + vertexScores[triangleIndices[1]] + vertexScores[triangleIndices[2]];
+    }
+
+    u32* outIndices = (u32*) malloc(sizeof(u32) * indexCount);
+    u32 cache[FORSYTH_CACHE_SIZE + 3];
+    u32 cacheCount = 0;
+    u32 nextTriangleCursor = 0;
+
+    u32 bestTriangle = 0;
+    for (u32 triangle = 1; triangle < triangleCount; ++triangle)
+    {
+        bestTriangle = triangleScores[triangle] > triangleScores[bestTriangle] ? triangle : bestTriangle;
+    }
+
+    for (u32 emitted = 0; emitted < triangleCount; ++emitted)
+    {
+        if (bestTriangle == NULL_INDEX)
+        {
+            // Nothing in the cache has triangles left, continue from the first remaining triangle
+            while (trianglesEmitted[nextTriangleCursor])
+            {
+                nextTriangleCursor++;
+            }
+            bestTriangle = nextTriangleCursor;
+        }
+
+        const u32* triangleIndices = indices + bestTriangle * 3;
+        memcpy(outIndices + emitted * 3, triangleIndices, sizeof(u32) * 3);
+        trianglesEmitted[bestTriangle] = true;
+
+        // Remove the triangle from its vertices
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            u32 vertex = triangleIndices[corner];
+            u32* triangles = vertexTriangles + vertexTriangleOffsets[vertex];
+            u32 remaining = vertexRemainingCounts[vertex];
+            for (u32 triangle = 0; triangle < remaining; ++triangle)
+            {
+                if (triangles[triangle] == bestTriangle)
+                {
+                    triangles[triangle] = triangles[remaining - 1];
+                    triangles[remaining - 1] = bestTriangle;
+                    break;
+                }
+            }
+            vertexRemainingCounts[vertex]--;
+        }
+
+        // Triangle's vertices move to the front of the LRU cache
+        u32 newCache[FORSYTH_CACHE_SIZE + 3];
+        u32 newCacheCount = 0;
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            newCache[newCacheCount++] = triangleIndices[corner];
+        }
+        for (u32 cacheIndex = 0; cacheIndex < cacheCount; ++cacheIndex)
+        {
+            u32 vertex = cache[cacheIndex];
+            if (vertex != triangleIndices[0] && vertex != triangleIndices[1] && vertex != triangleIndices[2])
+            {
+                newCache[newCacheCount++] = vertex;
+            }
+        }
+
+        // Update the scores of every vertex that was or is in the cache, then their triangles
+        for (u32 cacheIndex = 0; cacheIndex < newCacheCount; ++cacheIndex)
+        {
+            u32 vertex = newCache[cacheIndex];
+            vertexCachePositions[vertex] = cacheIndex < FORSYTH_CACHE_SIZE ? (i32) cacheIndex : -1;
+            vertexScores[vertex] = GetVertexScore(vertexCachePositions[vertex], vertexRemainingCounts[vertex]);
+        }
+
+        bestTriangle = NULL_INDEX;
+        f32 bestScore = -F32Max;
+        for (u32 cacheIndex = 0; cacheIndex < newCacheCount; ++cacheIndex)
+        {
+            u32 vertex = newCache[cacheIndex];
+            const u32* triangles = vertexTriangles + vertexTriangleOffsets[vertex];
+            for (u32 triangle = 0; triangle < vertexRemainingCounts[vertex]; ++triangle)
+            {
+                u32 adjacentTriangle = triangles[triangle];
+                const u32* adjacentIndices = indices + adjacentTriangle * 3;
+                f32 score = vertexScores[adjacentIndices[0]] + vertexScores[adjacentIndices[1]] + vertexScores[adjacentIndices[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = adjacentTriangle;
+                }
+            }
+        }
+
+        cacheCount = newCacheCount < FORSYTH_CACHE_SIZE ? newCacheCount : FORSYTH_CACHE_SIZE;
+        memcpy(cache, newCache, sizeof(u32) * cacheCount);
+    }
+
+    memcpy(indices, outIndices, sizeof(u32) * indexCount);
+
+    free(outIndices);
+    free(trianglesEmitted);
+    free(triangleScores);
+    free(vertexScores);
+    free(vertexCachePositions);
+    free(vertexTriangles);
+    free(vertexRemainingCounts);
+    free(vertexTriangleOffsets);
+}
+
+struct OverdrawCluster
+{
+    u32 firstIndex;
+    u32 indexCount;
+    f32 sortKey;
+};
+
+static int CompareOverdrawClusters(const void* left, const void* right)
+{
+    const OverdrawCluster* leftCluster = (const OverdrawCluster*) left;
+    const OverdrawCluster* rightCluster = (const OverdrawCluster*) right;
+    if (leftCluster->sortKey != rightCluster->sortKey)
+    {
+        return leftCluster->sortKey > rightCluster->sortKey ? -1 : 1;
+    }
+    // Keep the vertex cache order of equal clusters
+    return leftCluster->firstIndex < rightCluster->firstIndex ? -1 : 1;
+}
+
+// Clusters split where the vertex cache order restarts, so reordering them costs little cache efficiency (Sander et al. 2007).
+// Clusters facing away from the mesh center are more likely to occlude the rest, they are drawn first.
+void OptimizeOverdraw(u32* indices, u32 indexCount, const f32* positions, u32 vertexCount)
+{
+    u32 triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    OverdrawCluster* clusters = (OverdrawCluster*) malloc(sizeof(OverdrawCluster) * triangleCount);
+    u32 clusterCount = 0;
+    u32* cacheTimestamps = (u32*) calloc(vertexCount, sizeof(u32));
+    u32 timestamp = OVERDRAW_CACHE_SIZE + 1;
+    for (u32 triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        u32 missCount = 0;
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            u32 vertex = indices[triangle * 3 + corner];
+            if (timestamp - cacheTimestamps[vertex] > OVERDRAW_CACHE_SIZE)
+            {
+                cacheTimestamps[vertex] = timestamp++;
+                missCount++;
+            }
+        }
+
+        if (clusterCount == 0 || missCount == 3)
+        {
+            clusters[clusterCount++] = OverdrawCluster { triangle * 3, 0, 0.0f };
+        }
+        clusters[clusterCount - 1].indexCount += 3;
+    }
+    free(cacheTimestamps);
+
+    if (clusterCount == 1)
+    {
+        free(clusters);
+        return;
+    }
+
+    // Area weighted mesh centroid
+    Vector3 meshCentroid = Vector3(0.0f, 0.0f, 0.0f);
+    f32 meshArea = 0.0f;
+    for (u32 index = 0; index < indexCount; index += 3)
+    {
+        Vector3 a = Vector3(positions[indices[index] * 3], positions[indices[index] * 3 + 1], positions[indices[index] * 3 + 2]);
+        Vector3 b = Vector3(positions[indices[index + 1] * 3], positions[indices[index + 1] * 3 + 1], positions[indices[index + 1] * 3 + 2]);
+        Vector3 c = Vector3(positions[indices[index + 2] * 3], positions[indices[index + 2] * 3 + 1], positions[indices[index + 2] * 3 + 2]);
+        f32 area = Lenght(CrossProduct(b - a, c - a));
+        meshCentroid = meshCentroid + (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid * (1.0f / meshArea) : meshCentroid;
+
+    for (u32 clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex)
+    {
+        OverdrawCluster* cluster = clusters + clusterIndex;
+        Vector3 centroid = Vector3(0.0f, 0.0f, 0.0f);
+        Vector3 normal = Vector3(0.0f, 0.0f, 0.0f);
+        f32 area = 0.0f;
+        for (u32 index = cluster->firstIndex; index < cluster->firstIndex + cluster->indexCount; index += 3)
+        {
+            Vector3 a = Vector3(positions[indices[index] * 3], positions[indices[index] * 3 + 1], positions[indices[index] * 3 + 2]);
+            Vector3 b = Vector3(positions[indices[index + 1] * 3], positions[indices[index + 1] * 3 + 1], positions[indices[index + 1] * 3 + 2]);
+            Vector3 c = Vector3(positions[indices[index + 2] * 3], positions[indices[index + 2] * 3 + 1], positions[indices[index + 2] * 3 + 2]);
+            Vector3 areaNormal = CrossProduct(b - a, c - a);
+            f32 triangleArea = Lenght(areaNormal);
+            centroid = centroid + (a + b + c) * (triangleArea / 3.0f);
+            normal = normal + areaNormal;
+            area += triangleArea;
+        }
+
+        f32 normalLength = Lenght(normal);
+        if (area > 0.0f && normalLength > 0.0f)
+        {
+            centroid = centroid * (1.0f / area);
+            cluster->sortKey = DotProduct(centroid - meshCentroid, normal * (1.0f / normalLength));
+        }
+    }
+
+    qsort(clusters, clusterCount, sizeof(OverdrawCluster), CompareOverdrawClusters);
+
+    u32* outIndices = (u32*) malloc(sizeof(u32) * indexCount);
+    u32 outIndexCount = 0;
+    for (u32 clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex)
+    {
+        memcpy(outIndices + outIndexCount, indices + clusters[clusterIndex].firstIndex, sizeof(u32) * clusters[clusterIndex].indexCount);
+        outIndexCount += clusters[clusterIndex].indexCount;
+    }
+    memcpy(indices, outIndices, sizeof(u32) * outIndexCount);
+
+    free(outIndices);
+    free(clusters);
+}
+
+u32 OptimizeVertexFetch(u32* indices, u32 indexCount, u32 vertexCount, u32* outRemap)
+{
+    memset(outRemap, 0xFF, sizeof(u32) * vertexCount);
+    u32 usedVertexCount = 0;
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        u32 vertex = indices[index];
+        if (outRemap[vertex] == NULL_INDEX)
+        {
+            outRemap[vertex] = usedVertexCount++;
+        }
+        indices[index] = outRemap[vertex];
+    }
+
+    return usedVertexCount;
+}
+
+// Open edges are held in place by planes perpendicular to their triangles, weighted over the triangle planes
+#define SIMPLIFY_EDGE_WEIGHT 10.0f
+// More than one edge or vertex matched
+#define SIMPLIFY_MULTIPLE (NULL_INDEX - 1)
+
+// Kinds of positions. Border positions are on one open edge loop of the welded mesh and only collapse along it,
+// locked positions are on more than one and never collapse.
+enum SimplifyPositionKind : u8
+{
+    SIMPLIFY_POSITION_MANIFOLD,
+    SIMPLIFY_POSITION_BORDER,
+    SIMPLIFY_POSITION_LOCKED
+};
+
+struct Quadric
+{
+    f32 a00, a11, a22;
+    f32 a10, a20, a21;
+    f32 b0, b1, b2;
+    f32 c;
+    f32 weight;
+};
+
+static void AddPlaneQuadric(Quadric* quadric, Vector3 normal, f32 distance, f32 weight)
+{
+    quadric->a00 += weight * normal.x * normal.x;
+    quadric->a11 += weight * normal.y * normal.y;
+    quadric->a22 += weight * normal.z * normal.z;
+    quadric->a10 += weight * normal.y * normal.x;
+    quadric->a20 += weight * normal.z * normal.x;
+    quadric->a21 += weight * normal.z * normal.y;
+    quadric->b0 += weight * normal.x * distance;
+    quadric->b1 += weight * normal.y * distance;
+    quadric->b2 += weight * normal.z * distance;
+    quadric->c += weight * distance * distance;
+    quadric->weight += weight;
+}
+
+static void AddQuadric(Quadric* quadric, const Quadric& other)
+{
+    quadric->a00 += other.a00;
+    quadric->a11 += other.a11;
+    quadric->a22 += other.a22;
+    quadric->a10 += other.a10;
+    quadric->a20 += other.a20;
+    quadric->a21 += other.a21;
+    quadric->b0 += other.b0;
+    quadric->b1 += other.b1;
+    quadric->b2 += other.b2;
+    quadric->c += other.c;
+    quadric->weight += other.weight;
+}
+
+// Weighted mean of the squared distances of the point to the planes
+static f32 GetQuadricError(const Quadric& quadric, Vector3 point)
+{
+    f32 rx = quadric.a00 * point.x + quadric.a10 * point.y + quadric.a20 * point.z + quadric.b0;
+    f32 ry = quadric.a10 * point.x + quadric.a11 * point.y + quadric.a21 * point.z + quadric.b1;
+    f32 rz = quadric.a20 * point.x + quadric.a21 * point.y + quadric.a22 * point.z + quadric.b2;
+    f32 error = rx * point.x + ry * point.y + rz * point.z + quadric.b0 * point.x + quadric.b1 * point.y + quadric.b2 * point.z + quadric.c;
+    return quadric.weight > 0.0f ? fabsf(error) / quadric.weight : 0.0f;
+}
+
+// Triangles of every vertex, as ranges of a shared list
+static void BuildVertexTriangles(const u32* indices, u32 indexCount, u32 vertexCount, u32* outOffsets, u32* outTriangles)
+{
+    memset(outOffsets, 0, sizeof(u32) * (vertexCount + 1));
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        outOffsets[indices[index] + 1]++;
+    }
+    for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        outOffsets[vertex + 1] += outOffsets[vertex];
+    }
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        outTriangles[outOffsets[indices[index]]++] = index / 3;
+    }
+    // Offsets were advanced to the range ends, shift them back
+    for (u32 vertex = vertexCount; vertex > 0; --vertex)
+    {
+        outOffsets[vertex] = outOffsets[vertex - 1];
+    }
+    outOffsets[0] = 0;
+}
+
+static bool HasEdge(const u32* indices, const u32* vertexTriangleOffsets, const u32* vertexTriangles, u32 from, u32 to)
+{
+    for (u32 offset = vertexTriangleOffsets[from]; offset < vertexTriangleOffsets[from + 1]; ++offset)
+    {
+        const u32* triangle = indices + vertexTriangles[offset] * 3;
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            if (triangle[corner] == from && triangle[(corner + 1) % 3] == to)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Vertices with the same position, as a map to the first one and a circular list of the copies
+static void BuildPositionWedges(const f32* positions, u32 vertexCount, u32* outRemap, u32* outWedges)
+{
+    u32 tableSize = 1;
+    while (tableSize < vertexCount * 2)
+    {
+        tableSize *= 2;
+    }
+    u32* table = (u32*) malloc(sizeof(u32) * tableSize);
+    memset(table, 0xFF, sizeof(u32) * tableSize);
+
+    for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        const f32* position = positions + vertex * 3;
+        u32 bits[3];
+        memcpy(bits, position, sizeof(bits));
+        u32 slot = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) & (tableSize - 1);
+        while (table[slot] != NULL_INDEX && memcmp(positions + table[slot] * 3, position, sizeof(f32) * 3) != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot] == NULL_INDEX)
+        {
+            table[slot] = vertex;
+            outRemap[vertex] = vertex;
+            outWedges[vertex] = vertex;
+        }
+        else
+        {
+            u32 first = table[slot];
+            outRemap[vertex] = first;
+            outWedges[vertex] = outWedges[first];
+            outWedges[first] = vertex;
+        }
+    }
+
+    free(table);
+}
+
+struct SimplifyState
+{
+    const u32* remap;
+    const u32* wedges;
+    const Vector3* positions;
+    // Per position, indexed by the remap
+    SimplifyPositionKind* kinds;
+    u32* borderOut;
+    u32* borderIn;
+    Quadric* quadrics;
+
+    // Current triangles
+    const u32* indices;
+    u32* vertexTriangleOffsets;
+    u32* vertexTriangles;
+};
+
+// Copy of the position that shares an edge with the vertex. Copies have different attributes, a vertex can only move to
+// the copy on its side of the attribute seam.
+static u32 FindAdjacentCopy(const SimplifyState& state, u32 vertex, u32 position)
+{
+    u32 result = NULL_INDEX;
+    for (u32 offset = state.vertexTriangleOffsets[vertex]; offset < state.vertexTriangleOffsets[vertex + 1]; ++offset)
+    {
+        const u32* triangle = state.indices + state.vertexTriangles[offset] * 3;
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            if (state.remap[triangle[corner]] == position && triangle[corner] != result)
+            {
+                result = result == NULL_INDEX ? triangle[corner] : SIMPLIFY_MULTIPLE;
+            }
+        }
+    }
+    return result;
+}
+
+static bool IsVertexUsed(const SimplifyState& state, u32 vertex)
+{
+    return state.vertexTriangleOffsets[vertex] != state.vertexTriangleOffsets[vertex + 1];
+}
+
+// Every used copy of the position collapses to its adjacent copy of the target
+static bool CanCollapse(const SimplifyState& state, u32 from, u32 to)
+{
+    u32 fromPosition = state.remap[from];
+    u32 toPosition = state.remap[to];
+    SimplifyPositionKind kind = state.kinds[fromPosition];
+    if (kind == SIMPLIFY_POSITION_LOCKED)
+    {
+        return false;
+    }
+    if (kind == SIMPLIFY_POSITION_BORDER && (state.kinds[toPosition] != SIMPLIFY_POSITION_BORDER ||
+                                             (state.borderOut[fromPosition] != toPosition && state.borderIn[fromPosition] != toPosition)))
+    {
+        return false;
+    }
+
+    u32 copy = from;
+    do
+    {
+        if (IsVertexUsed(state, copy))
+        {
+            u32 target = FindAdjacentCopy(state, copy, toPosition);
+            if (target == NULL_INDEX || target == SIMPLIFY_MULTIPLE)
+            {
+                return false;
+            }
+        }
+        copy = state.wedges[copy];
+    } while (copy != from);
+    return true;
+}
+
+static f32 GetCollapseCost(const SimplifyState& state, u32 from, u32 to)
+{
+    Quadric quadric = state.quadrics[state.remap[from]];
+    AddQuadric(&quadric, state.quadrics[state.remap[to]]);
+    return GetQuadricError(quadric, state.positions[to]);
+}
+
+// Moving the vertex to the position mustn't turn any of its remaining triangles over
+static bool HasTriangleFlips(const SimplifyState& state, const u32* collapseRemap, u32 vertex, u32 to)
+{
+    u32 toPosition = state.remap[to];
+    for (u32 offset = state.vertexTriangleOffsets[vertex]; offset < state.vertexTriangleOffsets[vertex + 1]; ++offset)
+    {
+        const u32* triangle = state.indices + state.vertexTriangles[offset] * 3;
+        u32 corners[3] = { collapseRemap[triangle[0]], collapseRemap[triangle[1]], collapseRemap[triangle[2]] };
+        if (state.remap[corners[0]] == toPosition || state.remap[corners[1]] == toPosition || state.remap[corners[2]] == toPosition)
+        {
+            continue;
+        }
+
+        Vector3 a = state.positions[corners[0]];
+        Vector3 b = state.positions[corners[1]];
+        Vector3 c = state.positions[corners[2]];
+        Vector3 normal = CrossProduct(b - a, c - a);
+        a = triangle[0] == vertex ? state.positions[to] : a;
+        b = triangle[1] == vertex ? state.positions[to] : b;
+        c = triangle[2] == vertex ? state.positions[to] : c;
+        if (DotProduct(normal, CrossProduct(b - a, c - a)) <= 0.0f)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The neighbour of the collapsed position on its border loop becomes the neighbour of the target
+static void CollapseBorderEdge(SimplifyState& state, u32 fromPosition, u32 toPosition)
+{
+    if (state.borderOut[fromPosition] == toPosition)
+    {
+        u32 previous = state.borderIn[fromPosition];
+        state.borderIn[toPosition] = previous;
+        if (state.kinds[previous] == SIMPLIFY_POSITION_BORDER)
+        {
+            state.borderOut[previous] = toPosition;
+        }
+    }
+    else
+    {
+        u32 next = state.borderOut[fromPosition];
+        state.borderOut[toPosition] = next;
+        if (state.kinds[next] == SIMPLIFY_POSITION_BORDER)
+        {
+            state.borderIn[next] = toPosition;
+        }
+    }
+}
+
+struct EdgeCollapse
+{
+    u32 from;
+    u32 to;
+    f32 cost;
+};
+
+static int CompareEdgeCollapses(const void* left, const void* right)
+{
+    f32 leftCost = ((const EdgeCollapse*) left)->cost;
+    f32 rightCost = ((const EdgeCollapse*) right)->cost;
+    return leftCost < rightCost ? -1 : (leftCost > rightCost ? 1 : 0);
+}
+
+// Collapses are done in passes: the cheapest collapse of every edge is picked, the ones that don't touch a position
+// collapsed earlier in the pass are applied, then the indices are rewritten.
+u32 SimplifyMesh(u32* outIndices, const u32* indices, u32 indexCount, const f32* positions, u32 vertexCount, u32 targetIndexCount, f32 targetError, f32* outError)
+{
+    u32* remap = (u32*) malloc(sizeof(u32) * vertexCount);
+    u32* wedges = (u32*) malloc(sizeof(u32) * vertexCount);
+    BuildPositionWedges(positions, vertexCount, remap, wedges);
+
+    // Drop triangles that are already degenerate
+    u32 currentIndexCount = 0;
+    for (u32 index = 0; index < indexCount; index += 3)
+    {
+        u32 a = remap[indices[index]], b = remap[indices[index + 1]], c = remap[indices[index + 2]];
+        if (a != b && b != c && c != a)
+        {
+            memcpy(outIndices + currentIndexCount, indices + index, sizeof(u32) * 3);
+            currentIndexCount += 3;
+        }
+    }
+
+    *outError = 0.0f;
+    if (currentIndexCount <= targetIndexCount)
+    {
+        free(wedges);
+        free(remap);
+        return currentIndexCount;
+    }
+
+    // Errors are computed in the unit cube of the mesh
+    Vector3 minPoint = Vector3(F32Max);
+    Vector3 maxPoint = Vector3(-F32Max);
+    for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        const f32* position = positions + vertex * 3;
+        minPoint = Vector3(fminf(minPoint.x, position[0]), fminf(minPoint.y, position[1]), fminf(minPoint.z, position[2]));
+        maxPoint = Vector3(fmaxf(maxPoint.x, position[0]), fmaxf(maxPoint.y, position[1]), fmaxf(maxPoint.z, position[2]));
+    }
+    f32 extent = fmaxf(fmaxf(maxPoint.x - minPoint.x, maxPoint.y - minPoint.y), maxPoint.z - minPoint.z);
+    f32 scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+    Vector3* scaledPositions = (Vector3*) malloc(sizeof(Vector3) * vertexCount);
+    for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        const f32* position = positions + vertex * 3;
+        scaledPositions[vertex] = Vector3(position[0] - minPoint.x, position[1] - minPoint.y, position[2] - minPoint.z) * scale;
+    }
+
+    SimplifyState state;
+    state.remap = remap;
+    state.wedges = wedges;
+    state.positions = scaledPositions;
+    state.kinds = (SimplifyPositionKind*) malloc(sizeof(SimplifyPositionKind) * vertexCount);
+    state.borderOut = (u32*) malloc(sizeof(u32) * vertexCount);
+    state.borderIn = (u32*) malloc(sizeof(u32) * vertexCount);
+    state.quadrics = (Quadric*) calloc(vertexCount, sizeof(Quadric));
+    state.indices = outIndices;
+    state.vertexTriangleOffsets = (u32*) malloc(sizeof(u32) * (vertexCount + 1));
+    state.vertexTriangles = (u32*) malloc(sizeof(u32) * currentIndexCount);
+    memset(state.borderOut, 0xFF, sizeof(u32) * vertexCount);
+    memset(state.borderIn, 0xFF, sizeof(u32) * vertexCount);
+
+    // Border edges are open in the welded mesh, attribute seams are open only between the copies
+    u32* weldedIndices = (u32*) malloc(sizeof(u32) * currentIndexCount);
+    for (u32 index = 0; index < currentIndexCount; ++index)
+    {
+        weldedIndices[index] = remap[outIndices[index]];
+    }
+    BuildVertexTriangles(weldedIndices, currentIndexCount, vertexCount, state.vertexTriangleOffsets, state.vertexTriangles);
+    for (u32 index = 0; index < currentIndexCount; ++index)
+    {
+        u32 from = weldedIndices[index];
+        u32 to = weldedIndices[index - index % 3 + (index + 1) % 3];
+        if (!HasEdge(weldedIndices, state.vertexTriangleOffsets, state.vertexTriangles, to, from))
+        {
+            state.borderOut[from] = state.borderOut[from] == NULL_INDEX ? to : SIMPLIFY_MULTIPLE;
+            state.borderIn[to] = state.borderIn[to] == NULL_INDEX ? from : SIMPLIFY_MULTIPLE;
+        }
+    }
+    for (u32 position = 0; position < vertexCount; ++position)
+    {
+        u32 borderOut = state.borderOut[position];
+        u32 borderIn = state.borderIn[position];
+        bool border = borderOut != SIMPLIFY_MULTIPLE && borderIn != SIMPLIFY_MULTIPLE && borderOut != NULL_INDEX && borderIn != NULL_INDEX;
+        state.kinds[position] = borderOut == NULL_INDEX && borderIn == NULL_INDEX ? SIMPLIFY_POSITION_MANIFOLD : (border ? SIMPLIFY_POSITION_BORDER : SIMPLIFY_POSITION_LOCKED);
+    }
+
+    // Quadrics of the triangle planes, weighted by area, and of the open edges. Seams get edge planes too, so they keep their shape.
+    BuildVertexTriangles(outIndices, currentIndexCount, vertexCount, state.vertexTriangleOffsets, state.vertexTriangles);
+    for (u32 index = 0; index < currentIndexCount; index += 3)
+    {
+        const u32* triangle = outIndices + index;
+        Vector3 a = scaledPositions[triangle[0]];
+        Vector3 b = scaledPositions[triangle[1]];
+        Vector3 c = scaledPositions[triangle[2]];
+        Vector3 normal = CrossProduct(b - a, c - a);
+        f32 area = Lenght(normal);
+        if (area == 0.0f)
+        {
+            continue;
+        }
+        normal = normal * (1.0f / area);
+
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            AddPlaneQuadric(state.quadrics + remap[triangle[corner]], normal, -DotProduct(normal, a), area);
+        }
+
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            u32 from = triangle[corner];
+            u32 to = triangle[(corner + 1) % 3];
+            if (HasEdge(outIndices, state.vertexTriangleOffsets, state.vertexTriangles, to, from))
+            {
+                continue;
+            }
+
+            Vector3 edge = scaledPositions[to] - scaledPositions[from];
+            f32 length = Lenght(edge);
+            Vector3 edgeNormal = CrossProduct(edge, normal);
+            f32 edgeNormalLength = Lenght(edgeNormal);
+            if (edgeNormalLength > 0.0f)
+            {
+                edgeNormal = edgeNormal * (1.0f / edgeNormalLength);
+                f32 distance = -DotProduct(edgeNormal, scaledPositions[from]);
+                AddPlaneQuadric(state.quadrics + remap[from], edgeNormal, distance, length * length * SIMPLIFY_EDGE_WEIGHT);
+                AddPlaneQuadric(state.quadrics + remap[to], edgeNormal, distance, length * length * SIMPLIFY_EDGE_WEIGHT);
+            }
+        }
+    }
+    free(weldedIndices);
+
+    EdgeCollapse* collapses = (EdgeCollapse*) malloc(sizeof(EdgeCollapse) * currentIndexCount);
+    u32* collapseRemap = (u32*) malloc(sizeof(u32) * vertexCount);
+    bool* collapsedPositions = (bool*) malloc(sizeof(bool) * vertexCount);
+    f32 errorLimit = targetError * targetError;
+    f32 maxError = 0.0f;
+    while (currentIndexCount > targetIndexCount)
+    {
+        // Cheaper direction of every edge
+        u32 collapseCount = 0;
+        for (u32 index = 0; index < currentIndexCount; ++index)
+        {
+            u32 a = outIndices[index];
+            u32 b = outIndices[index - index % 3 + (index + 1) % 3];
+            f32 costAB = CanCollapse(state, a, b) ? GetCollapseCost(state, a, b) : F32Max;
+            f32 costBA = CanCollapse(state, b, a) ? GetCollapseCost(state, b, a) : F32Max;
+            if (costAB <= errorLimit || costBA <= errorLimit)
+            {
+                collapses[collapseCount++] = costAB <= costBA ? EdgeCollapse { a, b, costAB } : EdgeCollapse { b, a, costBA };
+            }
+        }
+        if (collapseCount == 0)
+        {
+            break;
+        }
+        qsort(collapses, collapseCount, sizeof(EdgeCollapse), CompareEdgeCollapses);
+
+        for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            collapseRemap[vertex] = vertex;
+        }
+        memset(collapsedPositions, 0, sizeof(bool) * vertexCount);
+
+        u32 triangleGoal = (currentIndexCount - targetIndexCount) / 3;
+        u32 removedTriangles = 0;
+        for (u32 collapseIndex = 0; collapseIndex < collapseCount && removedTriangles < triangleGoal; ++collapseIndex)
+        {
+            const EdgeCollapse& collapse = collapses[collapseIndex];
+            u32 fromPosition = remap[collapse.from];
+            u32 toPosition = remap[collapse.to];
+            if (collapsedPositions[fromPosition] || collapsedPositions[toPosition])
+            {
+                continue;
+            }
+
+            bool flips = false;
+            u32 copy = collapse.from;
+            do
+            {
+                flips = flips || (IsVertexUsed(state, copy) && HasTriangleFlips(state, collapseRemap, copy, FindAdjacentCopy(state, copy, toPosition)));
+                copy = wedges[copy];
+            } while (copy != collapse.from);
+            if (flips)
+            {
+                continue;
+            }
+
+            do
+            {
+                if (IsVertexUsed(state, copy))
+                {
+                    collapseRemap[copy] = FindAdjacentCopy(state, copy, toPosition);
+                }
+                copy = wedges[copy];
+            } while (copy != collapse.from);
+
+            if (state.kinds[fromPosition] == SIMPLIFY_POSITION_BORDER)
+            {
+                CollapseBorderEdge(state, fromPosition, toPosition);
+            }
+            AddQuadric(state.quadrics + toPosition, state.quadrics[fromPosition]);
+            collapsedPositions[fromPosition] = true;
+            collapsedPositions[toPosition] = true;
+            removedTriangles += state.kinds[fromPosition] == SIMPLIFY_POSITION_BORDER ? 1 : 2;
+            maxError = fmaxf(maxError, collapse.cost);
+        }
+        if (removedTriangles == 0)
+        {
+            break;
+        }
+
+        u32 newIndexCount = 0;
+        for (u32 index = 0; index < currentIndexCount; index += 3)
+        {
+            u32 a = collapseRemap[outIndices[index]], b = collapseRemap[outIndices[index + 1]], c = collapseRemap[outIndices[index + 2]];
+            if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a])
+            {
+                outIndices[newIndexCount++] = a;
+                outIndices[newIndexCount++] = b;
+                outIndices[newIndexCount++] = c;
+            }
+        }
+        currentIndexCount = newIndexCount;
+        BuildVertexTriangles(outIndices, currentIndexCount, vertexCount, state.vertexTriangleOffsets, state.vertexTriangles);
+    }
+
+    *outError = sqrtf(maxError) * extent;
+
+    free(collapsedPositions);
+    free(collapseRemap);
+    free(collapses);
+    free(state.vertexTriangles);
+    free(state.vertexTriangleOffsets);
+    free(state.quadrics);
+    free(state.borderIn);
+    free(state.borderOut);
+    free(state.kinds);
+    free(scaledPositions);
+    free(wedges);
+    free(remap);
+    return currentIndexCount;
+}
+
+// Ritter's sphere: the most distant pair of the axis extremes, grown to the points outside
+static BoundingSphere ComputeBoundingSphere(const f32* positions, const u32* vertices, u32 vertexCount)
+{
+    u32 minVertex[3] = { vertices[0], vertices[0], vertices[0] };
+    u32 maxVertex[3] = { vertices[0], vertices[0], vertices[0] };
+    for (u32 index = 1; index < vertexCount; ++index)
+    {
+        const f32* position = positions + vertices[index] * 3;
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            minVertex[axis] = position[axis] < positions[minVertex[axis] * 3 + axis] ? vertices[index] : minVertex[axis];
+            maxVertex[axis] = position[axis] > positions[maxVertex[axis] * 3 + axis] ? vertices[index] : maxVertex[axis];
+        }
+    }
+
+    const f32* firstPosition = positions + vertices[0] * 3;
+    Vector3 from = Vector3(firstPosition[0], firstPosition[1], firstPosition[2]);
+    Vector3 to = from;
+    f32 maxDistance = -1.0f;
+    for (u32 axis = 0; axis < 3; ++axis)
+    {
+        Vector3 minPoint = Vector3(positions[minVertex[axis] * 3], positions[minVertex[axis] * 3 + 1], positions[minVertex[axis] * 3 + 2]);
+        Vector3 maxPoint = Vector3(positions[maxVertex[axis] * 3], positions[maxVertex[axis] * 3 + 1], positions[maxVertex[axis] * 3 + 2]);
+        f32 distance = Lenght(maxPoint - minPoint);
+        if (distance > maxDistance)
+        {
+            maxDistance = distance;
+            from = minPoint;
+            to = maxPoint;
+        }
+    }
+
+    BoundingSphere sphere;
+    sphere.center = (from + to) * 0.5f;
+    sphere.radius = maxDistance * 0.5f;
+    for (u32 index = 0; index < vertexCount; ++index)
+    {
+        const f32* position = positions + vertices[index] * 3;
+        Vector3 offset = Vector3(position[0], position[1], position[2]) - sphere.center;
+        f32 distance = Lenght(offset);
+        if (distance > sphere.radius)
+        {
+            f32 radius = (sphere.radius + distance) * 0.5f;
+            sphere.center = sphere.center + offset * ((radius - sphere.radius) / distance);
+            sphere.radius = radius;
+        }
+    }
+
+    return sphere;
+}
+
+struct MeshletOrder
+{
+    u32 meshlet;
+    u32 group;
+};
+
+static int CompareMeshletOrders(const void* left, const void* right)
+{
+    const MeshletOrder* leftOrder = (const MeshletOrder*) left;
+    const MeshletOrder* rightOrder = (const MeshletOrder*) right;
+    if (leftOrder->group != rightOrder->group)
+    {
+        return leftOrder->group < rightOrder->group ? -1 : 1;
+    }
+    // Keep the build order in a group
+    return leftOrder->meshlet < rightOrder->meshlet ? -1 : 1;
+}
+
+// Meshlets have few vertices, so the cache is optimized on indices local to the meshlet instead of the whole vertex buffer
+static void OptimizeMeshletVertexCache(u32* indices, u32 indexCount)
+{
+    u32 localVertices[MESHLET_MAX_VERTICES];
+    u32 localVertexCount = 0;
+    u32 localIndices[MESHLET_MAX_TRIANGLES * 3];
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        u32 localVertex = 0;
+        while (localVertex < localVertexCount && localVertices[localVertex] != indices[index])
+        {
+            localVertex++;
+        }
+        if (localVertex == localVertexCount)
+        {
+            ASSERT(localVertexCount < MESHLET_MAX_VERTICES, "Meshlet has too many vertices");
+            localVertices[localVertexCount++] = indices[index];
+        }
+        localIndices[index] = localVertex;
+    }
+
+    OptimizeVertexCache(localIndices, indexCount, localVertexCount);
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        indices[index] = localVertices[localIndices[index]];
+    }
+}
+
+u32 BuildMeshlets(u32* indices, u32 indexCount, const f32* positions, u32 vertexCount, Meshlet* outMeshlets)
+{
+    u32 triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return 0;
+    }
+
+    // Triangles are adjacent by position, so clusters grow over attribute seams
+    u32* remap = (u32*) malloc(sizeof(u32) * vertexCount);
+    u32* wedges = (u32*) malloc(sizeof(u32) * vertexCount);
+    BuildPositionWedges(positions, vertexCount, remap, wedges);
+    u32* weldedIndices = (u32*) malloc(sizeof(u32) * indexCount);
+    for (u32 index = 0; index < indexCount; ++index)
+    {
+        weldedIndices[index] = remap[indices[index]];
+    }
+    u32* positionTriangleOffsets = (u32*) malloc(sizeof(u32) * (vertexCount + 1));
+    u32* positionTriangles = (u32*) malloc(sizeof(u32) * indexCount);
+    BuildVertexTriangles(weldedIndices, indexCount, vertexCount, positionTriangleOffsets, positionTriangles);
+
+    // Degenerate triangles have zero normals, they don't widen the cones
+    Vector3* triangleNormals = (Vector3*) malloc(sizeof(Vector3) * triangleCount);
+    for (u32 triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const u32* corners = indices + triangle * 3;
+        Vector3 a = Vector3(positions[corners[0] * 3], positions[corners[0] * 3 + 1], positions[corners[0] * 3 + 2]);
+        Vector3 b = Vector3(positions[corners[1] * 3], positions[corners[1] * 3 + 1], positions[corners[1] * 3 + 2]);
+        Vector3 c = Vector3(positions[corners[2] * 3], positions[corners[2] * 3 + 1], positions[corners[2] * 3 + 2]);
+        Vector3 normal = CrossProduct(b - a, c - a);
+        f32 length = Lenght(normal);
+        triangleNormals[triangle] = length > 0.0f ? normal * (1.0f / length) : Vector3(0.0f, 0.0f, 0.0f);
+    }
+
+    u8* emitted = (u8*) calloc(triangleCount, sizeof(u8));
+    u32* vertexMeshlets = (u32*) malloc(sizeof(u32) * vertexCount);
+    memset(vertexMeshlets, 0xFF, sizeof(u32) * vertexCount);
+    u32* outIndices = (u32*) malloc(sizeof(u32) * indexCount);
+    u32 outIndexCount = 0;
+    u32 meshletCount = 0;
+    u32 seed = 0;
+    while (outIndexCount < indexCount)
+    {
+        // New clusters start from the first free triangle, so they roughly keep the order of the input
+        while (emitted[seed])
+        {
+            seed++;
+        }
+
+        u32 meshletVertices[MESHLET_MAX_VERTICES];
+        u32 meshletVertexCount = 0;
+        u32 meshletTriangles[MESHLET_MAX_TRIANGLES];
+        u32 meshletTriangleCount = 0;
+        Vector3 normalSum = Vector3(0.0f, 0.0f, 0.0f);
+        Meshlet* meshlet = outMeshlets + meshletCount;
+        meshlet->indexStart = outIndexCount;
+        u32 triangle = seed;
+        while (triangle != NULL_INDEX)
+        {
+            emitted[triangle] = 1;
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                u32 vertex = indices[triangle * 3 + corner];
+                if (vertexMeshlets[vertex] != meshletCount)
+                {
+                    vertexMeshlets[vertex] = meshletCount;
+                    meshletVertices[meshletVertexCount++] = vertex;
+                }
+                outIndices[outIndexCount++] = vertex;
+            }
+            normalSum = normalSum + triangleNormals[triangle];
+            meshletTriangles[meshletTriangleCount] = triangle;
+            if (++meshletTriangleCount == MESHLET_MAX_TRIANGLES)
+            {
+                break;
+            }
+
+            // Grow over the free triangles around the meshlet's positions. Fewer new vertices come first, then normals closer to
+            // the meshlet's.
+            f32 normalLength = Lenght(normalSum);
+            Vector3 axis = normalLength > 0.0f ? normalSum * (1.0f / normalLength) : Vector3(0.0f, 0.0f, 0.0f);
+            f32 bestScore = F32Max;
+            triangle = NULL_INDEX;
+            for (u32 meshletVertex = 0; meshletVertex < meshletVertexCount; ++meshletVertex)
+            {
+                u32 position = remap[meshletVertices[meshletVertex]];
+                for (u32 offset = positionTriangleOffsets[position]; offset < positionTriangleOffsets[position + 1]; ++offset)
+                {
+                    u32 candidate = positionTriangles[offset];
+                    if (emitted[candidate])
+                    {
+                        continue;
+                    }
+
+                    u32 newVertexCount = 0;
+                    for (u32 corner = 0; corner < 3; ++corner)
+                    {
+                        newVertexCount += vertexMeshlets[indices[candidate * 3 + corner]] != meshletCount;
+                    }
+                    // Degenerate triangles fit anywhere
+                    Vector3 normal = triangleNormals[candidate];
+                    bool degenerate = normalLength == 0.0f || (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f);
+                    f32 normalDot = degenerate ? 1.0f : DotProduct(normal, axis);
+                    f32 score = (f32) newVertexCount + 1.0f - normalDot;
+                    if (meshletVertexCount + newVertexCount <= MESHLET_MAX_VERTICES && normalDot >= MESHLET_MIN_NORMAL_DOT && score < bestScore)
+                    {
+                        bestScore = score;
+                        triangle = candidate;
+                    }
+                }
+            }
+        }
+
+        meshlet->indexCount = outIndexCount - meshlet->indexStart;
+        meshlet->bounds = ComputeBoundingSphere(positions, meshletVertices, meshletVertexCount);
+
+        // Narrowest cone around the mean normal. Wider than a hemisphere can't be culled.
+        f32 normalLength = Lenght(normalSum);
+        meshlet->coneAxis = normalLength > 0.0f ? normalSum * (1.0f / normalLength) : Vector3(0.0f, 0.0f, 0.0f);
+        f32 minDot = 1.0f;
+        for (u32 meshletTriangle = 0; meshletTriangle < meshletTriangleCount; ++meshletTriangle)
+        {
+            Vector3 normal = triangleNormals[meshletTriangles[meshletTriangle]];
+            if (normal.x != 0.0f || normal.y != 0.0f || normal.z != 0.0f)
+            {
+                minDot = fminf(minDot, DotProduct(normal, meshlet->coneAxis));
+            }
+        }
+        meshlet->coneCutoff = normalLength > 0.0f && minDot > 0.0f ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+        meshletCount++;
+    }
+
+    // Meshlets facing the same way are culled together, grouping them by the main axis of their cones keeps the visible ones consecutive
+    MeshletOrder* order = (MeshletOrder*) malloc(sizeof(MeshletOrder) * meshletCount);
+    for (u32 meshletIndex = 0; meshletIndex < meshletCount; ++meshletIndex)
+    {
+        const Meshlet* meshlet = outMeshlets + meshletIndex;
+        const f32* axis = &meshlet->coneAxis.x;
+        u32 mainAxis = fabsf(axis[0]) >= fabsf(axis[1]) && fabsf(axis[0]) >= fabsf(axis[2]) ? 0 : (fabsf(axis[1]) >= fabsf(axis[2]) ? 1 : 2);
+        order[meshletIndex].meshlet = meshletIndex;
+        order[meshletIndex].group = meshlet->coneCutoff < 1.0f ? mainAxis * 2 + (axis[mainAxis] < 0.0f) : 6;
+    }
+    qsort(order, meshletCount, sizeof(MeshletOrder), CompareMeshletOrders);
+
+    Meshlet* sourceMeshlets = (Meshlet*) malloc(sizeof(Meshlet) * meshletCount);
+    memcpy(sourceMeshlets, outMeshlets, sizeof(Meshlet) * meshletCount);
+    outIndexCount = 0;
+    for (u32 meshletIndex = 0; meshletIndex < meshletCount; ++meshletIndex)
+    {
+        Meshlet* meshlet = outMeshlets + meshletIndex;
+        *meshlet = sourceMeshlets[order[meshletIndex].meshlet];
+        memcpy(indices + outIndexCount, outIndices + meshlet->indexStart, sizeof(u32) * meshlet->indexCount);
+        OptimizeMeshletVertexCache(indices + outIndexCount, meshlet->indexCount);
+        meshlet->indexStart = outIndexCount;
+        outIndexCount += meshlet->indexCount;
+    }
+
+    free(sourceMeshlets);
+    free(order);
+    free(outIndices);
+    free(vertexMeshlets);
+    free(emitted);
+    free(triangleNormals);
+    free(positionTriangles);
+    free(positionTriangleOffsets);
+    free(weldedIndices);
+    free(wedges);
+    free(remap);
+    return meshletCount;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Index and vertex reordering done at cook time. Indices are triangle lists.
+
+struct Meshlet;
+
+// Reorders triangles for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm)
+void OptimizeVertexCache(u32* indices, u32 indexCount, u32 vertexCount);
+
+// Reorders clusters of a vertex cache optimized index buffer so outward facing clusters are drawn first.
+// Positions are tightly packed float3s.
+void OptimizeOverdraw(u32* indices, u32 indexCount, const f32* positions, u32 vertexCount);
+
+// Remaps vertices in the order of their first use and rewrites the indices. Unused vertices get NULL_INDEX.
+// Returns the used vertex count.
+u32 OptimizeVertexFetch(u32* indices, u32 indexCount, u32 vertexCount, u32* outRemap);
+
+// Quadric edge collapse simplification (Garland and Heckbert 1997) to at most targetIndexCount indices, as long as the error stays
+// under targetError, relative to the mesh extent. Vertices are only removed so the result indexes the same vertex buffer.
+// Returns the index count, outError is the object space distance of the result to the source.
+u32 SimplifyMesh(u32* outIndices, const u32* indices, u32 indexCount, const f32* positions, u32 vertexCount, u32 targetIndexCount, f32 targetError, f32* outError);
+
+// Splits the triangles into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles, grown over
+// adjacent triangles with similar normals. Triangles are reordered so every meshlet is a contiguous range of the indices, ordered
+// for the vertex cache inside the range. Earlier vertex cache and overdraw ordering only survives inside a meshlet.
+// outMeshlets needs room for a meshlet per triangle. Returns the meshlet count.
+u32 BuildMeshlets(u32* indices, u32 indexCount, const f32* positions, u32 vertexCount, Meshlet* outMeshlets);
@@ -0,0 +1,408 @@
+#include "pch.h"
+#include "RHI.h"
+#include "TextureCompression.h"
+
+#define BLOCK_PIXEL_COUNT 16
+
+u32 GetBlockCompressedBlockSize(u32 format)
+{
+    switch (format)
+    {
+        case FORMAT_BC1_UNORM:
+        case FORMAT_BC1_UNORM_SRGB:
+        case FORMAT_BC4_UNORM:
+            return 8;
+        case FORMAT_BC3_UNORM:
+        case FORMAT_BC3_UNORM_SRGB:
+        case FORMAT_BC5_UNORM:
+        case FORMAT_BC7_UNORM:
+        case FORMAT_BC7_UNORM_SRGB:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+// Copies a 4x4 block as RGBA8, clamping to the edges of the image
+static void LoadBlock(const u8* pixels, u32 width, u32 height, u32 blockX, u32 blockY, u8* outBlock)
+{
+    for (u32 y = 0; y < 4; ++y)
+    {
+        u32 pixelY = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+        for (u32 x = 0; x < 4; ++x)
+        {
+            u32 pixelX = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+            memcpy(outBlock + (y * 4 + x) * 4, pixels + ((u64) pixelY * width + pixelX) * 4, 4);
+        }
+    }
+}
+
+// Endpoints are the extremes of the pixels along the principal axis of the first channelCount channels
+static void ComputeBlockEndpoints(const u8* block, u32 channelCount, f32* outStart, f32* outEnd)
+{
+    f32 mean[4] = {};
+    f32 minValue[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+    f32 maxValue[4] = {};
+    for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+    {
+        for (u32 channel = 0; channel < channelCount; ++channel)
+        {
+            f32 value = block[pixel * 4 + channel];
+            mean[channel] += value;
+            minValue[channel] = fminf(minValue[channel], value);
+            maxValue[channel] = fmaxf(maxValue[channel], value);
+        }
+    }
+    for (u32 channel = 0; channel < channelCount; ++channel)
+    {
+        mean[channel] /= BLOCK_PIXEL_COUNT;
+    }
+
+    f32 covariance[4][4] = {};
+    for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+    {
+        for (u32 row = 0; row < channelCount; ++row)
+        {
+            f32 rowValue = block[pixel * 4 + row] - mean[row];
+            for (u32 column = 0; column < channelCount; ++column)
+            {
+                covariance[row][column] += rowValue * (block[pixel * 4 + column] - mean[column]);
+            }
+        }
+    }
+
+    // Power iteration, starting from the bounding box diagonal
+    f32 axis[4] = {};
+    for (u32 channel = 0; channel < channelCount; ++channel)
+    {
+        axis[channel] = maxValue[channel] - minValue[channel];
+    }
+    for (u32 iteration = 0; iteration < 8; ++iteration)
+    {
+        f32 nextAxis[4] = {};
+        f32 lengthSquared = 0.0f;
+        for (u32 row = 0; row < channelCount; ++row)
+        {
+            for (u32 column = 0; column < channelCount; ++column)
+            {
+                nextAxis[row] += covariance[row][column] * axis[column];
+            }
+            lengthSquared += nextAxis[row] * nextAxis[row];
+        }
+        if (lengthSquared < 1e-12f)
+        {
+            break;
+        }
+
+        f32 inverseLength = 1.0f / sqrtf(lengthSquared);
+        for (u32 channel = 0; channel < channelCount; ++channel)
+        {
+            axis[channel] = nextAxis[channel] * inverseLength;
+        }
+    }
+
+    f32 minProjection = 0.0f;
+    f32 maxProjection = 0.0f;
+    for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+    {
+        f32 projection = 0.0f;
+        for (u32 channel = 0; channel < channelCount; ++channel)
+        {
+            projection += (block[pixel * 4 + channel] - mean[channel]) * axis[channel];
+        }
+        minProjection = fminf(minProjection, projection);
+        maxProjection = fmaxf(maxProjection, projection);
+    }
+
+    for (u32 channel = 0; channel < channelCount; ++channel)
+    {
+        outStart[channel] = fminf(fmaxf(mean[channel] + axis[channel] * minProjection, 0.0f), 255.0f);
+        outEnd[channel] = fminf(fmaxf(mean[channel] + axis[channel] * maxProjection, 0.0f), 255.0f);
+    }
+}
+
+static u16 PackRGB565(const f32* color)
+{
+    u32 r = (u32) (color[0] * 31.0f / 255.0f + 0.5f);
+    u32 g = (u32) (color[1] * 63.0f / 255.0f + 0.5f);
+    u32 b = (u32) (color[2] * 31.0f / 255.0f + 0.5f);
+    return (u16) ((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(u16 packed, i32* outColor)
+{
+    i32 r = packed >> 11;
+    i32 g = (packed >> 5) & 63;
+    i32 b = packed & 31;
+    outColor[0] = (r << 3) | (r >> 2);
+    outColor[1] = (g << 2) | (g >> 4);
+    outColor[2] = (b << 3) | (b >> 2);
+}
+
+// Always uses the four color mode, so it's also the color block of BC3
+static void CompressBC1Block(const u8* block, u8* outBlock)
+{
+    f32 start[4];
+    f32 end[4];
+    ComputeBlockEndpoints(block, 3, start, end);
+
+    u16 color0 = PackRGB565(end);
+    u16 color1 = PackRGB565(start);
+    if (color0 < color1)
+    {
+        u16 temp = color0;
+        color0 = color1;
+        color1 = temp;
+    }
+
+    u32 indices = 0;
+    if (color0 != color1)
+    {
+        i32 palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (u32 channel = 0; channel < 3; ++channel)
+        {
+            palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+            palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+        }
+
+        for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+        {
+            u32 bestIndex = 0;
+            i32 bestError = I32Max;
+            for (u32 index = 0; index < 4; ++index)
+            {
+                i32 dr = block[pixel * 4 + 0] - palette[index][0];
+                i32 dg = block[pixel * 4 + 1] - palette[index][1];
+                i32 db = block[pixel * 4 + 2] - palette[index][2];
+                i32 error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = index;
+                }
+            }
+            indices |= bestIndex << (pixel * 2);
+        }
+    }
+
+    memcpy(outBlock, &color0, sizeof(u16));
+    memcpy(outBlock + 2, &color1, sizeof(u16));
+    memcpy(outBlock + 4, &indices, sizeof(u32));
+}
+
+// Single channel block, eight value mode. Alpha of BC3 and both channels of BC5.
+static void CompressBC4Block(const u8* block, u32 channel, u8* outBlock)
+{
+    i32 minValue = 255;
+    i32 maxValue = 0;
+    for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+    {
+        i32 value = block[pixel * 4 + channel];
+        minValue = value < minValue ? value : minValue;
+        maxValue = value > maxValue ? value : maxValue;
+    }
+
+    memset(outBlock, 0, 8);
+    outBlock[0] = (u8) maxValue;
+    outBlock[1] = (u8) minValue;
+    if (maxValue == minValue)
+    {
+        return;
+    }
+
+    i32 palette[8];
+    palette[0] = maxValue;
+    palette[1] = minValue;
+    for (i32 step = 1; step < 7; ++step)
+    {
+        palette[step + 1] = ((7 - step) * maxValue + step * minValue + 3) / 7;
+    }
+
+    u64 indices = 0;
+    for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+    {
+        i32 value = block[pixel * 4 + channel];
+        u64 bestIndex = 0;
+        i32 bestError = I32Max;
+        for (u32 index = 0; index < 8; ++index)
+        {
+            i32 error = abs(value - palette[index]);
+            if (error < bestError)
+            {
+                bestError = error;
+                bestIndex = index;
+            }
+        }
+        indices |= bestIndex << (pixel * 3);
+    }
+
+    for (u32 byte = 0; byte < 6; ++byte)
+    {
+        outBlock[2 + byte] = (u8) (indices >> (byte * 8));
+    }
+}
+
+static void WriteBlockBits(u8* block, u32* bitPosition, u32 value, u32 bitCount)
+{
+    for (u32 bit = 0; bit < bitCount; ++bit, ++*bitPosition)
+    {
+        block[*bitPosition / 8] |= ((value >> bit) & 1) << (*bitPosition % 8);
+    }
+}
+
+// Mode 6, a single RGBA subset with 7 bit endpoints, a p-bit per endpoint and 4 bit indices
+static void CompressBC7Block(const u8* block, u8* outBlock)
+{
+    static const i32 weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    f32 endpoints[2][4];
+    ComputeBlockEndpoints(block, 4, endpoints[0], endpoints[1]);
+
+    // Pick the p-bit with the lower quantization error for each endpoint
+    u32 quantized[2][4];
+    u32 pBits[2];
+    i32 expanded[2][4];
+    for (u32 endpoint = 0; endpoint < 2; ++endpoint)
+    {
+        f32 bestError = F32Max;
+        for (u32 pBit = 0; pBit < 2; ++pBit)
+        {
+            u32 candidate[4];
+            f32 error = 0.0f;
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                i32 value = (i32) ((endpoints[endpoint][channel] - pBit) / 2.0f + 0.5f);
+                candidate[channel] = (u32) (value < 0 ? 0 : (value > 127 ? 127 : value));
+                f32 difference = (f32) ((candidate[channel] << 1) | pBit) - endpoints[endpoint][channel];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pBits[endpoint] = pBit;
+                memcpy(quantized[endpoint], candidate, sizeof(candidate));
+            }
+        }
+        for (u32 channel = 0; channel < 4; ++channel)
+        {
+            expanded[endpoint][channel] = (i32) ((quantized[endpoint][channel] << 1) | pBits[endpoint]);
+        }
+    }
+
+    u32 indices[BLOCK_PIXEL_COUNT] = {};
+    i32 direction[4];
+    i32 lengthSquared = 0;
+    for (u32 channel = 0; channel < 4; ++channel)
+    {
+        direction[channel] = expanded[1][channel] - expanded[0][channel];
+        lengthSquared += direction[channel] * direction[channel];
+    }
+    if (lengthSquared > 0)
+    {
+        for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+        {
+            i32 projection = 0;
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                projection += (block[pixel * 4 + channel] - expanded[0][channel]) * direction[channel];
+            }
+
+            f32 weight = 64.0f * projection / lengthSquared;
+            u32 bestIndex = 0;
+            f32 bestDistance = F32Max;
+            for (u32 index = 0; index < 16; ++index)
+            {
+                f32 distance = fabsf(weights[index] - weight);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = index;
+                }
+            }
+            indices[pixel] = bestIndex;
+        }
+    }
+
+    // Most significant index bit of the first pixel is implicitly zero
+    if (indices[0] & 8)
+    {
+        for (u32 channel = 0; channel < 4; ++channel)
+        {
+            u32 temp = quantized[0][channel];
+            quantized[0][channel] = quantized[1][channel];
+            quantized[1][channel] = temp;
+        }
+        u32 tempPBit = pBits[0];
+        pBits[0] = pBits[1];
+        pBits[1] = tempPBit;
+        for (u32 pixel = 0; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+        {
+            indices[pixel] = 15 - indices[pixel];
+        }
+    }
+
+    memset(outBlock, 0, 16);
+    u32 bitPosition = 0;
+    WriteBlockBits(outBlock, &bitPosition, 1 << 6, 7);
+    for (u32 channel = 0; channel < 4; ++channel)
+    {
+        WriteBlockBits(outBlock, &bitPosition, quantized[0][channel], 7);
+        WriteBlockBits(outBlock, &bitPosition, quantized[1][channel], 7);
+    }
+    WriteBlockBits(outBlock, &bitPosition, pBits[0], 1);
+    WriteBlockBits(outBlock, &bitPosition, pBits[1], 1);
+    WriteBlockBits(outBlock, &bitPosition, indices[0], 3);
+    for (u32 pixel = 1; pixel < BLOCK_PIXEL_COUNT; ++pixel)
+    {
+        WriteBlockBits(outBlock, &bitPosition, indices[pixel], 4);
+    }
+}
+
+void CompressTextureMip(const u8* pixels, u32 width, u32 height, u32 format, u8* outBlocks)
+{
+    u32 blockSize = GetBlockCompressedBlockSize(format);
+    ASSERT(blockSize, "Unsupported block compression format");
+
+    u32 blockCountX = (width + 3) / 4;
+    u32 blockCountY = (height + 3) / 4;
+    u8 block[BLOCK_PIXEL_COUNT * 4];
+    for (u32 blockY = 0; blockY < blockCountY; ++blockY)
+    {
+        for (u32 blockX = 0; blockX < blockCountX; ++blockX)
+        {
+            LoadBlock(pixels, width, height, blockX, blockY, block);
+            u8* outBlock = outBlocks + ((u64) blockY * blockCountX + blockX) * blockSize;
+            switch (format)
+            {
+                case FORMAT_BC1_UNORM:
+                case FORMAT_BC1_UNORM_SRGB:
+                {
+                    CompressBC1Block(block, outBlock);
+                } break;
+                case FORMAT_BC3_UNORM:
+                case FORMAT_BC3_UNORM_SRGB:
+                {
+                    CompressBC4Block(block, 3, outBlock);
+                    CompressBC1Block(block, outBlock + 8);
+                } break;
+                case FORMAT_BC4_UNORM:
+                {
+                    CompressBC4Block(block, 0, outBlock);
+                } break;
+                case FORMAT_BC5_UNORM:
+                {
+                    CompressBC4Block(block, 0, outBlock);
+                    CompressBC4Block(block, 1, outBlock + 8);
+                } break;
+                case FORMAT_BC7_UNORM:
+                case FORMAT_BC7_UNORM_SRGB:
+                {
+                    CompressBC7Block(block, outBlock);
+                } break;
+                default: break;
+            }
+        }
+    }
+}
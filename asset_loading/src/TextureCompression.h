@@ -0,0 +1,9 @@
+#pragma once
+
+// Block compression of RGBA8 images at cook time. Blocks are 4x4 pixels, edge blocks repeat the last row and column.
+
+// Bytes of a 4x4 block, zero for uncompressed formats
+u32 GetBlockCompressedBlockSize(u32 format);
+
+// Supports BC1, BC3, BC4, BC5 and BC7 (mode 6 only). BC4 encodes red, BC5 red and green.
+void CompressTextureMip(const u8* pixels, u32 width, u32 height, u32 format, u8* outBlocks);
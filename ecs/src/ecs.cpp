@@ -2,43 +2,179 @@
 #include "ecs.h"
 #include "Allocator.h"
 #include "ApiRegistry.h"
+#include "Platform.h"
 
 static APIRegistry* gAPIRegistry = nullptr;
 
+#define MAX_ENTITY_COUNT (INVALID_HANDLE_INDEX - 1)
+// Shared component values split archetypes, so there is one archetype per signature and shared value combination
+#define MAX_ARCHETYPE_COUNT 1024
+#define MAX_ARCHETYPE_COLUMN_COUNT 64
+#define MAX_ARCHETYPE_SHARED_COMPONENT_COUNT 8
+#define MAX_COMMAND_BUFFER_COUNT 64
+#define MAX_COMPONENT_HANDLE_FIELD_COUNT 256
+// Batch creation obtains handles into a stack chunk of this size
+#define ENTITY_BATCH_CHUNK_SIZE 256
+// Row of an entity that is destroyed while waiting for command buffer playback
+#define CANCELLED_CREATE_ROW (NULL_INDEX - 1)
+
+enum ComponentFlag
+{
+    COMPONENT_FLAG_SHARED = BIT(0),
+    // Zero size, only in the signature
+    COMPONENT_FLAG_TAG = BIT(1)
+};
+
 struct ArchetypeComponent
 {
     u32 componentIndex;
     u32 componentSize;
 };
 
+struct ArchetypeSharedComponent
+{
+    u32 componentIndex;
+    u32 valueIndex;
+};
+
+// Interned shared component value. Values are immutable and live as long as the context.
+struct SharedValue
+{
+    u32 componentIndex;
+    u32 nextWithSameHash;
+    u64 dataOffset;
+};
+
 struct Archetype
 {
-    // Get component types from signature
+    // Columns are laid out as [component0 * capacity][component1 * capacity]...
+    // Growing the capacity moves the columns, adding an entity within the capacity doesn't.
     ILinearAllocator* allocator;
+    DynamicArray<Entity> entities;
     u32 entityCount;
+    u32 capacity;
 
-    // TODO: Do we need to store these? Can't we just extract these information from component mask?
-    ArchetypeComponent components[MAX_COMPONENT_TYPE_COUNT];
+    // Sorted by component index, same order as the signature bits
+    ArchetypeComponent components[MAX_ARCHETYPE_COLUMN_COUNT];
+    // Sum of the component sizes before each column
+    u32 columnOffsets[MAX_ARCHETYPE_COLUMN_COUNT];
+    // Change version of each column. Bumped when an entity is added or a system writes the column.
+    u32 componentVersions[MAX_ARCHETYPE_COLUMN_COUNT];
     u32 componentCount;
+    u32 rowSize;
+
+    // Shared components have no columns, all entities of the archetype have the same value. Sorted by component index.
+    ArchetypeSharedComponent sharedComponents[MAX_ARCHETYPE_SHARED_COMPONENT_COUNT];
+    u32 sharedComponentCount;
+    // Tags have no storage at all
+    u32 tagComponentCount;
 };
 
 struct EntityData
+{
+    u32 archetypeIndex; // NULL_INDEX while the entity is waiting for command buffer playback
+    u32 row; // CANCELLED_CREATE_ROW if it's destroyed before playback
+};
+
+enum EntityCommandType
+{
+    ENTITY_COMMAND_DESTROY,
+    ENTITY_COMMAND_ADD_COMPONENT,
+    ENTITY_COMMAND_REMOVE_COMPONENT
+};
+
+struct CreateEntityCommand
+{
+    Entity entity;
+    EntitySignature signature;
+    // Component data is packed in component index order
+    u64 dataOffset;
+};
+
+struct EntityCommand
+{
+    EntityCommandType type;
+    Entity entity;
+    Component component;
+    u64 dataOffset;
+};
+
+struct EntityCommandBuffer
+{
+    EntityContext* context;
+    DynamicArray<CreateEntityCommand> creates;
+    DynamicArray<EntityCommand> commands;
+    ILinearAllocator* dataAllocator;
+    bool acquired;
+};
+
+struct ComponentHandleField
+{
+    u32 componentIndex;
+    u32 fieldOffset;
+    u32 handleType;
+};
+
+// Compiled query terms of a system
+struct EntityQuery
+{
+    EntitySignature requiredMask;
+    EntitySignature excludedMask;
+    EntitySignature anyOfMask;
+    bool hasAnyOf;
+
+    // Archetypes are never removed, so matches are cached and only archetypes created since the last run are tested
+    u32 matchingArchetypes[MAX_ARCHETYPE_COUNT];
+    u32 matchingArchetypeCount;
+    u32 testedArchetypeCount;
+};
+
+struct PendingCreate
 {
     u32 archetypeIndex;
+    Entity entity;
+    const u8* data;
 };
 
 struct EntityContext
 {
+    ILinearAllocator* allocator;
+
+    // Entity pool has its own allocator, it's too big for the application allocator
     HandlePool entityPool;
+    SpinLock entityPoolLock;
 
-    EntitySignature archetypeSignatures[MAX_COMPONENT_TYPE_COUNT];
-    Archetype archetypes[MAX_COMPONENT_TYPE_COUNT];
+    EntitySignature archetypeSignatures[MAX_ARCHETYPE_COUNT];
+    Archetype archetypes[MAX_ARCHETYPE_COUNT];
     u32 createdArchetypeCount;
 
     u32 componentSizes[MAX_COMPONENT_TYPE_COUNT];
+    u32 componentFlags[MAX_COMPONENT_TYPE_COUNT];
+    const char* componentNames[MAX_COMPONENT_TYPE_COUNT];
+    EntitySignature sharedComponentMask;
     u32 registeredComponentCount;
+    ComponentHandleField handleFields[MAX_COMPONENT_HANDLE_FIELD_COUNT];
+    u32 handleFieldCount;
     HashTable<const char*, u32> componentTable;
     DynamicArray<IEntitySystem> systems;
+    DynamicArray<EntityQuery> systemQueries;
+
+    ILinearAllocator* sharedValueAllocator;
+    DynamicArray<SharedValue> sharedValues;
+    // Hash of the component index and value to the first value with that hash
+    HashTable<Hash64, u32> sharedValueTable;
+
+    void* singletons[MAX_COMPONENT_TYPE_COUNT];
+
+    // Incremented after every system run, so it is always greater than the last run version of systems
+    u32 changeVersion;
+
+    EntityCommandBuffer commandBuffers[MAX_COMMAND_BUFFER_COUNT];
+    u32 commandBufferCount;
+    SpinLock commandBufferLock;
+    DynamicArray<PendingCreate> pendingCreates;
+    DynamicArray<Entity> pendingCreateEntities;
+    DynamicArray<Entity> pendingReleases;
 };
 
 
@@ -48,248 +184,1871 @@ EntityContext* CreateEntityContext(ILinearAllocator* allocator)
     EntityContext* context = (EntityContext*) allocator->Alloc(allocator->instance, sizeof(EntityContext));
     AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
 
-    context->entityPool = InitHandlePool(allocator, 4096, sizeof(u32));
+    context->allocator = allocator;
+    context->entityPool = InitGrowingHandlePool(allocatorAPI, MAX_ENTITY_COUNT, sizeof(EntityData));
     context->componentTable = CreateHashTable<const char*, u32>(allocatorAPI, 512);
     context->systems = CreateDynamicArray<IEntitySystem>(allocatorAPI);
+    context->systemQueries = CreateDynamicArray<EntityQuery>(allocatorAPI);
+    context->pendingCreates = CreateDynamicArray<PendingCreate>(allocatorAPI);
+    context->pendingCreateEntities = CreateDynamicArray<Entity>(allocatorAPI);
+    context->pendingReleases = CreateDynamicArray<Entity>(allocatorAPI);
+    context->sharedValueAllocator = allocatorAPI->CreateLinearAllocator(Gigabyte(1), Megabyte(1));
+    context->sharedValues = CreateDynamicArray<SharedValue>(allocatorAPI);
+    context->sharedValueTable = CreateHashTable<Hash64, u32>(allocatorAPI, 512);
 
     // Index 0 is the default archetype which is a entity has no components
     context->archetypeSignatures[0] = {0};
     // We don't need a allocator because default archetype has no components
     Archetype archetype = {};
     archetype.allocator = nullptr;
+    archetype.entities = CreateDynamicArray<Entity>(allocatorAPI);
     archetype.entityCount = 0;
     archetype.componentCount = 0;
     context->archetypes[0] = archetype;
+    context->createdArchetypeCount = 1;
+    context->changeVersion = 1;
 
     return context;
 }
 
-Entity CreateEntity(EntityContext* context)
+void DestroyEntityContext(EntityContext* context)
 {
-    Handle handle = ObtainNewHandleFromPool(&context->entityPool);
-    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, handle);
-    entityData->archetypeIndex = 0;
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
 
-    return Entity { handle };
-}
+    for (u32 archetypeIndex = 0; archetypeIndex < context->createdArchetypeCount; ++archetypeIndex)
+    {
+        Archetype* archetype = context->archetypes + archetypeIndex;
+        if (archetype->allocator)
+        {
+            allocatorAPI->DestroyLinearAllocator(archetype->allocator);
+        }
+        DestroyDynamicArray(&archetype->entities, allocatorAPI);
+    }
+
+    for (u32 bufferIndex = 0; bufferIndex < context->commandBufferCount; ++bufferIndex)
+    {
+        EntityCommandBuffer* commandBuffer = context->commandBuffers + bufferIndex;
+        DestroyDynamicArray(&commandBuffer->creates, allocatorAPI);
+        DestroyDynamicArray(&commandBuffer->commands, allocatorAPI);
+        allocatorAPI->DestroyLinearAllocator(commandBuffer->dataAllocator);
+    }
 
+    DestroyHashTable(&context->componentTable, allocatorAPI);
+    DestroyDynamicArray(&context->systems, allocatorAPI);
+    DestroyDynamicArray(&context->systemQueries, allocatorAPI);
+    DestroyDynamicArray(&context->pendingCreates, allocatorAPI);
+    DestroyDynamicArray(&context->pendingCreateEntities, allocatorAPI);
+    DestroyDynamicArray(&context->pendingReleases, allocatorAPI);
+    allocatorAPI->DestroyLinearAllocator(context->sharedValueAllocator);
+    DestroyDynamicArray(&context->sharedValues, allocatorAPI);
+    DestroyHashTable(&context->sharedValueTable, allocatorAPI);
+    DestroyGrowingHandlePool(&context->entityPool, allocatorAPI);
+
+    context->createdArchetypeCount = 0;
+    context->commandBufferCount = 0;
+}
 
-int CompareComponents(const void * a, const void * b)
+static inline u8* GetArchetypeColumn(const Archetype* archetype, u32 column)
 {
-  return ( ((Component*)a)->componentIndex - ((Component*)b)->componentIndex );
+    return archetype->allocator->instance->pointer + (u64) archetype->columnOffsets[column] * archetype->capacity;
 }
 
-Entity CreateEntityWithComponents(EntityContext* context, Component* components, void** componentDatas, u32 numComponents)
+static inline void SetSignatureComponent(EntitySignature* signature, u32 componentIndex, bool value)
 {
-    Handle handle = ObtainNewHandleFromPool(&context->entityPool);
-    
+    u64 bit = 1ULL << (componentIndex % 64);
+    if (value)
+    {
+        signature->componentMaskBits[componentIndex / 64] |= bit;
+    }
+    else
+    {
+        signature->componentMaskBits[componentIndex / 64] &= ~bit;
+    }
+}
 
-    EntitySignature signature = {};
-    for (u32 i = 0; i < numComponents; ++i)
+// Returns the first component index of the signature starting from componentIndex, MAX_COMPONENT_TYPE_COUNT if there is none
+static inline u32 NextSignatureComponent(const EntitySignature* signature, u32 componentIndex)
+{
+    u32 word = componentIndex / 64;
+    if (word >= ENTITY_SIGNATURE_WORD_COUNT)
     {
-        u32 componentIndex = components[i].componentIndex;
-        signature.componentMaskBits[componentIndex / 64] = signature.componentMaskBits[componentIndex / 64] | (1ULL << (componentIndex % 64));
+        return MAX_COMPONENT_TYPE_COUNT;
     }
 
-    // Search an archetype that has matching signature
-    u32 archetypeIndex = NULL_INDEX;
-    for (u32 i = 0; i < context->createdArchetypeCount; ++i)
+    u64 bits = signature->componentMaskBits[word] & (~0ULL << (componentIndex % 64));
+    while (bits == 0)
     {
-        EntitySignature* sig = context->archetypeSignatures + i;
-        if (memcmp(&signature, sig, sizeof(EntitySignature)) == 0)
+        if (++word == ENTITY_SIGNATURE_WORD_COUNT)
         {
-            archetypeIndex = i;
-            break;
+            return MAX_COMPONENT_TYPE_COUNT;
         }
+        bits = signature->componentMaskBits[word];
     }
+    return word * 64 + CountTrailingZeros64(bits);
+}
 
-    // If not, create archetype
-    if (archetypeIndex == NULL_INDEX)
+static u32 FindArchetypeColumn(const Archetype* archetype, Component component)
+{
+    for (u32 archCompIndex = 0; archCompIndex < archetype->componentCount; ++archCompIndex)
     {
-        AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
-        u32 index = context->createdArchetypeCount++;
-        context->archetypeSignatures[index] = signature;
-        ILinearAllocator* allocator = allocatorAPI->CreateLinearAllocator(Megabyte(512), Megabyte(1));
-        Archetype archetype = {};
-        archetype.allocator = allocator;
-        archetype.entityCount = 0;
+        if (archetype->components[archCompIndex].componentIndex == component.componentIndex)
+        {
+            return archCompIndex;
+        }
+    }
+
+    return NULL_INDEX;
+}
+
+static inline bool IsSharedComponent(const EntityContext* context, Component component)
+{
+    return context->componentFlags[component.componentIndex] & COMPONENT_FLAG_SHARED;
+}
+
+static inline bool IsTagComponent(const EntityContext* context, Component component)
+{
+    return context->componentFlags[component.componentIndex] & COMPONENT_FLAG_TAG;
+}
+
+// Shared and tag components don't have columns
+static inline bool HasColumn(const EntityContext* context, Component component)
+{
+    return !(context->componentFlags[component.componentIndex] & (COMPONENT_FLAG_SHARED | COMPONENT_FLAG_TAG));
+}
+
+static inline bool HasSharedComponents(const EntityContext* context, const EntitySignature* signature)
+{
+    return HasAnyEntitySignatureComponent(signature, &context->sharedComponentMask);
+}
+
+static inline u8* GetSharedValueData(const EntityContext* context, u32 valueIndex)
+{
+    return context->sharedValueAllocator->instance->pointer + context->sharedValues.data[valueIndex].dataOffset;
+}
+
+static u32 InternSharedValue(EntityContext* context, u32 componentIndex, const void* data)
+{
+    ASSERT(data, "Shared components need a value");
+    u32 componentSize = context->componentSizes[componentIndex];
+    Hash64 hash = XXH64(data, componentSize, componentIndex);
 
-        Component* sortedComponents = (Component*) alloca(sizeof(Component) * numComponents);
-        memcpy(sortedComponents, components, sizeof(Component) * numComponents);
-        qsort(sortedComponents, numComponents, sizeof(Component), CompareComponents);
-        for (u32 i = 0; i < numComponents; ++i)
+    u32 firstValueIndex = NULL_INDEX;
+    context->sharedValueTable.Get(hash, &firstValueIndex);
+    for (u32 valueIndex = firstValueIndex; valueIndex != NULL_INDEX; valueIndex = context->sharedValues[valueIndex].nextWithSameHash)
+    {
+        if (context->sharedValues[valueIndex].componentIndex == componentIndex && memcmp(GetSharedValueData(context, valueIndex), data, componentSize) == 0)
         {
-            Component* comp = components + i;
-            u32 componentSize = context->componentSizes[comp->componentIndex];
-            archetype.components[i] = ArchetypeComponent{ comp->componentIndex, componentSize };
+            return valueIndex;
         }
-        archetype.componentCount = numComponents;
+    }
+
+    ILinearAllocator* allocator = context->sharedValueAllocator;
+    allocator->Alloc(allocator->instance, (16 - allocator->instance->startOffset % 16) % 16);
+    SharedValue value = { componentIndex, firstValueIndex, allocator->instance->startOffset };
+    memcpy(allocator->Alloc(allocator->instance, componentSize), data, componentSize);
+
+    u32 valueIndex = context->sharedValues.length;
+    context->sharedValues.Append(value);
+    context->sharedValueTable.Set(hash, valueIndex);
 
-        context->archetypes[index] = archetype;
-        archetypeIndex = index;
+    return valueIndex;
+}
+
+// Replaces or adds the value of a shared component, the list stays sorted
+static void SetSharedComponentValue(ArchetypeSharedComponent* sharedComponents, u32* sharedComponentCount, u32 componentIndex, u32 valueIndex)
+{
+    u32 insertIndex = 0;
+    while (insertIndex < *sharedComponentCount && sharedComponents[insertIndex].componentIndex < componentIndex)
+    {
+        insertIndex++;
     }
 
-    ASSERT(archetypeIndex < context->createdArchetypeCount, "Invalid archetype index");
-    Archetype* archetype = context->archetypes + archetypeIndex;
-    ASSERT(archetype->componentCount == numComponents, "Component counts don't match");
-    u64 allocationSize = 0;
-    for (u32 i = 0; i < archetype->componentCount; ++i)
+    if (insertIndex < *sharedComponentCount && sharedComponents[insertIndex].componentIndex == componentIndex)
     {
-        ArchetypeComponent* archComp = archetype->components + i;
-        u32 componentSize = context->componentSizes[archComp->componentIndex];
-        allocationSize += componentSize;
+        sharedComponents[insertIndex].valueIndex = valueIndex;
+        return;
     }
 
-    // Allocate memory for all components
-    archetype->allocator->Alloc(archetype->allocator->instance, allocationSize);
+    ASSERT(*sharedComponentCount < MAX_ARCHETYPE_SHARED_COMPONENT_COUNT, "Too many shared components");
+    memmove(sharedComponents + insertIndex + 1, sharedComponents + insertIndex, (*sharedComponentCount - insertIndex) * sizeof(ArchetypeSharedComponent));
+    sharedComponents[insertIndex] = ArchetypeSharedComponent { componentIndex, valueIndex };
+    (*sharedComponentCount)++;
+}
 
-    // Insert component data
-    u64 leftComponentsSize = 0;
-    u64 rightComponentsSize = allocationSize;
-    for (u32 i = 0; i < archetype->componentCount; ++i)
+static void RemoveSharedComponentValue(ArchetypeSharedComponent* sharedComponents, u32* sharedComponentCount, u32 componentIndex)
+{
+    for (u32 i = 0; i < *sharedComponentCount; ++i)
+    {
+        if (sharedComponents[i].componentIndex == componentIndex)
+        {
+            memmove(sharedComponents + i, sharedComponents + i + 1, (*sharedComponentCount - i - 1) * sizeof(ArchetypeSharedComponent));
+            (*sharedComponentCount)--;
+            return;
+        }
+    }
+}
+
+static u32 FindArchetypeSharedValue(const Archetype* archetype, Component component)
+{
+    for (u32 i = 0; i < archetype->sharedComponentCount; ++i)
     {
-        ArchetypeComponent* archComp = archetype->components + i;
-        u32 componentSize = context->componentSizes[archComp->componentIndex];
-        u32 entityCount = archetype->entityCount;
+        if (archetype->sharedComponents[i].componentIndex == component.componentIndex)
+        {
+            return archetype->sharedComponents[i].valueIndex;
+        }
+    }
 
-        leftComponentsSize += componentSize;
-        rightComponentsSize -= componentSize;
-        u8* data = archetype->allocator->instance->pointer;
-        u8* start = data + (leftComponentsSize * entityCount) + (leftComponentsSize - componentSize);
-        memmove(start + componentSize, start, rightComponentsSize * entityCount);
+    return NULL_INDEX;
+}
 
-        // Find component data
-        u32 dataIndex = NULL_INDEX;
-        for (u32 componentDataIndex = 0; componentDataIndex < numComponents; ++componentDataIndex)
+// Interns the values of the shared components in the list, componentDatas[i] is the value of components[i]
+static u32 InternSharedComponents(EntityContext* context, const Component* components, void** componentDatas, u32 numComponents,
+                                  ArchetypeSharedComponent* outSharedComponents)
+{
+    u32 sharedComponentCount = 0;
+    for (u32 i = 0; i < numComponents; ++i)
+    {
+        if (IsSharedComponent(context, components[i]))
         {
-            Component* com = components + componentDataIndex;
-            if (archComp->componentIndex == com->componentIndex)
-            {
-                dataIndex = componentDataIndex;
-            }
+            u32 valueIndex = InternSharedValue(context, components[i].componentIndex, componentDatas ? componentDatas[i] : nullptr);
+            SetSharedComponentValue(outSharedComponents, &sharedComponentCount, components[i].componentIndex, valueIndex);
         }
-        ASSERT(dataIndex != NULL_INDEX && dataIndex < numComponents, "Invalid component data index");
+    }
+
+    return sharedComponentCount;
+}
 
-        void* componentData = componentDatas[dataIndex];
-        memcpy((void*) start, componentData, componentSize);
+static u32 FindOrCreateArchetype(EntityContext* context, const EntitySignature* signature,
+                                 const ArchetypeSharedComponent* sharedComponents, u32 sharedComponentCount)
+{
+    // Search an archetype that has matching signature and shared values
+    for (u32 i = 0; i < context->createdArchetypeCount; ++i)
+    {
+        EntitySignature* sig = context->archetypeSignatures + i;
+        const Archetype* archetype = context->archetypes + i;
+        if (EntitySignaturesEqual(signature, sig) && archetype->sharedComponentCount == sharedComponentCount &&
+            memcmp(archetype->sharedComponents, sharedComponents, sharedComponentCount * sizeof(ArchetypeSharedComponent)) == 0)
+        {
+            return i;
+        }
     }
-    archetype->entityCount++;
 
-    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, handle);
-    entityData->archetypeIndex = archetypeIndex;
+    // If not, create archetype
+    ASSERT(context->createdArchetypeCount < MAX_ARCHETYPE_COUNT, "Not enough space for a new archetype");
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    u32 index = context->createdArchetypeCount++;
+    context->archetypeSignatures[index] = *signature;
 
-    return Entity { handle };
+    Archetype archetype = {};
+    // Only reserved address space, rows are committed as the capacity grows
+    archetype.allocator = allocatorAPI->CreateLinearAllocator(Gigabyte(16ULL), Megabyte(1));
+    archetype.entities = CreateDynamicArray<Entity>(allocatorAPI);
+    archetype.entityCount = 0;
+    archetype.capacity = 0;
+    memcpy(archetype.sharedComponents, sharedComponents, sharedComponentCount * sizeof(ArchetypeSharedComponent));
+    archetype.sharedComponentCount = sharedComponentCount;
+    for (u32 componentIndex = NextSignatureComponent(signature, 0); componentIndex < MAX_COMPONENT_TYPE_COUNT;
+         componentIndex = NextSignatureComponent(signature, componentIndex + 1))
+    {
+        if (IsTagComponent(context, Component { componentIndex }))
+        {
+            archetype.tagComponentCount++;
+        }
+        else if (!IsSharedComponent(context, Component { componentIndex }))
+        {
+            ASSERT(archetype.componentCount < MAX_ARCHETYPE_COLUMN_COUNT, "Too many components in an archetype");
+            u32 componentSize = context->componentSizes[componentIndex];
+            archetype.components[archetype.componentCount] = ArchetypeComponent{ componentIndex, componentSize };
+            archetype.columnOffsets[archetype.componentCount] = archetype.rowSize;
+            archetype.componentVersions[archetype.componentCount] = context->changeVersion;
+            archetype.componentCount++;
+            archetype.rowSize += componentSize;
+        }
+    }
 
+    context->archetypes[index] = archetype;
+    return index;
 }
 
-
-Component RegisterComponent(EntityContext* context, const char* componentName, u32 componentSize)
+static void ReserveArchetypeCapacity(Archetype* archetype, u32 requiredCount)
 {
-    u32 existingComponentIndex;
-    bool isRegistered = context->componentTable.Get(componentName, &existingComponentIndex);
-    if (isRegistered)
+    if (requiredCount <= archetype->capacity)
     {
-        return Component{ existingComponentIndex };
+        return;
     }
-    else
+
+    u32 oldCapacity = archetype->capacity;
+    u32 newCapacity = oldCapacity * 2 > requiredCount ? oldCapacity * 2 : requiredCount;
+    newCapacity = newCapacity < 64 ? 64 : newCapacity;
+
+    if (archetype->componentCount > 0)
     {
-        u32 componentIndex = context->registeredComponentCount++;
+        archetype->allocator->Alloc(archetype->allocator->instance, (u64) archetype->rowSize * (newCapacity - oldCapacity));
 
-        context->componentSizes[componentIndex] = componentSize;
-        context->componentTable.Set(componentName, componentIndex);
+        // Move columns starting from the last one, so we don't overwrite columns that aren't moved yet
+        u8* data = archetype->allocator->instance->pointer;
+        for (u32 column = archetype->componentCount; column-- > 0;)
+        {
+            u64 columnOffset = archetype->columnOffsets[column];
+            memmove(data + columnOffset * newCapacity, data + columnOffset * oldCapacity,
+                    (u64) archetype->components[column].componentSize * archetype->entityCount);
+        }
+    }
 
-        return Component{ componentIndex };
+    archetype->capacity = newCapacity;
+}
+
+static void MarkArchetypeChanged(EntityContext* context, Archetype* archetype)
+{
+    for (u32 column = 0; column < archetype->componentCount; ++column)
+    {
+        archetype->componentVersions[column] = context->changeVersion;
     }
 }
 
-void PushSystem(EntityContext* context, IEntitySystem* entitySystem)
+// Adds rows to the end of the archetype and points the entities to them. Component data isn't initialized.
+static u32 AddArchetypeRows(EntityContext* context, u32 archetypeIndex, const Entity* entities, u32 count)
 {
-    context->systems.Append(*entitySystem);
+    Archetype* archetype = context->archetypes + archetypeIndex;
+    ReserveArchetypeCapacity(archetype, archetype->entityCount + count);
+
+    u32 firstRow = archetype->entityCount;
+    for (u32 i = 0; i < count; ++i)
+    {
+        archetype->entities.Append(entities[i]);
+        EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entities[i].handle);
+        entityData->archetypeIndex = archetypeIndex;
+        entityData->row = firstRow + i;
+    }
+    archetype->entityCount += count;
+    MarkArchetypeChanged(context, archetype);
+
+    return firstRow;
 }
 
-void RunSystems(EntityContext* context, ILinearAllocator* frameAllocator)
+// Moves the last row into the removed one
+static void RemoveArchetypeRow(EntityContext* context, Archetype* archetype, u32 row)
+{
+    u32 lastRow = archetype->entityCount - 1;
+    if (row != lastRow)
+    {
+        for (u32 column = 0; column < archetype->componentCount; ++column)
+        {
+            u32 componentSize = archetype->components[column].componentSize;
+            u8* columnData = GetArchetypeColumn(archetype, column);
+            memcpy(columnData + (u64) row * componentSize, columnData + (u64) lastRow * componentSize, componentSize);
+        }
+
+        Entity movedEntity = archetype->entities[lastRow];
+        archetype->entities[row] = movedEntity;
+        EntityData* movedEntityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, movedEntity.handle);
+        movedEntityData->row = row;
+    }
+
+    archetype->entities.PopBack();
+    archetype->entityCount--;
+    MarkArchetypeChanged(context, archetype);
+}
+
+// Moves the entity to the target archetype. Components that the old archetype doesn't have are
+// copied from addedData if it's the added component, otherwise zero initialized.
+static void MoveEntity(EntityContext* context, Entity entity, u32 targetIndex, Component addedComponent, const void* addedData)
 {
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    Archetype* source = context->archetypes + entityData->archetypeIndex;
+    u32 sourceRow = entityData->row;
 
-    u32 numSystems = context->systems.length;
-    for (u32 systemIndex = 0; systemIndex < numSystems; ++systemIndex)
+    u32 targetRow = AddArchetypeRows(context, targetIndex, &entity, 1);
+    Archetype* target = context->archetypes + targetIndex;
+
+    // Both component lists are sorted
+    u32 sourceColumn = 0;
+    for (u32 targetColumn = 0; targetColumn < target->componentCount; ++targetColumn)
     {
-        IEntitySystem system = context->systems[systemIndex];
+        ArchetypeComponent component = target->components[targetColumn];
+        u8* targetData = GetArchetypeColumn(target, targetColumn) + (u64) targetRow * component.componentSize;
 
-        u32 matchedArchetypeCount = 0;
-        u32 numArchetypes = context->createdArchetypeCount;
-        for (u32 archIndex = 0; archIndex < numArchetypes; ++archIndex)
+        while (sourceColumn < source->componentCount && source->components[sourceColumn].componentIndex < component.componentIndex)
         {
-            EntitySignature signature = context->archetypeSignatures[archIndex];
-            bool signatureOkay = system.Filter(context, system.components, system.numComponent, signature);
-            if (signatureOkay) {
-                matchedArchetypeCount++;
-            }
+            sourceColumn++;
         }
 
-        if (matchedArchetypeCount > 0)
+        if (sourceColumn < source->componentCount && source->components[sourceColumn].componentIndex == component.componentIndex)
         {
-            EntitySystemUpdateSet updateSet = {};
-            updateSet.numArrays = matchedArchetypeCount;
-            EntitySystemUpdateArray* array = (EntitySystemUpdateArray*) frameAllocator->Alloc(frameAllocator->instance, matchedArchetypeCount * sizeof(EntitySystemUpdateArray));
-            updateSet.arrays = array;
+            memcpy(targetData, GetArchetypeColumn(source, sourceColumn) + (u64) sourceRow * component.componentSize, component.componentSize);
+        }
+        else if (addedData && component.componentIndex == addedComponent.componentIndex)
+        {
+            memcpy(targetData, addedData, component.componentSize);
+        }
+        else
+        {
+            memset(targetData, 0, component.componentSize);
+        }
+    }
 
-            for (u32 archIndex = 0; archIndex < numArchetypes; ++archIndex)
-            {
-                EntitySignature signature = context->archetypeSignatures[archIndex];
-                bool signatureOkay = system.Filter(context, system.components, system.numComponent, signature);
-                if (signatureOkay) {
-                    Archetype* archetype = context->archetypes + archIndex;
+    RemoveArchetypeRow(context, source, sourceRow);
+}
 
-                    EntitySystemUpdateArray* updateArray = array++;
-                    updateArray->length = archetype->entityCount;
+static Handle ObtainEntityHandle(EntityContext* context)
+{
+    SpinLockAcquire(&context->entityPoolLock);
+    Handle handle = ObtainNewHandleFromPool(&context->entityPool);
+    SpinLockRelease(&context->entityPoolLock);
 
-                    for (u32 systemCompIndex = 0; systemCompIndex < system.numComponent; ++systemCompIndex)
-                    {
-                        Component systemComponent = system.components[systemCompIndex];
+    return handle;
+}
 
-                        // Find system component in archetype components
-                        // TODO: Archetype components is sorted. Maybe implement binary search here.
-                        u32 leftComponentSize = 0;
-                        for (u32 archCompIndex = 0; archCompIndex < archetype->componentCount; ++archCompIndex)
-                        {
-                            ArchetypeComponent archetypeComponent = archetype->components[archCompIndex];
-                            if (archetypeComponent.componentIndex == systemComponent.componentIndex)
-                            {
-                                u8* data = archetype->allocator->instance->pointer + (archetype->entityCount * leftComponentSize);
-                                updateArray->componentData[systemCompIndex] = data;
-                                break;
-                            }
-                            leftComponentSize += archetypeComponent.componentSize;
-                        }
-                    }
-                }
-            }
+Entity CreateEntity(EntityContext* context)
+{
+    Entity entity = Entity { ObtainEntityHandle(context) };
+    AddArchetypeRows(context, 0, &entity, 1);
 
-            system.Update(context, &updateSet, system.userData);
-        }
+    return entity;
+}
+
+static EntitySignature CreateSignature(const Component* components, u32 numComponents)
+{
+    EntitySignature signature = {};
+    for (u32 i = 0; i < numComponents; ++i)
+    {
+        SetSignatureComponent(&signature, components[i].componentIndex, true);
     }
 
+    return signature;
 }
 
-extern "C"
+Entity CreateEntityWithComponents(EntityContext* context, Component* components, void** componentDatas, u32 numComponents)
 {
-    MODULE_EXPORT void LoadPlugin(APIRegistry* registry, bool reload)
+    Entity entity = Entity { ObtainEntityHandle(context) };
+    EntitySignature signature = CreateSignature(components, numComponents);
+    ArchetypeSharedComponent sharedComponents[MAX_ARCHETYPE_SHARED_COMPONENT_COUNT];
+    u32 sharedComponentCount = InternSharedComponents(context, components, componentDatas, numComponents, sharedComponents);
+
+    u32 archetypeIndex = FindOrCreateArchetype(context, &signature, sharedComponents, sharedComponentCount);
+    Archetype* archetype = context->archetypes + archetypeIndex;
+    ASSERT(archetype->componentCount + archetype->sharedComponentCount + archetype->tagComponentCount == numComponents, "Component counts don't match");
+    u32 row = AddArchetypeRows(context, archetypeIndex, &entity, 1);
+
+    // Insert component data
+    for (u32 componentDataIndex = 0; componentDataIndex < numComponents; ++componentDataIndex)
     {
-        gAPIRegistry = registry;
-        EntityAPI entityAPI = {};
-        entityAPI.CreateContext = CreateEntityContext;
-        entityAPI.CreateEntity = CreateEntity;
-        entityAPI.CreateEntityWithComponents = CreateEntityWithComponents;
-        entityAPI.RegisterComponent = RegisterComponent;
-        entityAPI.PushSystem = PushSystem;
-        entityAPI.RunSystems = RunSystems;
-        
+        if (!HasColumn(context, components[componentDataIndex]))
+        {
+            continue;
+        }
 
-        registry->Set(ENTITY_API_NAME, &entityAPI, sizeof(EntityAPI));
+        u32 column = FindArchetypeColumn(archetype, components[componentDataIndex]);
+        ASSERT(column != NULL_INDEX, "Invalid component data index");
+
+        u32 componentSize = archetype->components[column].componentSize;
+        memcpy(GetArchetypeColumn(archetype, column) + (u64) row * componentSize, componentDatas[componentDataIndex], componentSize);
     }
 
-    MODULE_EXPORT void UnloadPlugin(APIRegistry* registry, bool reload)
+    return entity;
+}
+
+void CreateEntitiesBatch(EntityContext* context, Component* components, u32 numComponents, void** columnDatas, u32 entityCount, Entity* outEntities)
+{
+    EntitySignature signature = CreateSignature(components, numComponents);
+    ArchetypeSharedComponent sharedComponents[MAX_ARCHETYPE_SHARED_COMPONENT_COUNT];
+    // Shared columns hold one value for the whole batch
+    u32 sharedComponentCount = InternSharedComponents(context, components, columnDatas, numComponents, sharedComponents);
+
+    u32 archetypeIndex = FindOrCreateArchetype(context, &signature, sharedComponents, sharedComponentCount);
+    Archetype* archetype = context->archetypes + archetypeIndex;
+    ASSERT(archetype->componentCount + archetype->sharedComponentCount + archetype->tagComponentCount == numComponents, "Component counts don't match");
+
+    ReserveArchetypeCapacity(archetype, archetype->entityCount + entityCount);
+    u32 firstRow = archetype->entityCount;
+
+    // Entities are appended a chunk at a time instead of growing the array per entity
+    SpinLockAcquire(&context->entityPoolLock);
+    for (u32 chunkStart = 0; chunkStart < entityCount; chunkStart += ENTITY_BATCH_CHUNK_SIZE)
     {
-        registry->Remove(ENTITY_API_NAME);
+        Entity chunk[ENTITY_BATCH_CHUNK_SIZE];
+        u32 chunkCount = entityCount - chunkStart < ENTITY_BATCH_CHUNK_SIZE ? entityCount - chunkStart : ENTITY_BATCH_CHUNK_SIZE;
+        for (u32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+        {
+            Handle handle = ObtainNewHandleFromPool(&context->entityPool);
+            chunk[chunkIndex] = Entity { handle };
+            EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, handle);
+            entityData->archetypeIndex = archetypeIndex;
+            entityData->row = firstRow + chunkStart + chunkIndex;
+        }
+        archetype->entities.Append(chunk, chunkCount);
     }
-}
\ No newline at end of file
+    SpinLockRelease(&context->entityPoolLock);
+    archetype->entityCount += entityCount;
+    MarkArchetypeChanged(context, archetype);
+
+    for (u32 componentDataIndex = 0; componentDataIndex < numComponents; ++componentDataIndex)
+    {
+        if (!HasColumn(context, components[componentDataIndex]))
+        {
+            continue;
+        }
+
+        u32 column = FindArchetypeColumn(archetype, components[componentDataIndex]);
+        ASSERT(column != NULL_INDEX, "Invalid component data index");
+
+        u64 componentSize = archetype->components[column].componentSize;
+        u8* columnData = GetArchetypeColumn(archetype, column) + firstRow * componentSize;
+        if (columnDatas && columnDatas[componentDataIndex])
+        {
+            memcpy(columnData, columnDatas[componentDataIndex], componentSize * entityCount);
+        }
+        else
+        {
+            memset(columnData, 0, componentSize * entityCount);
+        }
+    }
+
+    if (outEntities)
+    {
+        memcpy(outEntities, archetype->entities.data + firstRow, sizeof(Entity) * entityCount);
+    }
+}
+
+void DestroyEntity(EntityContext* context, Entity entity)
+{
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    if (entityData->archetypeIndex == NULL_INDEX)
+    {
+        // Playback skips the create and releases the handle, so it can't be reused while the create is recorded
+        entityData->row = CANCELLED_CREATE_ROW;
+        return;
+    }
+
+    RemoveArchetypeRow(context, context->archetypes + entityData->archetypeIndex, entityData->row);
+
+    SpinLockAcquire(&context->entityPoolLock);
+    ReleaseHandle(&context->entityPool, entity.handle);
+    SpinLockRelease(&context->entityPoolLock);
+}
+
+bool IsEntityAlive(EntityContext* context, Entity entity)
+{
+    Handle handle = entity.handle;
+    if (handle.index >= context->entityPool.usedCount || context->entityPool.generations[handle.index] != handle.generation)
+    {
+        return false;
+    }
+
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, handle);
+    return entityData->archetypeIndex != NULL_INDEX || entityData->row != CANCELLED_CREATE_ROW;
+}
+
+void AddComponent(EntityContext* context, Entity entity, Component component, void* componentData)
+{
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    ASSERT(entityData->archetypeIndex != NULL_INDEX, "Entity is waiting for command buffer playback");
+
+    EntitySignature signature = context->archetypeSignatures[entityData->archetypeIndex];
+    Archetype* archetype = context->archetypes + entityData->archetypeIndex;
+    ArchetypeSharedComponent sharedComponents[MAX_ARCHETYPE_SHARED_COMPONENT_COUNT];
+    u32 sharedComponentCount = archetype->sharedComponentCount;
+    memcpy(sharedComponents, archetype->sharedComponents, sharedComponentCount * sizeof(ArchetypeSharedComponent));
+
+    if (IsSharedComponent(context, component))
+    {
+        // A different value is a different archetype
+        u32 valueIndex = InternSharedValue(context, component.componentIndex, componentData);
+        SetSharedComponentValue(sharedComponents, &sharedComponentCount, component.componentIndex, valueIndex);
+    }
+    else if (HasEntitySignatureComponent(&signature, component) && IsTagComponent(context, component))
+    {
+        return;
+    }
+    else if (HasEntitySignatureComponent(&signature, component))
+    {
+        // Already has it, just overwrite the data
+        u32 column = FindArchetypeColumn(archetype, component);
+        u32 componentSize = archetype->components[column].componentSize;
+        memcpy(GetArchetypeColumn(archetype, column) + (u64) entityData->row * componentSize, componentData, componentSize);
+        archetype->componentVersions[column] = context->changeVersion;
+        return;
+    }
+
+    SetSignatureComponent(&signature, component.componentIndex, true);
+    u32 targetIndex = FindOrCreateArchetype(context, &signature, sharedComponents, sharedComponentCount);
+    if (targetIndex != entityData->archetypeIndex)
+    {
+        MoveEntity(context, entity, targetIndex, component, componentData);
+    }
+}
+
+void RemoveComponent(EntityContext* context, Entity entity, Component component)
+{
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    ASSERT(entityData->archetypeIndex != NULL_INDEX, "Entity is waiting for command buffer playback");
+
+    EntitySignature signature = context->archetypeSignatures[entityData->archetypeIndex];
+    if (!HasEntitySignatureComponent(&signature, component))
+    {
+        return;
+    }
+
+    Archetype* archetype = context->archetypes + entityData->archetypeIndex;
+    ArchetypeSharedComponent sharedComponents[MAX_ARCHETYPE_SHARED_COMPONENT_COUNT];
+    u32 sharedComponentCount = archetype->sharedComponentCount;
+    memcpy(sharedComponents, archetype->sharedComponents, sharedComponentCount * sizeof(ArchetypeSharedComponent));
+    RemoveSharedComponentValue(sharedComponents, &sharedComponentCount, component.componentIndex);
+
+    SetSignatureComponent(&signature, component.componentIndex, false);
+    u32 targetIndex = FindOrCreateArchetype(context, &signature, sharedComponents, sharedComponentCount);
+    MoveEntity(context, entity, targetIndex, component, nullptr);
+}
+
+
+static Component RegisterComponentWithFlags(EntityContext* context, const char* componentName, u32 componentSize, u32 flags)
+{
+    if (componentSize == 0)
+    {
+        ASSERT(!(flags & COMPONENT_FLAG_SHARED), "Shared components can't be empty");
+        flags |= COMPONENT_FLAG_TAG;
+    }
+
+    u32 existingComponentIndex;
+    bool isRegistered = context->componentTable.Get(componentName, &existingComponentIndex);
+    if (isRegistered)
+    {
+        ASSERT(context->componentFlags[existingComponentIndex] == flags, "Component is already registered with different flags");
+        return Component{ existingComponentIndex };
+    }
+    else
+    {
+        ASSERT(context->registeredComponentCount < MAX_COMPONENT_TYPE_COUNT, "Too many component types");
+        u32 componentIndex = context->registeredComponentCount++;
+
+        context->componentSizes[componentIndex] = componentSize;
+        context->componentFlags[componentIndex] = flags;
+        context->componentNames[componentIndex] = componentName;
+        context->componentTable.Set(componentName, componentIndex);
+        if (flags & COMPONENT_FLAG_SHARED)
+        {
+            SetSignatureComponent(&context->sharedComponentMask, componentIndex, true);
+        }
+
+        return Component{ componentIndex };
+    }
+}
+
+Component RegisterComponent(EntityContext* context, const char* componentName, u32 componentSize)
+{
+    return RegisterComponentWithFlags(context, componentName, componentSize, 0);
+}
+
+Component RegisterSharedComponent(EntityContext* context, const char* componentName, u32 componentSize)
+{
+    return RegisterComponentWithFlags(context, componentName, componentSize, COMPONENT_FLAG_SHARED);
+}
+
+Component RegisterTagComponent(EntityContext* context, const char* componentName)
+{
+    return RegisterComponentWithFlags(context, componentName, 0, COMPONENT_FLAG_TAG);
+}
+
+bool HasComponent(EntityContext* context, Entity entity, Component component)
+{
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    if (!entityData || entityData->archetypeIndex == NULL_INDEX)
+    {
+        return false;
+    }
+
+    return HasEntitySignatureComponent(context->archetypeSignatures + entityData->archetypeIndex, component);
+}
+
+void SetSingletonComponent(EntityContext* context, Component component, const void* componentData)
+{
+    u32 componentSize = context->componentSizes[component.componentIndex];
+    if (!context->singletons[component.componentIndex])
+    {
+        context->singletons[component.componentIndex] = context->allocator->Alloc(context->allocator->instance, componentSize);
+    }
+
+    memcpy(context->singletons[component.componentIndex], componentData, componentSize);
+}
+
+void* GetSingletonComponent(EntityContext* context, Component component)
+{
+    return context->singletons[component.componentIndex];
+}
+
+void* GetComponentData(EntityContext* context, Entity entity, Component component)
+{
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    if (!entityData || entityData->archetypeIndex == NULL_INDEX)
+    {
+        return nullptr;
+    }
+
+    Archetype* archetype = context->archetypes + entityData->archetypeIndex;
+    u32 column = FindArchetypeColumn(archetype, component);
+    if (column == NULL_INDEX)
+    {
+        u32 valueIndex = FindArchetypeSharedValue(archetype, component);
+        return valueIndex != NULL_INDEX ? GetSharedValueData(context, valueIndex) : nullptr;
+    }
+
+    return GetArchetypeColumn(archetype, column) + (u64) entityData->row * archetype->components[column].componentSize;
+}
+
+void MarkComponentChanged(EntityContext* context, Entity entity, Component component)
+{
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    if (entityData->archetypeIndex == NULL_INDEX)
+    {
+        return;
+    }
+
+    Archetype* archetype = context->archetypes + entityData->archetypeIndex;
+    u32 column = FindArchetypeColumn(archetype, component);
+    if (column != NULL_INDEX)
+    {
+        archetype->componentVersions[column] = context->changeVersion;
+    }
+}
+
+EntityCommandBuffer* AcquireCommandBuffer(EntityContext* context)
+{
+    SpinLockAcquire(&context->commandBufferLock);
+
+    EntityCommandBuffer* commandBuffer = nullptr;
+    for (u32 bufferIndex = 0; bufferIndex < context->commandBufferCount; ++bufferIndex)
+    {
+        if (!context->commandBuffers[bufferIndex].acquired)
+        {
+            commandBuffer = context->commandBuffers + bufferIndex;
+            break;
+        }
+    }
+
+    if (!commandBuffer)
+    {
+        ASSERT(context->commandBufferCount < MAX_COMMAND_BUFFER_COUNT, "Not enough command buffers, play them back more often");
+        AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+        commandBuffer = context->commandBuffers + context->commandBufferCount++;
+        commandBuffer->context = context;
+        commandBuffer->creates = CreateDynamicArray<CreateEntityCommand>(allocatorAPI);
+        commandBuffer->commands = CreateDynamicArray<EntityCommand>(allocatorAPI);
+        commandBuffer->dataAllocator = allocatorAPI->CreateLinearAllocator(Gigabyte(1), Megabyte(1));
+    }
+    commandBuffer->acquired = true;
+
+    SpinLockRelease(&context->commandBufferLock);
+
+    return commandBuffer;
+}
+
+static u64 CopyCommandData(EntityCommandBuffer* commandBuffer, const void* data, u32 size)
+{
+    u64 offset = commandBuffer->dataAllocator->instance->startOffset;
+    if (size > 0)
+    {
+        void* destination = commandBuffer->dataAllocator->Alloc(commandBuffer->dataAllocator->instance, size);
+        memcpy(destination, data, size);
+    }
+
+    return offset;
+}
+
+Entity DeferCreateEntity(EntityCommandBuffer* commandBuffer, Component* components, void** componentDatas, u32 numComponents)
+{
+    EntityContext* context = commandBuffer->context;
+
+    // Handle is reserved now, so the caller can reference the entity in other commands
+    Entity entity = Entity { ObtainEntityHandle(context) };
+    EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entity.handle);
+    entityData->archetypeIndex = NULL_INDEX;
+    entityData->row = NULL_INDEX;
+
+    CreateEntityCommand command = {};
+    command.entity = entity;
+    command.signature = CreateSignature(components, numComponents);
+    command.dataOffset = commandBuffer->dataAllocator->instance->startOffset;
+
+    // Pack the data in component index order, shared values included
+    for (u32 componentIndex = NextSignatureComponent(&command.signature, 0); componentIndex < MAX_COMPONENT_TYPE_COUNT;
+         componentIndex = NextSignatureComponent(&command.signature, componentIndex + 1))
+    {
+        for (u32 componentDataIndex = 0; componentDataIndex < numComponents; ++componentDataIndex)
+        {
+            if (components[componentDataIndex].componentIndex == componentIndex)
+            {
+                CopyCommandData(commandBuffer, componentDatas[componentDataIndex], context->componentSizes[componentIndex]);
+                break;
+            }
+        }
+    }
+
+    commandBuffer->creates.Append(command);
+    return entity;
+}
+
+void DeferDestroyEntity(EntityCommandBuffer* commandBuffer, Entity entity)
+{
+    EntityCommand command = {};
+    command.type = ENTITY_COMMAND_DESTROY;
+    command.entity = entity;
+    commandBuffer->commands.Append(command);
+}
+
+void DeferAddComponent(EntityCommandBuffer* commandBuffer, Entity entity, Component component, void* componentData)
+{
+    EntityCommand command = {};
+    command.type = ENTITY_COMMAND_ADD_COMPONENT;
+    command.entity = entity;
+    command.component = component;
+    command.dataOffset = CopyCommandData(commandBuffer, componentData, commandBuffer->context->componentSizes[component.componentIndex]);
+    commandBuffer->commands.Append(command);
+}
+
+void DeferRemoveComponent(EntityCommandBuffer* commandBuffer, Entity entity, Component component)
+{
+    EntityCommand command = {};
+    command.type = ENTITY_COMMAND_REMOVE_COMPONENT;
+    command.entity = entity;
+    command.component = component;
+    commandBuffer->commands.Append(command);
+}
+
+static int ComparePendingCreates(const void* a, const void* b)
+{
+    const PendingCreate* left = (const PendingCreate*) a;
+    const PendingCreate* right = (const PendingCreate*) b;
+    if (left->archetypeIndex != right->archetypeIndex)
+    {
+        return left->archetypeIndex < right->archetypeIndex ? -1 : 1;
+    }
+
+    return (int) left->entity.handle.index - (int) right->entity.handle.index;
+}
+
+// Handles of cancelled creates are added to the pending releases
+static void PlaybackCreates(EntityContext* context)
+{
+    context->pendingCreates.Clear();
+    for (u32 bufferIndex = 0; bufferIndex < context->commandBufferCount; ++bufferIndex)
+    {
+        EntityCommandBuffer* commandBuffer = context->commandBuffers + bufferIndex;
+        const u8* commandData = commandBuffer->dataAllocator->instance->pointer;
+
+        // Most of the time consecutive entities have the same signature. Shared values can differ, so those aren't cached.
+        const EntitySignature* lastSignature = nullptr;
+        u32 lastArchetypeIndex = NULL_INDEX;
+        for (u32 commandIndex = 0; commandIndex < commandBuffer->creates.length; ++commandIndex)
+        {
+            const CreateEntityCommand* command = &commandBuffer->creates[commandIndex];
+            EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, command->entity.handle);
+            if (entityData->row == CANCELLED_CREATE_ROW)
+            {
+                context->pendingReleases.Append(command->entity);
+                continue;
+            }
+
+            if (HasSharedComponents(context, &command->signature))
+            {
+                ArchetypeSharedComponent sharedComponents[MAX_ARCHETYPE_SHARED_COMPONENT_COUNT];
+                u32 sharedComponentCount = 0;
+                const u8* data = commandData + command->dataOffset;
+                for (u32 componentIndex = NextSignatureComponent(&command->signature, 0); componentIndex < MAX_COMPONENT_TYPE_COUNT;
+                     componentIndex = NextSignatureComponent(&command->signature, componentIndex + 1))
+                {
+                    if (IsSharedComponent(context, Component { componentIndex }))
+                    {
+                        u32 valueIndex = InternSharedValue(context, componentIndex, data);
+                        SetSharedComponentValue(sharedComponents, &sharedComponentCount, componentIndex, valueIndex);
+                    }
+                    data += context->componentSizes[componentIndex];
+                }
+
+                lastArchetypeIndex = FindOrCreateArchetype(context, &command->signature, sharedComponents, sharedComponentCount);
+                lastSignature = nullptr;
+            }
+            else if (!lastSignature || !EntitySignaturesEqual(lastSignature, &command->signature))
+            {
+                lastArchetypeIndex = FindOrCreateArchetype(context, &command->signature, nullptr, 0);
+                lastSignature = &command->signature;
+            }
+
+            context->pendingCreates.Append(PendingCreate { lastArchetypeIndex, command->entity, commandData + command->dataOffset });
+        }
+    }
+
+    u32 createCount = context->pendingCreates.length;
+    if (createCount == 0)
+    {
+        return;
+    }
+
+    qsort(context->pendingCreates.data, createCount, sizeof(PendingCreate), ComparePendingCreates);
+    context->pendingCreateEntities.Clear();
+    for (u32 createIndex = 0; createIndex < createCount; ++createIndex)
+    {
+        context->pendingCreateEntities.Append(context->pendingCreates[createIndex].entity);
+    }
+
+    // Each archetype gets the rows of all of its new entities at once, then columns are filled one at a time
+    u32 groupStart = 0;
+    while (groupStart < createCount)
+    {
+        u32 archetypeIndex = context->pendingCreates[groupStart].archetypeIndex;
+        u32 groupEnd = groupStart + 1;
+        while (groupEnd < createCount && context->pendingCreates[groupEnd].archetypeIndex == archetypeIndex)
+        {
+            groupEnd++;
+        }
+
+        Archetype* archetype = context->archetypes + archetypeIndex;
+        u32 firstRow = AddArchetypeRows(context, archetypeIndex, context->pendingCreateEntities.data + groupStart, groupEnd - groupStart);
+
+        // Data is packed in component index order, shared values are in it too. Creates of an archetype have the same layout.
+        u64 dataOffset = 0;
+        u32 sharedComponentIndex = 0;
+        for (u32 column = 0; column < archetype->componentCount; ++column)
+        {
+            ArchetypeComponent component = archetype->components[column];
+            while (sharedComponentIndex < archetype->sharedComponentCount &&
+                   archetype->sharedComponents[sharedComponentIndex].componentIndex < component.componentIndex)
+            {
+                dataOffset += context->componentSizes[archetype->sharedComponents[sharedComponentIndex++].componentIndex];
+            }
+
+            u8* columnData = GetArchetypeColumn(archetype, column) + (u64) firstRow * component.componentSize;
+            for (u32 createIndex = groupStart; createIndex < groupEnd; ++createIndex)
+            {
+                memcpy(columnData, context->pendingCreates[createIndex].data + dataOffset, component.componentSize);
+                columnData += component.componentSize;
+            }
+            dataOffset += component.componentSize;
+        }
+
+        groupStart = groupEnd;
+    }
+}
+
+// Applies recorded commands. Creations are applied first, then the rest of the commands in recording order.
+void PlaybackCommandBuffers(EntityContext* context)
+{
+    context->pendingReleases.Clear();
+    PlaybackCreates(context);
+
+    for (u32 bufferIndex = 0; bufferIndex < context->commandBufferCount; ++bufferIndex)
+    {
+        EntityCommandBuffer* commandBuffer = context->commandBuffers + bufferIndex;
+        const u8* commandData = commandBuffer->dataAllocator->instance->pointer;
+
+        for (u32 commandIndex = 0; commandIndex < commandBuffer->commands.length; ++commandIndex)
+        {
+            const EntityCommand* command = &commandBuffer->commands[commandIndex];
+            EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, command->entity.handle);
+
+            // Destroyed by an earlier command or before its create is played back
+            if (entityData->archetypeIndex == NULL_INDEX)
+            {
+                continue;
+            }
+
+            switch (command->type)
+            {
+                case ENTITY_COMMAND_DESTROY:
+                {
+                    RemoveArchetypeRow(context, context->archetypes + entityData->archetypeIndex, entityData->row);
+                    entityData->archetypeIndex = NULL_INDEX;
+                    context->pendingReleases.Append(command->entity);
+                } break;
+                case ENTITY_COMMAND_ADD_COMPONENT:
+                {
+                    AddComponent(context, command->entity, command->component, (void*) (commandData + command->dataOffset));
+                } break;
+                case ENTITY_COMMAND_REMOVE_COMPONENT:
+                {
+                    RemoveComponent(context, command->entity, command->component);
+                } break;
+            }
+        }
+
+        commandBuffer->creates.Clear();
+        commandBuffer->commands.Clear();
+        commandBuffer->dataAllocator->instance->startOffset = 0;
+        commandBuffer->acquired = false;
+    }
+
+    // Handles are released at the end so later commands of destroyed entities are skipped instead of hitting a stale handle
+    SpinLockAcquire(&context->entityPoolLock);
+    for (u32 releaseIndex = 0; releaseIndex < context->pendingReleases.length; ++releaseIndex)
+    {
+        ReleaseHandle(&context->entityPool, context->pendingReleases[releaseIndex].handle);
+    }
+    SpinLockRelease(&context->entityPoolLock);
+}
+
+void RegisterComponentHandle(EntityContext* context, Component component, u32 fieldOffset, u32 handleType)
+{
+    for (u32 fieldIndex = 0; fieldIndex < context->handleFieldCount; ++fieldIndex)
+    {
+        ComponentHandleField* field = context->handleFields + fieldIndex;
+        if (field->componentIndex == component.componentIndex && field->fieldOffset == fieldOffset)
+        {
+            field->handleType = handleType;
+            return;
+        }
+    }
+
+    ASSERT(context->handleFieldCount < MAX_COMPONENT_HANDLE_FIELD_COUNT, "Too many component handle fields");
+    ASSERT(fieldOffset + sizeof(Handle) <= context->componentSizes[component.componentIndex], "Handle field is out of component");
+    context->handleFields[context->handleFieldCount++] = ComponentHandleField { component.componentIndex, fieldOffset, handleType };
+}
+
+// Snapshot layout, offsets are relative to the start of the snapshot:
+// SnapshotHeader
+// SnapshotComponent[componentCount]
+// SnapshotArchetype[archetypeCount]
+// SnapshotColumn[columnCount]
+// SnapshotSharedValue[sharedValueCount]
+// SnapshotRelocation[relocationCount]
+// u32 tag component indices[tagCount]
+// Column and shared value data, every block starts at SNAPSHOT_ALIGNMENT
+// Entity handles in columns are replaced with snapshot entity indices, which is the first entity of the archetype plus the row.
+#define SNAPSHOT_MAGIC 0x53434549 // IECS
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_ALIGNMENT 64
+#define SNAPSHOT_NAME_LENGTH 64
+
+struct SnapshotHeader
+{
+    u32 magic;
+    u32 version;
+    u32 componentCount;
+    u32 archetypeCount;
+    u32 columnCount;
+    u32 sharedValueCount;
+    u32 relocationCount;
+    u32 tagCount;
+    u32 entityCount;
+    u32 padding;
+    u64 size;
+};
+
+struct SnapshotComponent
+{
+    char name[SNAPSHOT_NAME_LENGTH];
+    u32 size;
+    u32 flags;
+};
+
+struct SnapshotArchetype
+{
+    u32 entityCount;
+    u32 firstEntity;
+    u32 firstColumn;
+    u32 columnCount;
+    u32 firstSharedValue;
+    u32 sharedValueCount;
+    u32 firstTag;
+    u32 tagCount;
+};
+
+struct SnapshotColumn
+{
+    u32 componentIndex;
+    u32 componentSize;
+    u32 entityCount;
+    u32 padding;
+    u64 dataOffset;
+};
+
+// Shared values are stored per archetype, loading interns them again
+struct SnapshotSharedValue
+{
+    u32 componentIndex;
+    u32 componentSize;
+    u64 dataOffset;
+};
+
+enum SnapshotRelocationFlag
+{
+    // Target is a shared value instead of a column
+    SNAPSHOT_RELOCATION_SHARED_VALUE = BIT(0)
+};
+
+struct SnapshotRelocation
+{
+    u32 target;
+    u32 fieldOffset;
+    u32 handleType;
+    u32 flags;
+};
+
+static inline u64 AlignSnapshotOffset(u64 offset)
+{
+    return (offset + SNAPSHOT_ALIGNMENT - 1) & ~((u64) SNAPSHOT_ALIGNMENT - 1);
+}
+
+static u32 CountComponentHandleFields(const EntityContext* context, u32 componentIndex)
+{
+    u32 count = 0;
+    for (u32 fieldIndex = 0; fieldIndex < context->handleFieldCount; ++fieldIndex)
+    {
+        count += context->handleFields[fieldIndex].componentIndex == componentIndex;
+    }
+    return count;
+}
+
+// Adds the relocations of the component's handle fields and replaces entity handles in data with snapshot entity indices
+static SnapshotRelocation* WriteSnapshotRelocations(EntityContext* context, const u32* firstEntities, ArchetypeComponent component,
+                                                    u8* data, u32 count, u32 target, u32 flags, SnapshotRelocation* relocations)
+{
+    for (u32 fieldIndex = 0; fieldIndex < context->handleFieldCount; ++fieldIndex)
+    {
+        ComponentHandleField field = context->handleFields[fieldIndex];
+        if (field.componentIndex != component.componentIndex)
+        {
+            continue;
+        }
+
+        *relocations++ = SnapshotRelocation { target, field.fieldOffset, field.handleType, flags };
+        if (field.handleType != ENTITY_HANDLE_TYPE)
+        {
+            continue;
+        }
+
+        for (u32 row = 0; row < count; ++row)
+        {
+            u8* fieldData = data + (u64) row * component.componentSize + field.fieldOffset;
+            Handle handle;
+            memcpy(&handle, fieldData, sizeof(Handle));
+
+            // References to destroyed entities are saved as invalid
+            u32 snapshotEntity = NULL_INDEX;
+            if (handle.index < context->entityPool.usedCount && context->entityPool.generations[handle.index] == handle.generation)
+            {
+                EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, handle);
+                if (entityData->archetypeIndex != NULL_INDEX)
+                {
+                    snapshotEntity = firstEntities[entityData->archetypeIndex] + entityData->row;
+                }
+            }
+            memcpy(fieldData, &snapshotEntity, sizeof(u32));
+        }
+    }
+
+    return relocations;
+}
+
+void* SaveSnapshot(EntityContext* context, ILinearAllocator* allocator, u64* outSize)
+{
+    // Archetypes are written in order, so snapshot entity indices are a prefix sum of the entity counts
+    u32 firstEntities[MAX_ARCHETYPE_COUNT];
+    u32 entityCount = 0;
+    u32 archetypeCount = 0;
+    u32 columnCount = 0;
+    u32 sharedValueCount = 0;
+    u32 relocationCount = 0;
+    u32 tagCount = 0;
+    for (u32 archIndex = 0; archIndex < context->createdArchetypeCount; ++archIndex)
+    {
+        const Archetype* archetype = context->archetypes + archIndex;
+        firstEntities[archIndex] = entityCount;
+        if (archetype->entityCount == 0)
+        {
+            continue;
+        }
+
+        entityCount += archetype->entityCount;
+        archetypeCount++;
+        columnCount += archetype->componentCount;
+        sharedValueCount += archetype->sharedComponentCount;
+        tagCount += archetype->tagComponentCount;
+        for (u32 column = 0; column < archetype->componentCount; ++column)
+        {
+            relocationCount += CountComponentHandleFields(context, archetype->components[column].componentIndex);
+        }
+        for (u32 sharedIndex = 0; sharedIndex < archetype->sharedComponentCount; ++sharedIndex)
+        {
+            relocationCount += CountComponentHandleFields(context, archetype->sharedComponents[sharedIndex].componentIndex);
+        }
+    }
+
+    u64 tablesSize = sizeof(SnapshotHeader) + sizeof(SnapshotComponent) * context->registeredComponentCount +
+                     sizeof(SnapshotArchetype) * archetypeCount + sizeof(SnapshotColumn) * columnCount +
+                     sizeof(SnapshotSharedValue) * sharedValueCount + sizeof(SnapshotRelocation) * relocationCount + sizeof(u32) * tagCount;
+    u64 size = AlignSnapshotOffset(tablesSize);
+    for (u32 archIndex = 0; archIndex < context->createdArchetypeCount; ++archIndex)
+    {
+        const Archetype* archetype = context->archetypes + archIndex;
+        if (archetype->entityCount == 0)
+        {
+            continue;
+        }
+
+        for (u32 column = 0; column < archetype->componentCount; ++column)
+        {
+            size = AlignSnapshotOffset(size + (u64) archetype->components[column].componentSize * archetype->entityCount);
+        }
+        for (u32 sharedIndex = 0; sharedIndex < archetype->sharedComponentCount; ++sharedIndex)
+        {
+            size = AlignSnapshotOffset(size + context->componentSizes[archetype->sharedComponents[sharedIndex].componentIndex]);
+        }
+    }
+
+    // Padding between blocks is zeroed too, so the same context always gives the same bytes
+    u8* snapshot = (u8*) allocator->Alloc(allocator->instance, size);
+    memset(snapshot, 0, size);
+
+    SnapshotHeader* header = (SnapshotHeader*) snapshot;
+    header->magic = SNAPSHOT_MAGIC;
+    header->version = SNAPSHOT_VERSION;
+    header->componentCount = context->registeredComponentCount;
+    header->archetypeCount = archetypeCount;
+    header->columnCount = columnCount;
+    header->sharedValueCount = sharedValueCount;
+    header->relocationCount = relocationCount;
+    header->tagCount = tagCount;
+    header->entityCount = entityCount;
+    header->size = size;
+
+    SnapshotComponent* components = (SnapshotComponent*) (header + 1);
+    for (u32 componentIndex = 0; componentIndex < context->registeredComponentCount; ++componentIndex)
+    {
+        ASSERT(strlen(context->componentNames[componentIndex]) < SNAPSHOT_NAME_LENGTH, "Component name is too long for snapshot");
+        strcpy(components[componentIndex].name, context->componentNames[componentIndex]);
+        components[componentIndex].size = context->componentSizes[componentIndex];
+        components[componentIndex].flags = context->componentFlags[componentIndex];
+    }
+
+    SnapshotArchetype* archetypes = (SnapshotArchetype*) (components + context->registeredComponentCount);
+    SnapshotColumn* columns = (SnapshotColumn*) (archetypes + archetypeCount);
+    SnapshotSharedValue* sharedValues = (SnapshotSharedValue*) (columns + columnCount);
+    SnapshotRelocation* relocations = (SnapshotRelocation*) (sharedValues + sharedValueCount);
+    u32* tags = (u32*) (relocations + relocationCount);
+
+    u64 dataOffset = AlignSnapshotOffset(tablesSize);
+    u32 columnIndex = 0;
+    u32 sharedValueIndex = 0;
+    u32 tagIndex = 0;
+    for (u32 archIndex = 0; archIndex < context->createdArchetypeCount; ++archIndex)
+    {
+        const Archetype* archetype = context->archetypes + archIndex;
+        if (archetype->entityCount == 0)
+        {
+            continue;
+        }
+
+        SnapshotArchetype* snapshotArchetype = archetypes++;
+        snapshotArchetype->entityCount = archetype->entityCount;
+        snapshotArchetype->firstEntity = firstEntities[archIndex];
+        snapshotArchetype->firstColumn = columnIndex;
+        snapshotArchetype->columnCount = archetype->componentCount;
+        snapshotArchetype->firstSharedValue = sharedValueIndex;
+        snapshotArchetype->sharedValueCount = archetype->sharedComponentCount;
+        snapshotArchetype->firstTag = tagIndex;
+        snapshotArchetype->tagCount = archetype->tagComponentCount;
+
+        const EntitySignature* signature = context->archetypeSignatures + archIndex;
+        for (u32 componentIndex = NextSignatureComponent(signature, 0); componentIndex < MAX_COMPONENT_TYPE_COUNT;
+             componentIndex = NextSignatureComponent(signature, componentIndex + 1))
+        {
+            if (IsTagComponent(context, Component { componentIndex }))
+            {
+                tags[tagIndex++] = componentIndex;
+            }
+        }
+
+        for (u32 column = 0; column < archetype->componentCount; ++column, ++columnIndex)
+        {
+            ArchetypeComponent component = archetype->components[column];
+            u8* columnData = snapshot + dataOffset;
+            memcpy(columnData, GetArchetypeColumn(archetype, column), (u64) component.componentSize * archetype->entityCount);
+
+            columns[columnIndex] = SnapshotColumn { component.componentIndex, component.componentSize, archetype->entityCount, 0, dataOffset };
+            dataOffset = AlignSnapshotOffset(dataOffset + (u64) component.componentSize * archetype->entityCount);
+
+            relocations = WriteSnapshotRelocations(context, firstEntities, component, columnData, archetype->entityCount, columnIndex, 0, relocations);
+        }
+
+        for (u32 sharedIndex = 0; sharedIndex < archetype->sharedComponentCount; ++sharedIndex, ++sharedValueIndex)
+        {
+            ArchetypeSharedComponent sharedComponent = archetype->sharedComponents[sharedIndex];
+            ArchetypeComponent component = { sharedComponent.componentIndex, context->componentSizes[sharedComponent.componentIndex] };
+            u8* valueData = snapshot + dataOffset;
+            memcpy(valueData, GetSharedValueData(context, sharedComponent.valueIndex), component.componentSize);
+
+            sharedValues[sharedValueIndex] = SnapshotSharedValue { component.componentIndex, component.componentSize, dataOffset };
+            dataOffset = AlignSnapshotOffset(dataOffset + component.componentSize);
+
+            relocations = WriteSnapshotRelocations(context, firstEntities, component, valueData, 1, sharedValueIndex,
+                                                   SNAPSHOT_RELOCATION_SHARED_VALUE, relocations);
+        }
+    }
+
+    *outSize = size;
+    return snapshot;
+}
+
+// Patches the relocated handle field of count components in data
+static void ApplySnapshotRelocation(const SnapshotRelocation* relocation, u8* data, u32 count, u32 componentSize,
+                                    const Entity* entities, u32 entityCount, SnapshotRelocateHandle relocate, void* userData)
+{
+    if (relocation->handleType != ENTITY_HANDLE_TYPE && !relocate)
+    {
+        return;
+    }
+
+    u8* fieldData = data + relocation->fieldOffset;
+    for (u32 row = 0; row < count; ++row, fieldData += componentSize)
+    {
+        Handle handle;
+        if (relocation->handleType == ENTITY_HANDLE_TYPE)
+        {
+            u32 snapshotEntity;
+            memcpy(&snapshotEntity, fieldData, sizeof(u32));
+            handle = snapshotEntity < entityCount ? entities[snapshotEntity].handle : INVALID_HANDLE;
+        }
+        else
+        {
+            memcpy(&handle, fieldData, sizeof(Handle));
+            handle = relocate(userData, relocation->handleType, handle);
+        }
+        memcpy(fieldData, &handle, sizeof(Handle));
+    }
+}
+
+static inline bool SnapshotRangeValid(u64 first, u64 count, u64 total)
+{
+    return first <= total && count <= total - first;
+}
+
+// Checks every table index and data range against the snapshot size, so loading doesn't read outside of it
+static bool ValidateSnapshot(const u8* snapshot, u64 size)
+{
+    const SnapshotHeader* header = (const SnapshotHeader*) snapshot;
+    if (size < sizeof(SnapshotHeader) || header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION || header->size > size ||
+        header->componentCount > MAX_COMPONENT_TYPE_COUNT || header->entityCount > MAX_ENTITY_COUNT)
+    {
+        return false;
+    }
+
+    u64 tablesSize = sizeof(SnapshotHeader) + sizeof(SnapshotComponent) * header->componentCount +
+                     sizeof(SnapshotArchetype) * header->archetypeCount + sizeof(SnapshotColumn) * header->columnCount +
+                     sizeof(SnapshotSharedValue) * header->sharedValueCount + sizeof(SnapshotRelocation) * header->relocationCount +
+                     sizeof(u32) * header->tagCount;
+    if (tablesSize > size)
+    {
+        return false;
+    }
+
+    const SnapshotComponent* components = (const SnapshotComponent*) (header + 1);
+    const SnapshotArchetype* archetypes = (const SnapshotArchetype*) (components + header->componentCount);
+    const SnapshotColumn* columns = (const SnapshotColumn*) (archetypes + header->archetypeCount);
+    const SnapshotSharedValue* sharedValues = (const SnapshotSharedValue*) (columns + header->columnCount);
+    const SnapshotRelocation* relocations = (const SnapshotRelocation*) (sharedValues + header->sharedValueCount);
+    const u32* tags = (const u32*) (relocations + header->relocationCount);
+
+    for (u32 componentIndex = 0; componentIndex < header->componentCount; ++componentIndex)
+    {
+        const SnapshotComponent* component = components + componentIndex;
+        bool isTag = component->flags == COMPONENT_FLAG_TAG;
+        if (!memchr(component->name, 0, SNAPSHOT_NAME_LENGTH) || (component->flags & ~(COMPONENT_FLAG_SHARED | COMPONENT_FLAG_TAG)) ||
+            isTag != (component->size == 0))
+        {
+            return false;
+        }
+    }
+
+    // Archetypes own consecutive ranges of the tables, so every entity, column, shared value and tag belongs to one archetype
+    u64 entityCount = 0;
+    u64 columnCount = 0;
+    u64 sharedValueCount = 0;
+    u64 tagCount = 0;
+    for (u32 archIndex = 0; archIndex < header->archetypeCount; ++archIndex)
+    {
+        const SnapshotArchetype* archetype = archetypes + archIndex;
+        if (archetype->firstEntity != entityCount || archetype->firstColumn != columnCount || archetype->firstSharedValue != sharedValueCount ||
+            archetype->firstTag != tagCount || archetype->columnCount > MAX_ARCHETYPE_COLUMN_COUNT ||
+            archetype->sharedValueCount > MAX_ARCHETYPE_SHARED_COMPONENT_COUNT)
+        {
+            return false;
+        }
+        entityCount += archetype->entityCount;
+        columnCount += archetype->columnCount;
+        sharedValueCount += archetype->sharedValueCount;
+        tagCount += archetype->tagCount;
+        if (entityCount > header->entityCount || columnCount > header->columnCount || sharedValueCount > header->sharedValueCount ||
+            tagCount > header->tagCount)
+        {
+            return false;
+        }
+
+        // Relocations patch entityCount rows of a column, so columns have to be as long as their archetype
+        for (u32 column = 0; column < archetype->columnCount; ++column)
+        {
+            if (columns[archetype->firstColumn + column].entityCount != archetype->entityCount)
+            {
+                return false;
+            }
+        }
+    }
+    if (entityCount != header->entityCount || columnCount != header->columnCount || sharedValueCount != header->sharedValueCount ||
+        tagCount != header->tagCount)
+    {
+        return false;
+    }
+
+    for (u32 columnIndex = 0; columnIndex < header->columnCount; ++columnIndex)
+    {
+        const SnapshotColumn* column = columns + columnIndex;
+        if (column->componentIndex >= header->componentCount || column->componentSize != components[column->componentIndex].size ||
+            (components[column->componentIndex].flags & (COMPONENT_FLAG_SHARED | COMPONENT_FLAG_TAG)) ||
+            !SnapshotRangeValid(column->dataOffset, (u64) column->componentSize * column->entityCount, size))
+        {
+            return false;
+        }
+    }
+
+    for (u32 valueIndex = 0; valueIndex < header->sharedValueCount; ++valueIndex)
+    {
+        const SnapshotSharedValue* sharedValue = sharedValues + valueIndex;
+        if (sharedValue->componentIndex >= header->componentCount || sharedValue->componentSize != components[sharedValue->componentIndex].size ||
+            !(components[sharedValue->componentIndex].flags & COMPONENT_FLAG_SHARED) ||
+            !SnapshotRangeValid(sharedValue->dataOffset, sharedValue->componentSize, size))
+        {
+            return false;
+        }
+    }
+
+    for (u32 tagIndex = 0; tagIndex < header->tagCount; ++tagIndex)
+    {
+        if (tags[tagIndex] >= header->componentCount || !(components[tags[tagIndex]].flags & COMPONENT_FLAG_TAG))
+        {
+            return false;
+        }
+    }
+
+    for (u32 relocationIndex = 0; relocationIndex < header->relocationCount; ++relocationIndex)
+    {
+        const SnapshotRelocation* relocation = relocations + relocationIndex;
+        bool sharedValue = relocation->flags & SNAPSHOT_RELOCATION_SHARED_VALUE;
+        u32 targetCount = sharedValue ? header->sharedValueCount : header->columnCount;
+        if (relocation->target >= targetCount)
+        {
+            return false;
+        }
+
+        u32 componentSize = sharedValue ? sharedValues[relocation->target].componentSize : columns[relocation->target].componentSize;
+        if (!SnapshotRangeValid(relocation->fieldOffset, sizeof(Handle), componentSize))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool LoadSnapshot(EntityContext* context, const void* snapshotData, u64 size, SnapshotRelocateHandle relocate, void* userData)
+{
+    const u8* snapshot = (const u8*) snapshotData;
+    const SnapshotHeader* header = (const SnapshotHeader*) snapshot;
+    if (!ValidateSnapshot(snapshot, size))
+    {
+        return false;
+    }
+
+    const SnapshotComponent* components = (const SnapshotComponent*) (header + 1);
+    const SnapshotArchetype* archetypes = (const SnapshotArchetype*) (components + header->componentCount);
+    const SnapshotColumn* columns = (const SnapshotColumn*) (archetypes + header->archetypeCount);
+    const SnapshotSharedValue* sharedValues = (const SnapshotSharedValue*) (columns + header->columnCount);
+    const SnapshotRelocation* relocations = (const SnapshotRelocation*) (sharedValues + header->sharedValueCount);
+    const u32* tags = (const u32*) (relocations + header->relocationCount);
+
+    // Components registered with a different layout can't be loaded, check them before anything is added
+    u32 missingComponentCount = 0;
+    for (u32 componentIndex = 0; componentIndex < header->componentCount; ++componentIndex)
+    {
+        const SnapshotComponent* component = components + componentIndex;
+        u32 existingComponentIndex;
+        if (!context->componentTable.Get(component->name, &existingComponentIndex))
+        {
+            missingComponentCount++;
+        }
+        else if (context->componentSizes[existingComponentIndex] != component->size || context->componentFlags[existingComponentIndex] != component->flags)
+        {
+            return false;
+        }
+    }
+    if (context->registeredComponentCount + missingComponentCount > MAX_COMPONENT_TYPE_COUNT)
+    {
+        return false;
+    }
+
+    // Handles come from the free list first, then from the elements that were never used
+    HandlePool* entityPool = &context->entityPool;
+    SpinLockAcquire(&context->entityPoolLock);
+    u64 freeHandleCount = entityPool->elementCount - entityPool->usedCount;
+    for (u32 freeIndex = entityPool->freeIndex; freeIndex != NULL_INDEX && freeHandleCount < header->entityCount;
+         freeIndex = ((EmptyPoolData*) (entityPool->data + (u64) freeIndex * entityPool->resourceSize))->nextFreeIndex)
+    {
+        freeHandleCount++;
+    }
+    SpinLockRelease(&context->entityPoolLock);
+    if (freeHandleCount < header->entityCount)
+    {
+        return false;
+    }
+
+    // Snapshot component indices to ours, registering the missing ones
+    Component componentMap[MAX_COMPONENT_TYPE_COUNT];
+    for (u32 componentIndex = 0; componentIndex < header->componentCount; ++componentIndex)
+    {
+        const SnapshotComponent* component = components + componentIndex;
+        u32 existingComponentIndex;
+        if (context->componentTable.Get(component->name, &existingComponentIndex))
+        {
+            componentMap[componentIndex] = Component { existingComponentIndex };
+        }
+        else
+        {
+            // Name has to outlive the snapshot
+            u64 nameLength = strlen(component->name) + 1;
+            char* name = (char*) context->allocator->Alloc(context->allocator->instance, nameLength);
+            memcpy(name, component->name, nameLength);
+            componentMap[componentIndex] = RegisterComponentWithFlags(context, name, component->size, component->flags);
+        }
+    }
+
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    ILinearAllocator* tempAllocator = allocatorAPI->CreateLinearAllocator(Gigabyte(1), Megabyte(1));
+    Entity* entities = (Entity*) tempAllocator->Alloc(tempAllocator->instance, sizeof(Entity) * header->entityCount);
+    u8** columnTargets = (u8**) tempAllocator->Alloc(tempAllocator->instance, sizeof(u8*) * header->columnCount);
+    u8** sharedValueDatas = (u8**) tempAllocator->Alloc(tempAllocator->instance, sizeof(u8*) * header->sharedValueCount);
+
+    // Shared values can reference any entity and have to be relocated before they are interned, so all handles are obtained first
+    SpinLockAcquire(&context->entityPoolLock);
+    for (u32 entityIndex = 0; entityIndex < header->entityCount; ++entityIndex)
+    {
+        entities[entityIndex] = Entity { ObtainNewHandleFromPool(&context->entityPool) };
+    }
+    SpinLockRelease(&context->entityPoolLock);
+
+    for (u32 valueIndex = 0; valueIndex < header->sharedValueCount; ++valueIndex)
+    {
+        const SnapshotSharedValue* sharedValue = sharedValues + valueIndex;
+        sharedValueDatas[valueIndex] = (u8*) tempAllocator->Alloc(tempAllocator->instance, sharedValue->componentSize);
+        memcpy(sharedValueDatas[valueIndex], snapshot + sharedValue->dataOffset, sharedValue->componentSize);
+    }
+    for (u32 relocationIndex = 0; relocationIndex < header->relocationCount; ++relocationIndex)
+    {
+        const SnapshotRelocation* relocation = relocations + relocationIndex;
+        if (relocation->flags & SNAPSHOT_RELOCATION_SHARED_VALUE)
+        {
+            ApplySnapshotRelocation(relocation, sharedValueDatas[relocation->target], 1, sharedValues[relocation->target].componentSize,
+                                    entities, header->entityCount, relocate, userData);
+        }
+    }
+
+    for (u32 snapshotArchIndex = 0; snapshotArchIndex < header->archetypeCount; ++snapshotArchIndex)
+    {
+        const SnapshotArchetype* snapshotArchetype = archetypes + snapshotArchIndex;
+        u32 entityCount = snapshotArchetype->entityCount;
+
+        EntitySignature signature = {};
+        for (u32 column = 0; column < snapshotArchetype->columnCount; ++column)
+        {
+            SetSignatureComponent(&signature, componentMap[columns[snapshotArchetype->firstColumn + column].componentIndex].componentIndex, true);
+        }
+        for (u32 tag = 0; tag < snapshotArchetype->tagCount; ++tag)
+        {
+            SetSignatureComponent(&signature, componentMap[tags[snapshotArchetype->firstTag + tag]].componentIndex, true);
+        }
+
+        ArchetypeSharedComponent sharedComponents[MAX_ARCHETYPE_SHARED_COMPONENT_COUNT];
+        u32 sharedComponentCount = 0;
+        for (u32 sharedIndex = 0; sharedIndex < snapshotArchetype->sharedValueCount; ++sharedIndex)
+        {
+            u32 snapshotValueIndex = snapshotArchetype->firstSharedValue + sharedIndex;
+            u32 componentIndex = componentMap[sharedValues[snapshotValueIndex].componentIndex].componentIndex;
+            u32 valueIndex = InternSharedValue(context, componentIndex, sharedValueDatas[snapshotValueIndex]);
+            SetSharedComponentValue(sharedComponents, &sharedComponentCount, componentIndex, valueIndex);
+            SetSignatureComponent(&signature, componentIndex, true);
+        }
+
+        u32 archetypeIndex = FindOrCreateArchetype(context, &signature, sharedComponents, sharedComponentCount);
+        Archetype* archetype = context->archetypes + archetypeIndex;
+        ReserveArchetypeCapacity(archetype, archetype->entityCount + entityCount);
+        u32 firstRow = archetype->entityCount;
+
+        for (u32 entityIndex = 0; entityIndex < entityCount; ++entityIndex)
+        {
+            EntityData* entityData = (EntityData*) AccessDataFromHandlePool(&context->entityPool, entities[snapshotArchetype->firstEntity + entityIndex].handle);
+            entityData->archetypeIndex = archetypeIndex;
+            entityData->row = firstRow + entityIndex;
+        }
+        archetype->entities.Append(entities + snapshotArchetype->firstEntity, entityCount);
+        archetype->entityCount += entityCount;
+        MarkArchetypeChanged(context, archetype);
+
+        // Columns are raw bytes, no per entity work
+        for (u32 column = 0; column < snapshotArchetype->columnCount; ++column)
+        {
+            u32 snapshotColumnIndex = snapshotArchetype->firstColumn + column;
+            const SnapshotColumn* snapshotColumn = columns + snapshotColumnIndex;
+            u32 targetColumn = FindArchetypeColumn(archetype, componentMap[snapshotColumn->componentIndex]);
+
+            u8* target = GetArchetypeColumn(archetype, targetColumn) + (u64) firstRow * snapshotColumn->componentSize;
+            memcpy(target, snapshot + snapshotColumn->dataOffset, (u64) snapshotColumn->componentSize * entityCount);
+            columnTargets[snapshotColumnIndex] = target;
+        }
+    }
+
+    // Archetypes don't move anymore, patch the handles in place
+    for (u32 relocationIndex = 0; relocationIndex < header->relocationCount; ++relocationIndex)
+    {
+        const SnapshotRelocation* relocation = relocations + relocationIndex;
+        if (!(relocation->flags & SNAPSHOT_RELOCATION_SHARED_VALUE))
+        {
+            const SnapshotColumn* snapshotColumn = columns + relocation->target;
+            ApplySnapshotRelocation(relocation, columnTargets[relocation->target], snapshotColumn->entityCount, snapshotColumn->componentSize,
+                                    entities, header->entityCount, relocate, userData);
+        }
+    }
+
+    allocatorAPI->DestroyLinearAllocator(tempAllocator);
+    return true;
+}
+
+bool SaveSnapshotToFile(EntityContext* context, const char* path)
+{
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    ILinearAllocator* tempAllocator = allocatorAPI->CreateLinearAllocator(Gigabyte(16ULL), Megabyte(1));
+
+    u64 size = 0;
+    void* snapshot = SaveSnapshot(context, tempAllocator, &size);
+
+    bool result = false;
+    FILE* file = fopen(path, "wb");
+    if (file)
+    {
+        result = fwrite(snapshot, 1, size, file) == size;
+        fclose(file);
+    }
+
+    allocatorAPI->DestroyLinearAllocator(tempAllocator);
+    return result;
+}
+
+bool LoadSnapshotFromFile(EntityContext* context, const char* path, SnapshotRelocateHandle relocate, void* userData)
+{
+    // Loading copies everything out of the snapshot, so it's used straight from the mapping
+    PlatformAPI* platformAPI = (PlatformAPI*) gAPIRegistry->Get(PLATFORM_API_NAME);
+    PlatformMappedFile file;
+    if (!platformAPI->fileAPI->MapFile(path, &file))
+    {
+        return false;
+    }
+
+    bool result = LoadSnapshot(context, file.data, file.size, relocate, userData);
+    platformAPI->fileAPI->UnmapFile(&file);
+    return result;
+}
+
+static bool QueryMatchesSignature(const EntityQuery* query, const EntitySignature* signature)
+{
+    return HasAllEntitySignatureComponents(signature, &query->requiredMask) && !HasAnyEntitySignatureComponent(signature, &query->excludedMask) &&
+           (!query->hasAnyOf || HasAnyEntitySignatureComponent(signature, &query->anyOfMask));
+}
+
+static void UpdateQueryCache(EntityContext* context, EntityQuery* query)
+{
+    for (u32 archIndex = query->testedArchetypeCount; archIndex < context->createdArchetypeCount; ++archIndex)
+    {
+        if (QueryMatchesSignature(query, context->archetypeSignatures + archIndex))
+        {
+            query->matchingArchetypes[query->matchingArchetypeCount++] = archIndex;
+        }
+    }
+    query->testedArchetypeCount = context->createdArchetypeCount;
+}
+
+static bool ArchetypeChangedForSystem(const EntityContext* context, const IEntitySystem* system, u32 archetypeIndex)
+{
+    if (system->changedFilterMask == 0)
+    {
+        return true;
+    }
+
+    // Any of the filtered components is enough
+    const Archetype* archetype = context->archetypes + archetypeIndex;
+    for (u32 systemCompIndex = 0; systemCompIndex < system->numComponent; ++systemCompIndex)
+    {
+        if (system->changedFilterMask & BIT(systemCompIndex))
+        {
+            u32 column = FindArchetypeColumn(archetype, system->components[systemCompIndex]);
+            if (column != NULL_INDEX && archetype->componentVersions[column] > system->lastRunVersion)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void PushSystem(EntityContext* context, IEntitySystem* entitySystem)
+{
+    ASSERT(entitySystem->numComponent <= MAX_SYSTEM_COMPONENT_TYPE_COUNT && entitySystem->numExcludedComponent <= MAX_SYSTEM_COMPONENT_TYPE_COUNT &&
+           entitySystem->numAnyOfComponent <= MAX_SYSTEM_COMPONENT_TYPE_COUNT, "Too many system components");
+
+    EntityQuery query = {};
+    for (u32 systemCompIndex = 0; systemCompIndex < entitySystem->numComponent; ++systemCompIndex)
+    {
+        if (!(entitySystem->optionalMask & BIT(systemCompIndex)))
+        {
+            SetSignatureComponent(&query.requiredMask, entitySystem->components[systemCompIndex].componentIndex, true);
+        }
+    }
+    for (u32 excludedIndex = 0; excludedIndex < entitySystem->numExcludedComponent; ++excludedIndex)
+    {
+        SetSignatureComponent(&query.excludedMask, entitySystem->excludedComponents[excludedIndex].componentIndex, true);
+    }
+    for (u32 anyOfIndex = 0; anyOfIndex < entitySystem->numAnyOfComponent; ++anyOfIndex)
+    {
+        SetSignatureComponent(&query.anyOfMask, entitySystem->anyOfComponents[anyOfIndex].componentIndex, true);
+    }
+    query.hasAnyOf = entitySystem->numAnyOfComponent > 0;
+
+    context->systems.Append(*entitySystem);
+    context->systemQueries.Append(query);
+}
+
+void RunSystems(EntityContext* context, ILinearAllocator* frameAllocator)
+{
+    u32 numSystems = context->systems.length;
+    for (u32 systemIndex = 0; systemIndex < numSystems; ++systemIndex)
+    {
+        IEntitySystem system = context->systems[systemIndex];
+        EntityQuery* query = &context->systemQueries[systemIndex];
+        UpdateQueryCache(context, query);
+
+        u32 matchedArchetypes[MAX_ARCHETYPE_COUNT];
+        u32 matchedArchetypeCount = 0;
+        for (u32 queryIndex = 0; queryIndex < query->matchingArchetypeCount; ++queryIndex)
+        {
+            u32 archIndex = query->matchingArchetypes[queryIndex];
+            if (ArchetypeChangedForSystem(context, &system, archIndex))
+            {
+                matchedArchetypes[matchedArchetypeCount++] = archIndex;
+            }
+        }
+
+        if (matchedArchetypeCount > 0)
+        {
+            EntitySystemUpdateSet updateSet = {};
+            updateSet.numArrays = matchedArchetypeCount;
+            EntitySystemUpdateArray* array = (EntitySystemUpdateArray*) frameAllocator->Alloc(frameAllocator->instance, matchedArchetypeCount * sizeof(EntitySystemUpdateArray));
+            updateSet.arrays = array;
+
+            for (u32 matchedIndex = 0; matchedIndex < matchedArchetypeCount; ++matchedIndex)
+            {
+                Archetype* archetype = context->archetypes + matchedArchetypes[matchedIndex];
+
+                EntitySystemUpdateArray* updateArray = array++;
+                updateArray->length = archetype->entityCount;
+                updateArray->entities = archetype->entities.data;
+                updateArray->changedMask = 0;
+
+                for (u32 systemCompIndex = 0; systemCompIndex < system.numComponent; ++systemCompIndex)
+                {
+                    // TODO: Archetype components is sorted. Maybe implement binary search here.
+                    u32 column = FindArchetypeColumn(archetype, system.components[systemCompIndex]);
+                    if (column != NULL_INDEX)
+                    {
+                        updateArray->componentData[systemCompIndex] = GetArchetypeColumn(archetype, column);
+                        if (archetype->componentVersions[column] > system.lastRunVersion)
+                        {
+                            updateArray->changedMask |= BIT(systemCompIndex);
+                        }
+                    }
+                    else
+                    {
+                        u32 valueIndex = FindArchetypeSharedValue(archetype, system.components[systemCompIndex]);
+                        updateArray->componentData[systemCompIndex] = valueIndex != NULL_INDEX ? GetSharedValueData(context, valueIndex) : nullptr;
+                    }
+                }
+            }
+
+            system.Update(context, &updateSet, system.userData);
+
+            // Writes are stamped with the version of this run, so this system doesn't see its own changes
+            for (u32 matchedIndex = 0; matchedIndex < matchedArchetypeCount && system.writeMask; ++matchedIndex)
+            {
+                Archetype* archetype = context->archetypes + matchedArchetypes[matchedIndex];
+                for (u32 systemCompIndex = 0; systemCompIndex < system.numComponent; ++systemCompIndex)
+                {
+                    if (system.writeMask & BIT(systemCompIndex))
+                    {
+                        u32 column = FindArchetypeColumn(archetype, system.components[systemCompIndex]);
+                        if (column != NULL_INDEX)
+                        {
+                            archetype->componentVersions[column] = context->changeVersion;
+                        }
+                    }
+                }
+            }
+        }
+
+        context->systems[systemIndex].lastRunVersion = context->changeVersion;
+        context->changeVersion++;
+
+        // Sync point, structural changes of this system are visible to the next systems
+        PlaybackCommandBuffers(context);
+    }
+}
+
+extern "C"
+{
+    MODULE_EXPORT void LoadPlugin(APIRegistry* registry, bool reload)
+    {
+        gAPIRegistry = registry;
+        EntityAPI entityAPI = {};
+        entityAPI.CreateContext = CreateEntityContext;
+        entityAPI.DestroyContext = DestroyEntityContext;
+        entityAPI.CreateEntity = CreateEntity;
+        entityAPI.CreateEntityWithComponents = CreateEntityWithComponents;
+        entityAPI.CreateEntitiesBatch = CreateEntitiesBatch;
+        entityAPI.DestroyEntity = DestroyEntity;
+        entityAPI.IsEntityAlive = IsEntityAlive;
+        entityAPI.RegisterComponent = RegisterComponent;
+        entityAPI.RegisterSharedComponent = RegisterSharedComponent;
+        entityAPI.RegisterTagComponent = RegisterTagComponent;
+        entityAPI.HasComponent = HasComponent;
+        entityAPI.SetSingletonComponent = SetSingletonComponent;
+        entityAPI.GetSingletonComponent = GetSingletonComponent;
+        entityAPI.GetComponentData = GetComponentData;
+        entityAPI.MarkComponentChanged = MarkComponentChanged;
+        entityAPI.RegisterComponentHandle = RegisterComponentHandle;
+        entityAPI.SaveSnapshot = SaveSnapshot;
+        entityAPI.LoadSnapshot = LoadSnapshot;
+        entityAPI.SaveSnapshotToFile = SaveSnapshotToFile;
+        entityAPI.LoadSnapshotFromFile = LoadSnapshotFromFile;
+        entityAPI.AddComponent = AddComponent;
+        entityAPI.RemoveComponent = RemoveComponent;
+        entityAPI.AcquireCommandBuffer = AcquireCommandBuffer;
+        entityAPI.DeferCreateEntity = DeferCreateEntity;
+        entityAPI.DeferDestroyEntity = DeferDestroyEntity;
+        entityAPI.DeferAddComponent = DeferAddComponent;
+        entityAPI.DeferRemoveComponent = DeferRemoveComponent;
+        entityAPI.PlaybackCommandBuffers = PlaybackCommandBuffers;
+        entityAPI.PushSystem = PushSystem;
+        entityAPI.RunSystems = RunSystems;
+
+
+        registry->Set(ENTITY_API_NAME, &entityAPI, sizeof(EntityAPI));
+    }
+
+    MODULE_EXPORT void UnloadPlugin(APIRegistry* registry, bool reload)
+    {
+        registry->Remove(ENTITY_API_NAME);
+    }
+}
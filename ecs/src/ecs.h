@@ -13,19 +13,31 @@ struct Component
 };
 
 struct EntityContext;
-
-#define MAX_COMPONENT_TYPE_COUNT 64
-#define MAX_SYSTEM_COMPONENT_TYPE_COUNT 8
-
+struct EntityCommandBuffer;
+
+// Can be overridden by the build, see the ecs-components premake option
+#ifndef MAX_COMPONENT_TYPE_COUNT
+#define MAX_COMPONENT_TYPE_COUNT 256
+#endif
+static_assert(MAX_COMPONENT_TYPE_COUNT >= 256 && MAX_COMPONENT_TYPE_COUNT <= 1024 && MAX_COMPONENT_TYPE_COUNT % 256 == 0,
+              "Component count must be 256, 512, 768 or 1024");
+#define ENTITY_SIGNATURE_WORD_COUNT (MAX_COMPONENT_TYPE_COUNT / 64)
+#define MAX_SYSTEM_COMPONENT_TYPE_COUNT 16
+
+// Signatures are a whole number of 256 bit registers. Loads are unaligned, contexts aren't 32 byte aligned.
 struct EntitySignature
 {
-    u64 componentMaskBits[MAX_COMPONENT_TYPE_COUNT / 64];
+    u64 componentMaskBits[ENTITY_SIGNATURE_WORD_COUNT];
 };
 
 struct EntitySystemUpdateArray
 {
+    // Column of each system component, shared components point to the single value of the array
     void* componentData[MAX_SYSTEM_COMPONENT_TYPE_COUNT];
+    Entity* entities;
     u32 length;
+    // Bit i is set if the column of components[i] changed since the last run of this system
+    u32 changedMask;
 };
 
 struct EntitySystemUpdateSet
@@ -34,31 +46,105 @@ struct EntitySystemUpdateSet
     u32 numArrays;
 };
 
+// Systems run on archetypes that have all required components, none of the excluded ones and,
+// if there are any-of components, at least one of them. Terms are compiled to signature masks on PushSystem.
 struct IEntitySystem
 {
+    // Components passed to Update, in this order. All are required unless their bit is set in optionalMask.
+    // Missing optional components and tags have null componentData.
     u32 numComponent;
     Component components[MAX_SYSTEM_COMPONENT_TYPE_COUNT];
+    u32 optionalMask;
+
+    // These only filter archetypes, they don't get componentData
+    u32 numExcludedComponent;
+    Component excludedComponents[MAX_SYSTEM_COMPONENT_TYPE_COUNT];
+    u32 numAnyOfComponent;
+    Component anyOfComponents[MAX_SYSTEM_COMPONENT_TYPE_COUNT];
+
     void* userData;
 
+    // Bit i means Update writes components[i]. Written components of every updated archetype are marked changed.
+    u32 writeMask;
+    // Bit i means archetypes are skipped unless components[i] changed since the last run of this system.
+    u32 changedFilterMask;
+    u32 lastRunVersion;
+
     void (*Update)(EntityContext* context, EntitySystemUpdateSet* updateData, void* userData);
-    bool (*Filter)(EntityContext* context, Component* components, u32 numComponents, EntitySignature signature);
 };
 
+// Handle fields of components are described with a handle type, so snapshots can relocate them.
+// Entity handles are relocated by the ECS, other types are passed to the relocation callback on load.
+#define ENTITY_HANDLE_TYPE 0
+typedef Handle (*SnapshotRelocateHandle)(void* userData, u32 handleType, Handle savedHandle);
+
 #define ENTITY_API_NAME "EntityAPI"
 
 struct EntityAPI
 {
     EntityContext* (*CreateContext)(ILinearAllocator* allocator);
+    // Releases the memory of entities, archetypes and command buffers. The context struct itself stays in the allocator given to CreateContext.
+    void (*DestroyContext)(EntityContext* context);
 
     Entity (*CreateEntity)(EntityContext* context);
     Entity (*CreateEntityWithComponents)(EntityContext* context, Component* components, void** componentDatas, u32 numComponents);
-
-    // TODO: Implement DestroyEntity
+    // Creates entityCount entities with the same components. columnDatas[i] is an array of entityCount components[i] values,
+    // nullptr zero initializes the column, nullptr columnDatas zero initializes all. outEntities is optional, it's filled in row order.
+    // Shared components are the exception: all entities go to one archetype, so columnDatas[i] points to a single value for the
+    // whole batch and only columnDatas[i][0] is read. Entities with different shared values need a batch per value.
+    void (*CreateEntitiesBatch)(EntityContext* context, Component* components, u32 numComponents, void** columnDatas, u32 entityCount, Entity* outEntities);
+    // Structural changes invalidate component pointers. Use a command buffer inside system updates.
+    // Entities that wait for command buffer playback are not created at all, their handle is released on playback.
+    void (*DestroyEntity)(EntityContext* context, Entity entity);
+    // False for destroyed entities and stale handles. Entities that wait for command buffer playback are alive.
+    bool (*IsEntityAlive)(EntityContext* context, Entity entity);
 
     Component (*RegisterComponent)(EntityContext* context, const char* componentName, u32 componentSize);
+    // Shared components store one value per archetype instead of per entity, entities with equal values are grouped together.
+    // Values are compared bytewise. Changing an entity's value with AddComponent moves it to another archetype.
+    // Systems get a pointer to the single value of each update array, GetComponentData returns the shared value.
+    Component (*RegisterSharedComponent)(EntityContext* context, const char* componentName, u32 componentSize);
+    // Tags have no data and take no memory, they only change the signature. Registering a zero size component makes a tag too.
+    // Use HasComponent or system filters to test them, GetComponentData returns nullptr.
+    Component (*RegisterTagComponent)(EntityContext* context, const char* componentName);
+    bool (*HasComponent)(EntityContext* context, Entity entity, Component component);
     Component (*GetComponentFromName)(EntityContext* context, const char* componentName);
 
-    // TODO: Implement AddComponent/RemoveComponent
+    // Returns nullptr if the entity doesn't have the component.
+    // The pointer is valid until an entity is added to the same archetype.
+    // Call MarkComponentChanged after writing to it, otherwise systems filtering changes won't see it.
+    void* (*GetComponentData)(EntityContext* context, Entity entity, Component component);
+    // Change versions are tracked per archetype column, this marks the whole column changed
+    void (*MarkComponentChanged)(EntityContext* context, Entity entity, Component component);
+
+    // Singletons are a single value per context, not attached to any entity. Get returns nullptr until it's set.
+    void (*SetSingletonComponent)(EntityContext* context, Component component, const void* componentData);
+    void* (*GetSingletonComponent)(EntityContext* context, Component component);
+
+    // Adding a component the entity already has overwrites its data
+    void (*AddComponent)(EntityContext* context, Entity entity, Component component, void* componentData);
+    void (*RemoveComponent)(EntityContext* context, Entity entity, Component component);
+
+    // Command buffers record structural changes and apply them at sync points, after each system update and on PlaybackCommandBuffers.
+    // Acquiring is thread safe, recording isn't. Acquire a buffer per thread or job, it's released on playback.
+    EntityCommandBuffer* (*AcquireCommandBuffer)(EntityContext* context);
+    // Returned entity can be used in other commands right away, its components are accessible after playback
+    Entity (*DeferCreateEntity)(EntityCommandBuffer* commandBuffer, Component* components, void** componentDatas, u32 numComponents);
+    void (*DeferDestroyEntity)(EntityCommandBuffer* commandBuffer, Entity entity);
+    void (*DeferAddComponent)(EntityCommandBuffer* commandBuffer, Entity entity, Component component, void* componentData);
+    void (*DeferRemoveComponent)(EntityCommandBuffer* commandBuffer, Entity entity, Component component);
+    void (*PlaybackCommandBuffers)(EntityContext* context);
+
+    // fieldOffset is the byte offset of a Handle (or a struct wrapping one, like Entity or GPUBuffer) in the component
+    void (*RegisterComponentHandle)(EntityContext* context, Component component, u32 fieldOffset, u32 handleType);
+    // Snapshots store component names and sizes, archetype signatures and raw column bytes. Columns are 64 byte aligned
+    // so a mapped snapshot can be used directly. Loading adds the entities to the context, only handle fields are patched per entity.
+    void* (*SaveSnapshot)(EntityContext* context, ILinearAllocator* allocator, u64* outSize);
+    // Returns false without changing the context if the snapshot is malformed, its components are registered with another layout
+    // or there are not enough free entity handles for its entities
+    bool (*LoadSnapshot)(EntityContext* context, const void* snapshot, u64 size, SnapshotRelocateHandle relocate, void* userData);
+    bool (*SaveSnapshotToFile)(EntityContext* context, const char* path);
+    bool (*LoadSnapshotFromFile)(EntityContext* context, const char* path, SnapshotRelocateHandle relocate, void* userData);
 
     void (*PushSystem)(EntityContext* context, IEntitySystem* entitySystem);
     void (*RunSystems)(EntityContext* context, ILinearAllocator* frameAllocator);
@@ -67,4 +153,75 @@ struct EntityAPI
 static inline bool HasEntitySignatureComponent(const EntitySignature* signature, Component component)
 {
     return signature->componentMaskBits[component.componentIndex / 64] & (1ULL << (component.componentIndex % 64));
+}
+
+// True if signature has every component of mask
+static inline bool HasAllEntitySignatureComponents(const EntitySignature* signature, const EntitySignature* mask)
+{
+#if defined(__AVX2__)
+    for (u32 word = 0; word < ENTITY_SIGNATURE_WORD_COUNT; word += 4)
+    {
+        __m256i signatureBits = _mm256_loadu_si256((const __m256i*) (signature->componentMaskBits + word));
+        __m256i maskBits = _mm256_loadu_si256((const __m256i*) (mask->componentMaskBits + word));
+        if (!_mm256_testc_si256(signatureBits, maskBits))
+        {
+            return false;
+        }
+    }
+    return true;
+#else
+    u64 missingBits = 0;
+    for (u32 word = 0; word < ENTITY_SIGNATURE_WORD_COUNT; ++word)
+    {
+        missingBits |= mask->componentMaskBits[word] & ~signature->componentMaskBits[word];
+    }
+    return missingBits == 0;
+#endif
+}
+
+// True if signature has at least one component of mask
+static inline bool HasAnyEntitySignatureComponent(const EntitySignature* signature, const EntitySignature* mask)
+{
+#if defined(__AVX2__)
+    for (u32 word = 0; word < ENTITY_SIGNATURE_WORD_COUNT; word += 4)
+    {
+        __m256i signatureBits = _mm256_loadu_si256((const __m256i*) (signature->componentMaskBits + word));
+        __m256i maskBits = _mm256_loadu_si256((const __m256i*) (mask->componentMaskBits + word));
+        if (!_mm256_testz_si256(signatureBits, maskBits))
+        {
+            return true;
+        }
+    }
+    return false;
+#else
+    u64 commonBits = 0;
+    for (u32 word = 0; word < ENTITY_SIGNATURE_WORD_COUNT; ++word)
+    {
+        commonBits |= mask->componentMaskBits[word] & signature->componentMaskBits[word];
+    }
+    return commonBits != 0;
+#endif
+}
+
+static inline bool EntitySignaturesEqual(const EntitySignature* left, const EntitySignature* right)
+{
+#if defined(__AVX2__)
+    for (u32 word = 0; word < ENTITY_SIGNATURE_WORD_COUNT; word += 4)
+    {
+        __m256i leftBits = _mm256_loadu_si256((const __m256i*) (left->componentMaskBits + word));
+        __m256i rightBits = _mm256_loadu_si256((const __m256i*) (right->componentMaskBits + word));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(leftBits, rightBits)) != -1)
+        {
+            return false;
+        }
+    }
+    return true;
+#else
+    u64 differentBits = 0;
+    for (u32 word = 0; word < ENTITY_SIGNATURE_WORD_COUNT; ++word)
+    {
+        differentBits |= left->componentMaskBits[word] ^ right->componentMaskBits[word];
+    }
+    return differentBits == 0;
+#endif
 }
\ No newline at end of file
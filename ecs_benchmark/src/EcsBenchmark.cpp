@@ -0,0 +1,399 @@
+#include "pch.h"
+
+#include "ApiRegistry.h"
+#include "Allocator.h"
+#include "Platform.h"
+#include "PlatformHeadless.h"
+#include "ecs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCHMARK_COMPONENT_COUNT 8
+#define BENCHMARK_SYSTEM_COUNT 128
+#define BENCHMARK_MIN_ENTITY_COUNT 1000
+#define BENCHMARK_MAX_ENTITY_COUNT 10000000
+// Iteration benchmarks repeat until this many entities are visited, the fastest run is reported
+#define BENCHMARK_ITERATION_ENTITY_BUDGET 50000000ULL
+#define BENCHMARK_MAX_ITERATION_RUNS 100
+
+struct BenchmarkComponent
+{
+    f32 value[4];
+};
+
+static const char* gComponentNames[BENCHMARK_COMPONENT_COUNT] =
+{
+    "BenchmarkComponent0",
+    "BenchmarkComponent1",
+    "BenchmarkComponent2",
+    "BenchmarkComponent3",
+    "BenchmarkComponent4",
+    "BenchmarkComponent5",
+    "BenchmarkComponent6",
+    "BenchmarkComponent7",
+};
+
+struct BenchmarkResult
+{
+    const char* name;
+    u32 entityCount;
+    u32 componentCount;
+    u32 runCount;
+    u64 totalNanoseconds;
+    // Per entity, or per system for the system overhead benchmark
+    f64 nanosecondsPerItem;
+    f64 bytesPerEntity;
+};
+
+struct BenchmarkState
+{
+    HeadlessPlatform* platform;
+    EntityAPI* entityAPI;
+    TimeAPI* timeAPI;
+    ILinearAllocator* frameAllocator;
+
+    DynamicArray<BenchmarkResult> results;
+
+    // Tracked through the virtual memory API, reservations don't count
+    VirtualMemoryAPI platformVirtualMemoryAPI;
+    u64 committedBytes;
+};
+
+static BenchmarkState gState;
+
+static void* TrackingVirtualMemoryAlloc(void* baseAddress, u64 size, u32 flags)
+{
+    if (flags & VA_COMMIT)
+    {
+        gState.committedBytes += size;
+    }
+    return gState.platformVirtualMemoryAPI.Alloc(baseAddress, size, flags);
+}
+
+static void TrackingVirtualMemoryFree(void* baseAddress, u64 size, u32 flags)
+{
+    if (flags & VF_DECOMMIT)
+    {
+        gState.committedBytes -= size;
+    }
+    gState.platformVirtualMemoryAPI.Free(baseAddress, size, flags);
+}
+
+static u64 GetTime()
+{
+    return gState.timeAPI->GetPerformanceCounterTimeNanoseconds();
+}
+
+static void AddResult(const char* name, u32 entityCount, u32 componentCount, u32 runCount, u64 totalNanoseconds, u64 itemCount)
+{
+    BenchmarkResult result = {};
+    result.name = name;
+    result.entityCount = entityCount;
+    result.componentCount = componentCount;
+    result.runCount = runCount;
+    result.totalNanoseconds = totalNanoseconds;
+    result.nanosecondsPerItem = (f64) totalNanoseconds / (f64) itemCount;
+    gState.results.Append(result);
+
+    printf("%-24s entities:%-9u components:%u %10.2f ms %8.2f ns/item\n", name, entityCount, componentCount,
+           (f64) totalNanoseconds / 1000000.0, result.nanosecondsPerItem);
+}
+
+// Every benchmark runs in a fresh context with its own allocator, so it starts with no archetypes
+struct BenchmarkContext
+{
+    ILinearAllocator* allocator;
+    EntityContext* context;
+    Component components[BENCHMARK_COMPONENT_COUNT];
+};
+
+static BenchmarkContext CreateBenchmarkContext()
+{
+    AllocatorAPI* allocatorAPI = &gState.platform->allocatorAPI;
+
+    BenchmarkContext result = {};
+    result.allocator = allocatorAPI->CreateLinearAllocator(Megabyte(16), Megabyte(1));
+    result.context = gState.entityAPI->CreateContext(result.allocator);
+    for (u32 i = 0; i < BENCHMARK_COMPONENT_COUNT; ++i)
+    {
+        result.components[i] = gState.entityAPI->RegisterComponent(result.context, gComponentNames[i], sizeof(BenchmarkComponent));
+    }
+    return result;
+}
+
+static void DestroyBenchmarkContext(BenchmarkContext* context)
+{
+    gState.entityAPI->DestroyContext(context->context);
+    gState.platform->allocatorAPI.DestroyLinearAllocator(context->allocator);
+    context->context = nullptr;
+    context->allocator = nullptr;
+}
+
+// Creation, migration and destruction of entities with 3 components
+static void BenchmarkLifetime(u32 entityCount, Entity* entities)
+{
+    EntityAPI* entityAPI = gState.entityAPI;
+    const u32 componentCount = 3;
+
+    {
+        BenchmarkContext context = CreateBenchmarkContext();
+        BenchmarkComponent data = {};
+        void* componentDatas[componentCount] = { &data, &data, &data };
+
+        u64 start = GetTime();
+        for (u32 i = 0; i < entityCount; ++i)
+        {
+            entities[i] = entityAPI->CreateEntityWithComponents(context.context, context.components, componentDatas, componentCount);
+        }
+        AddResult("create_single", entityCount, componentCount, 1, GetTime() - start, entityCount);
+
+        DestroyBenchmarkContext(&context);
+    }
+
+    BenchmarkContext context = CreateBenchmarkContext();
+
+    u64 committedBefore = gState.committedBytes;
+    u64 start = GetTime();
+    entityAPI->CreateEntitiesBatch(context.context, context.components, componentCount, nullptr, entityCount, entities);
+    AddResult("create_batch", entityCount, componentCount, 1, GetTime() - start, entityCount);
+
+    // Everything the batch commits: archetype columns, entity arrays and the entity pool, which commits as handles are taken.
+    // Committed memory grows by doubling, so this includes the unused capacity like a real scene would.
+    BenchmarkResult memoryResult = {};
+    memoryResult.name = "memory_per_entity";
+    memoryResult.entityCount = entityCount;
+    memoryResult.componentCount = componentCount;
+    memoryResult.runCount = 1;
+    memoryResult.bytesPerEntity = (f64) (gState.committedBytes - committedBefore) / (f64) entityCount;
+    gState.results.Append(memoryResult);
+    printf("%-24s entities:%-9u components:%u %10.2f bytes/entity\n", memoryResult.name, entityCount, componentCount, memoryResult.bytesPerEntity);
+
+    BenchmarkComponent data = {};
+    Component migratedComponent = context.components[componentCount];
+    start = GetTime();
+    for (u32 i = 0; i < entityCount; ++i)
+    {
+        entityAPI->AddComponent(context.context, entities[i], migratedComponent, &data);
+    }
+    AddResult("migrate_add_component", entityCount, componentCount + 1, 1, GetTime() - start, entityCount);
+
+    start = GetTime();
+    for (u32 i = 0; i < entityCount; ++i)
+    {
+        entityAPI->RemoveComponent(context.context, entities[i], migratedComponent);
+    }
+    AddResult("migrate_remove_component", entityCount, componentCount, 1, GetTime() - start, entityCount);
+
+    start = GetTime();
+    for (u32 i = 0; i < entityCount; ++i)
+    {
+        entityAPI->DestroyEntity(context.context, entities[i]);
+    }
+    AddResult("destroy", entityCount, componentCount, 1, GetTime() - start, entityCount);
+
+    DestroyBenchmarkContext(&context);
+}
+
+// Adds the other components into the first one, so every requested column is read
+static void IterateSystemUpdate(EntityContext* context, EntitySystemUpdateSet* updateSet, void* userData)
+{
+    u32 componentCount = (u32) (uintptr_t) userData;
+    for (u32 arrayIndex = 0; arrayIndex < updateSet->numArrays; ++arrayIndex)
+    {
+        EntitySystemUpdateArray* updateArray = updateSet->arrays + arrayIndex;
+        BenchmarkComponent* target = (BenchmarkComponent*) updateArray->componentData[0];
+        for (u32 componentIndex = 1; componentIndex < componentCount; ++componentIndex)
+        {
+            const BenchmarkComponent* source = (const BenchmarkComponent*) updateArray->componentData[componentIndex];
+            for (u32 i = 0; i < updateArray->length; ++i)
+            {
+                target[i].value[0] += source[i].value[0];
+                target[i].value[1] += source[i].value[1];
+                target[i].value[2] += source[i].value[2];
+                target[i].value[3] += source[i].value[3];
+            }
+        }
+        if (componentCount == 1)
+        {
+            for (u32 i = 0; i < updateArray->length; ++i)
+            {
+                target[i].value[0] += 1.0f;
+            }
+        }
+    }
+}
+
+static void EmptySystemUpdate(EntityContext* context, EntitySystemUpdateSet* updateSet, void* userData)
+{
+}
+
+static u32 GetIterationRunCount(u32 entityCount)
+{
+    u64 runCount = BENCHMARK_ITERATION_ENTITY_BUDGET / entityCount;
+    if (runCount < 1)
+    {
+        runCount = 1;
+    }
+    if (runCount > BENCHMARK_MAX_ITERATION_RUNS)
+    {
+        runCount = BENCHMARK_MAX_ITERATION_RUNS;
+    }
+    return (u32) runCount;
+}
+
+// Returns the fastest RunSystems call
+static u64 MeasureRunSystems(EntityContext* context, u32 runCount)
+{
+    u64 fastest = 0;
+    for (u32 run = 0; run < runCount; ++run)
+    {
+        gState.frameAllocator->instance->startOffset = 0;
+        u64 start = GetTime();
+        gState.entityAPI->RunSystems(context, gState.frameAllocator);
+        u64 elapsed = GetTime() - start;
+        if (run == 0 || elapsed < fastest)
+        {
+            fastest = elapsed;
+        }
+    }
+    return fastest;
+}
+
+static void BenchmarkIteration(u32 entityCount)
+{
+    EntityAPI* entityAPI = gState.entityAPI;
+    u32 runCount = GetIterationRunCount(entityCount);
+
+    static const char* names[BENCHMARK_COMPONENT_COUNT] =
+    {
+        "iterate_1", "iterate_2", "iterate_3", "iterate_4", "iterate_5", "iterate_6", "iterate_7", "iterate_8",
+    };
+
+    // Every measurement has a single system in its own context
+    IEntitySystem systems[BENCHMARK_COMPONENT_COUNT] = {};
+    for (u32 componentCount = 1; componentCount <= BENCHMARK_COMPONENT_COUNT; ++componentCount)
+    {
+        BenchmarkContext context = CreateBenchmarkContext();
+        entityAPI->CreateEntitiesBatch(context.context, context.components, BENCHMARK_COMPONENT_COUNT, nullptr, entityCount, nullptr);
+
+        IEntitySystem* system = systems + componentCount - 1;
+        system->numComponent = componentCount;
+        memcpy(system->components, context.components, componentCount * sizeof(Component));
+        system->userData = (void*) (uintptr_t) componentCount;
+        system->writeMask = BIT(0);
+        system->Update = IterateSystemUpdate;
+        entityAPI->PushSystem(context.context, system);
+
+        u64 fastest = MeasureRunSystems(context.context, runCount);
+        AddResult(names[componentCount - 1], entityCount, componentCount, runCount, fastest, entityCount);
+
+        DestroyBenchmarkContext(&context);
+    }
+}
+
+// Entities are spread over 8 archetypes and every system matches all of them, so this is mostly query and dispatch cost
+static void BenchmarkSystemOverhead(u32 entityCount)
+{
+    EntityAPI* entityAPI = gState.entityAPI;
+    u32 runCount = GetIterationRunCount(entityCount);
+
+    BenchmarkContext context = CreateBenchmarkContext();
+    u32 archetypeEntityCount = entityCount / BENCHMARK_COMPONENT_COUNT;
+    for (u32 archetypeIndex = 0; archetypeIndex < BENCHMARK_COMPONENT_COUNT; ++archetypeIndex)
+    {
+        Component components[2] = { context.components[0], context.components[archetypeIndex] };
+        u32 componentCount = archetypeIndex == 0 ? 1 : 2;
+        entityAPI->CreateEntitiesBatch(context.context, components, componentCount, nullptr, archetypeEntityCount, nullptr);
+    }
+
+    IEntitySystem* systems = (IEntitySystem*) calloc(BENCHMARK_SYSTEM_COUNT, sizeof(IEntitySystem));
+    for (u32 systemIndex = 0; systemIndex < BENCHMARK_SYSTEM_COUNT; ++systemIndex)
+    {
+        IEntitySystem* system = systems + systemIndex;
+        system->numComponent = 1;
+        system->components[0] = context.components[0];
+        system->Update = EmptySystemUpdate;
+        entityAPI->PushSystem(context.context, system);
+    }
+
+    u64 fastest = MeasureRunSystems(context.context, runCount);
+    AddResult("run_systems_overhead", entityCount, 1, runCount, fastest, BENCHMARK_SYSTEM_COUNT);
+
+    free(systems);
+    DestroyBenchmarkContext(&context);
+}
+
+static bool WriteResults(const char* path, u32 maxEntityCount)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    char timeBuffer[64] = {};
+    gState.timeAPI->FormatTime(timeBuffer, sizeof(timeBuffer), gState.timeAPI->GetLocalTime(), "HH':'mm':'ss");
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"benchmark\": \"ecs\",\n");
+    fprintf(file, "  \"time\": \"%s\",\n", timeBuffer);
+    fprintf(file, "  \"maxEntityCount\": %u,\n", maxEntityCount);
+    fprintf(file, "  \"results\": [\n");
+    for (u32 i = 0; i < gState.results.length; ++i)
+    {
+        BenchmarkResult* result = &gState.results[i];
+        fprintf(file, "    { \"name\": \"%s\", \"entities\": %u, \"components\": %u, \"runs\": %u, "
+                      "\"totalNanoseconds\": %llu, \"nanosecondsPerItem\": %.3f, \"bytesPerEntity\": %.3f }%s\n",
+                result->name, result->entityCount, result->componentCount, result->runCount,
+                (unsigned long long) result->totalNanoseconds, result->nanosecondsPerItem, result->bytesPerEntity,
+                i + 1 < gState.results.length ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+
+    fclose(file);
+    return true;
+}
+
+// Usage: ecs_benchmark [output.json] [max entity count]
+int main(int argc, char* argv[])
+{
+    const char* outputPath = argc > 1 ? argv[1] : "ecs_benchmark.json";
+    u32 maxEntityCount = argc > 2 ? (u32) strtoul(argv[2], nullptr, 10) : BENCHMARK_MAX_ENTITY_COUNT;
+
+    HeadlessPlatform platform;
+    InitHeadlessPlatform(&platform, argv[0]);
+
+    // Allocator API keeps a pointer to the platform's virtual memory API, wrapping it in place tracks every commit
+    gState.platformVirtualMemoryAPI = platform.virtualMemoryAPI;
+    platform.virtualMemoryAPI.Alloc = TrackingVirtualMemoryAlloc;
+    platform.virtualMemoryAPI.Free = TrackingVirtualMemoryFree;
+
+    LoadPlugin(&platform.registry, "ECS");
+
+    gState.platform = &platform;
+    gState.entityAPI = (EntityAPI*) platform.registry.Get(ENTITY_API_NAME);
+    gState.timeAPI = &platform.timeAPI;
+    gState.frameAllocator = platform.allocatorAPI.CreateLinearAllocator(Megabyte(64), Megabyte(1));
+    gState.results = CreateDynamicArray<BenchmarkResult>(&platform.allocatorAPI);
+
+    Entity* entities = (Entity*) malloc((u64) maxEntityCount * sizeof(Entity));
+    for (u32 entityCount = BENCHMARK_MIN_ENTITY_COUNT; entityCount <= maxEntityCount; entityCount *= 10)
+    {
+        BenchmarkLifetime(entityCount, entities);
+        BenchmarkIteration(entityCount);
+        BenchmarkSystemOverhead(entityCount);
+
+        if (entityCount > U32Max / 10)
+        {
+            break;
+        }
+    }
+    free(entities);
+
+    bool written = WriteResults(outputPath, maxEntityCount);
+    printf(written ? "Results written to %s\n" : "Couldn't write results to %s\n", outputPath);
+
+    return written ? 0 : 1;
+}
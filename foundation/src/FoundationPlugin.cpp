@@ -2,9 +2,11 @@
 #include "Log.h"
 #include "ApiRegistry.h"
 #include "Profiler.h"
+#include "Jobs.h"
 
 extern void RegisterProfilerAPI(APIRegistry* registry, bool reload);
 extern void RegisterLogAPI(APIRegistry* registry, bool reload);
+extern void RegisterJobAPI(APIRegistry* registry, bool reload);
 
 extern "C"
 {
@@ -12,6 +14,7 @@ extern "C"
     {
         RegisterLogAPI(registry, reload);
         RegisterProfilerAPI(registry, reload);
+        RegisterJobAPI(registry, reload);
     }
 
     MODULE_EXPORT void UnloadPlugin(APIRegistry* registry, bool reload)
@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "Jobs.h"
+#include "Allocator.h"
+#include "ApiRegistry.h"
+#include "Platform.h"
+
+static APIRegistry* gAPIRegistry = nullptr;
+static PlatformAPI* gPlatformAPI = nullptr;
+
+#define MAX_QUEUED_JOB_COUNT 4096
+#define MAX_WORKER_COUNT 64
+
+struct QueuedJob
+{
+    JobDecl job;
+    JobCounter* counter;
+};
+
+struct JobAPIState
+{
+    ILinearAllocator* allocator;
+
+    // Ring buffer, head and tail grow forever and wrap with the mask
+    QueuedJob queue[MAX_QUEUED_JOB_COUNT];
+    u32 head;
+    u32 tail;
+    SpinLock queueLock;
+
+    PlatformSemaphore* wakeSemaphore;
+    PlatformThread* workers[MAX_WORKER_COUNT];
+    u32 workerCount;
+    volatile u32 quitRequested;
+};
+
+static JobAPIState* gState = nullptr;
+
+// Runs the oldest queued job, or only a job of the counter if it's not null
+static bool TryRunJob(JobCounter* counter)
+{
+    QueuedJob queuedJob;
+    bool hasJob = false;
+
+    SpinLockAcquire(&gState->queueLock);
+    for (u32 position = gState->head; position != gState->tail; ++position)
+    {
+        QueuedJob* candidate = gState->queue + (position % MAX_QUEUED_JOB_COUNT);
+        if (counter && candidate->counter != counter)
+        {
+            continue;
+        }
+
+        // The oldest job takes the place of the one that's run, so the queue stays contiguous
+        queuedJob = *candidate;
+        *candidate = gState->queue[gState->head % MAX_QUEUED_JOB_COUNT];
+        gState->head++;
+        hasJob = true;
+        break;
+    }
+    SpinLockRelease(&gState->queueLock);
+
+    if (hasJob)
+    {
+        queuedJob.job.function(queuedJob.job.userData);
+        AtomicDecrement(&queuedJob.counter->value);
+    }
+
+    return hasJob;
+}
+
+static void WorkerThreadFunction(void* userData)
+{
+    ThreadAPI* threadAPI = gPlatformAPI->threadAPI;
+    while (!AtomicLoad(&gState->quitRequested))
+    {
+        if (!TryRunJob(nullptr))
+        {
+            threadAPI->WaitSemaphore(gState->wakeSemaphore);
+        }
+    }
+}
+
+void JobSystemInit(AllocatorAPI* allocatorAPI, ILinearAllocator* applicationAllocator, u32 workerCount)
+{
+    gState = (JobAPIState*) applicationAllocator->Alloc(applicationAllocator->instance, sizeof(JobAPIState));
+    memset(gState, 0, sizeof(JobAPIState));
+    // Update state pointer in api
+    JobAPI* api = (JobAPI*) gAPIRegistry->Get(JOB_API_NAME);
+    api->state = (void*) gState;
+
+    ThreadAPI* threadAPI = gPlatformAPI->threadAPI;
+    if (workerCount == 0)
+    {
+        u32 processorCount = threadAPI->GetProcessorCount();
+        workerCount = processorCount > 1 ? processorCount - 1 : 1;
+    }
+    workerCount = workerCount < MAX_WORKER_COUNT ? workerCount : MAX_WORKER_COUNT;
+
+    gState->allocator = applicationAllocator;
+    gState->wakeSemaphore = threadAPI->CreatePlatformSemaphore(applicationAllocator, 0, I32Max);
+    gState->workerCount = workerCount;
+    for (u32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+    {
+        TempAllocator tempAllocator;
+        const char* name = tempAllocator.Printf("Job Worker %u", workerIndex);
+        gState->workers[workerIndex] = threadAPI->CreatePlatformThread(applicationAllocator, WorkerThreadFunction, nullptr, name);
+    }
+}
+
+void JobSystemRunJobs(const JobDecl* jobs, u32 jobCount, JobCounter* counter)
+{
+    ASSERT(gState, "Job API has not been initialized!");
+    if (jobCount == 0)
+    {
+        return;
+    }
+
+    AtomicAdd(&counter->value, jobCount);
+
+    SpinLockAcquire(&gState->queueLock);
+    ASSERT(gState->tail - gState->head + jobCount <= MAX_QUEUED_JOB_COUNT, "Job queue is full");
+    for (u32 jobIndex = 0; jobIndex < jobCount; ++jobIndex)
+    {
+        QueuedJob* queuedJob = gState->queue + (gState->tail % MAX_QUEUED_JOB_COUNT);
+        queuedJob->job = jobs[jobIndex];
+        queuedJob->counter = counter;
+        gState->tail++;
+    }
+    SpinLockRelease(&gState->queueLock);
+
+    u32 wakeCount = jobCount < gState->workerCount ? jobCount : gState->workerCount;
+    gPlatformAPI->threadAPI->SignalSemaphore(gState->wakeSemaphore, wakeCount);
+}
+
+void JobSystemWaitForCounter(JobCounter* counter)
+{
+    ASSERT(gState, "Job API has not been initialized!");
+    while (AtomicLoad(&counter->value) != 0)
+    {
+        // Help with the jobs of the counter instead of blocking. Other jobs, like asset cooks, could take much longer than the wait.
+        if (!TryRunJob(counter))
+        {
+            gPlatformAPI->threadAPI->YieldThread();
+        }
+    }
+}
+
+u32 JobSystemGetWorkerCount()
+{
+    ASSERT(gState, "Job API has not been initialized!");
+    return gState->workerCount;
+}
+
+void JobSystemShutdown(AllocatorAPI* allocatorAPI)
+{
+    ASSERT(gState, "Job API has not been initialized!");
+    ThreadAPI* threadAPI = gPlatformAPI->threadAPI;
+
+    AtomicStore(&gState->quitRequested, 1);
+    threadAPI->SignalSemaphore(gState->wakeSemaphore, gState->workerCount);
+    for (u32 workerIndex = 0; workerIndex < gState->workerCount; ++workerIndex)
+    {
+        threadAPI->JoinPlatformThread(gState->workers[workerIndex]);
+    }
+    threadAPI->DestroyPlatformSemaphore(gState->wakeSemaphore);
+}
+
+void RegisterJobAPI(APIRegistry* registry, bool reload)
+{
+    gAPIRegistry = registry;
+    gPlatformAPI = (PlatformAPI*) registry->Get(PLATFORM_API_NAME);
+
+    JobAPI jobAPI = {};
+    if (reload)
+    {
+        JobAPI* api = (JobAPI*) registry->Get(JOB_API_NAME);
+        ASSERT(api, "Can't find API on reload");
+        gState = (JobAPIState*) api->state;
+    }
+
+    jobAPI.state = (void*) gState;
+    jobAPI.Init = JobSystemInit;
+    jobAPI.RunJobs = JobSystemRunJobs;
+    jobAPI.WaitForCounter = JobSystemWaitForCounter;
+    jobAPI.GetWorkerCount = JobSystemGetWorkerCount;
+    jobAPI.Shutdown = JobSystemShutdown;
+
+    registry->Set(JOB_API_NAME, &jobAPI, sizeof(JobAPI));
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+struct AllocatorAPI;
+struct ILinearAllocator;
+struct APIRegistry;
+
+#define JOB_API_NAME "JobAPI"
+
+typedef void (*JobFunction)(void* userData);
+
+struct JobDecl
+{
+    JobFunction function;
+    void* userData;
+};
+
+// Number of unfinished jobs of RunJobs calls. Must be zero initialized.
+struct JobCounter
+{
+    volatile u32 value;
+};
+
+struct JobAPI
+{
+    void* state;
+
+    // Zero worker count creates a worker per processor, leaving one for the calling thread
+    void (*Init)(AllocatorAPI* allocatorAPI, ILinearAllocator* applicationAllocator, u32 workerCount);
+    void (*RunJobs)(const JobDecl* jobs, u32 jobCount, JobCounter* counter);
+    // Calling thread runs queued jobs of the counter until it reaches zero
+    void (*WaitForCounter)(JobCounter* counter);
+    u32 (*GetWorkerCount)();
+    void (*Shutdown)(AllocatorAPI* allocatorAPI);
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+// Sequentially consistent atomic operations. Add/Increment/Decrement return the new value.
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+
+inline u32 AtomicLoad(volatile u32* value) { return (u32) _InterlockedOr((volatile long*) value, 0); }
+inline void AtomicStore(volatile u32* value, u32 newValue) { _InterlockedExchange((volatile long*) value, (long) newValue); }
+inline u32 AtomicAdd(volatile u32* value, u32 addend) { return (u32) _InterlockedExchangeAdd((volatile long*) value, (long) addend) + addend; }
+inline u32 AtomicIncrement(volatile u32* value) { return (u32) _InterlockedIncrement((volatile long*) value); }
+inline u32 AtomicDecrement(volatile u32* value) { return (u32) _InterlockedDecrement((volatile long*) value); }
+inline u32 AtomicExchange(volatile u32* value, u32 newValue) { return (u32) _InterlockedExchange((volatile long*) value, (long) newValue); }
+inline bool AtomicCompareExchange(volatile u32* value, u32 expected, u32 desired)
+{
+    return (u32) _InterlockedCompareExchange((volatile long*) value, (long) desired, (long) expected) == expected;
+}
+
+inline u64 AtomicLoad64(volatile u64* value) { return (u64) _InterlockedOr64((volatile long long*) value, 0); }
+inline u64 AtomicAdd64(volatile u64* value, u64 addend) { return (u64) _InterlockedExchangeAdd64((volatile long long*) value, (long long) addend) + addend; }
+
+#else
+
+inline u32 AtomicLoad(volatile u32* value) { return __atomic_load_n(value, __ATOMIC_SEQ_CST); }
+inline void AtomicStore(volatile u32* value, u32 newValue) { __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST); }
+inline u32 AtomicAdd(volatile u32* value, u32 addend) { return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST); }
+inline u32 AtomicIncrement(volatile u32* value) { return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST); }
+inline u32 AtomicDecrement(volatile u32* value) { return __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST); }
+inline u32 AtomicExchange(volatile u32* value, u32 newValue) { return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST); }
+inline bool AtomicCompareExchange(volatile u32* value, u32 expected, u32 desired)
+{
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+inline u64 AtomicLoad64(volatile u64* value) { return __atomic_load_n(value, __ATOMIC_SEQ_CST); }
+inline u64 AtomicAdd64(volatile u64* value, u64 addend) { return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST); }
+
+#endif
+
+// Spin lock for short critical sections
+struct SpinLock
+{
+    volatile u32 locked;
+};
+
+inline void SpinLockAcquire(SpinLock* lock)
+{
+    while (!AtomicCompareExchange(&lock->locked, 0, 1))
+    {
+        while (AtomicLoad(&lock->locked))
+        {
+#if defined(__x86_64__) || defined(_M_X64)
+            _mm_pause();
+#endif
+        }
+    }
+}
+
+inline void SpinLockRelease(SpinLock* lock)
+{
+    AtomicStore(&lock->locked, 0);
+}
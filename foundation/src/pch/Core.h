@@ -42,6 +42,14 @@ typedef double f64;
 
 #define BIT(x)    (1u << (x))
 
+// Index of the lowest set bit, value must not be zero
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+inline u32 CountTrailingZeros64(u64 value) { unsigned long index; _BitScanForward64(&index, value); return (u32) index; }
+#else
+inline u32 CountTrailingZeros64(u64 value) { return (u32) __builtin_ctzll(value); }
+#endif
+
 #define DEBUG_GPU_DEVICE 1
 
 #if defined(PLATFORM_WINDOWS)
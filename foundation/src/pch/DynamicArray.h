@@ -12,6 +12,7 @@ struct DynamicArray
     inline Type PopBack();
     inline Type PopFirst();
     inline void Append(Type item);
+    inline void Append(const Type* items, u32 count);
     inline void Insert(Type item, u32 index);
     inline void RemoveAt(u32 index);
     inline void Clear();
@@ -74,6 +75,13 @@ inline void DynamicArray<Type>::Append(Type item)
     this->length++;
 }
 
+template<typename Type>
+inline void DynamicArray<Type>::Append(const Type* items, u32 count)
+{
+    memcpy(this->allocator->Alloc(this->allocator->instance, sizeof(Type) * count), items, sizeof(Type) * count);
+    this->length += count;
+}
+
 template<typename Type>
 inline void DynamicArray<Type>::Insert(Type item, u32 index)
 {
@@ -59,7 +59,7 @@ inline static HashTable<K, V> CreateHashTable(AllocatorAPI* allocatorAPI, u32 in
 }
 
 template<typename K, typename V>
-inline static void CreateHashTable(HashTable<K, V>* table, AllocatorAPI* allocatorAPI)
+inline static void DestroyHashTable(HashTable<K, V>* table, AllocatorAPI* allocatorAPI)
 {
     allocatorAPI->DestroyLinearAllocator(table->allocator);
     table->allocator = 0;
@@ -0,0 +1,261 @@
+#ifndef _MATH_BOUNDS_H_
+#define _MATH_BOUNDS_H_
+
+////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+// Axis aligned box in center-extents form. Transforming and plane testing both work on center and extents,
+// so we only convert from min/max once at load time.
+struct AABB {
+    Vector3 center;
+    Vector3 extents;
+};
+
+struct BoundingSphere {
+    Vector3 center;
+    f32 radius;
+};
+
+// Planes are (normal, distance) with normals pointing inside the frustum.
+// A point p is inside a plane when dot(normal, p) + distance >= 0.
+enum FrustumPlane : u8 {
+    FRUSTUM_PLANE_LEFT,
+    FRUSTUM_PLANE_RIGHT,
+    FRUSTUM_PLANE_BOTTOM,
+    FRUSTUM_PLANE_TOP,
+    FRUSTUM_PLANE_NEAR,
+    FRUSTUM_PLANE_FAR,
+
+    FRUSTUM_PLANE_COUNT
+};
+
+struct Frustum {
+    Vector4 planes[FRUSTUM_PLANE_COUNT];
+};
+
+inline AABB AABBFromMinMax(const Vector3& minPoint, const Vector3& maxPoint) {
+    AABB result;
+    result.center = (minPoint + maxPoint) * 0.5f;
+    result.extents = (maxPoint - minPoint) * 0.5f;
+    return result;
+}
+
+inline Vector3 AABBMin(const AABB& box) {
+    return box.center - box.extents;
+}
+
+inline Vector3 AABBMax(const AABB& box) {
+    return box.center + box.extents;
+}
+
+inline AABB AABBUnion(const AABB& left, const AABB& right) {
+    Vector3 leftMin = AABBMin(left);
+    Vector3 leftMax = AABBMax(left);
+    Vector3 rightMin = AABBMin(right);
+    Vector3 rightMax = AABBMax(right);
+    Vector3 minPoint = Vector3(fminf(leftMin.x, rightMin.x), fminf(leftMin.y, rightMin.y), fminf(leftMin.z, rightMin.z));
+    Vector3 maxPoint = Vector3(fmaxf(leftMax.x, rightMax.x), fmaxf(leftMax.y, rightMax.y), fmaxf(leftMax.z, rightMax.z));
+    return AABBFromMinMax(minPoint, maxPoint);
+}
+
+// Arvo's method: the new extents are the absolute matrix times the old extents
+inline AABB TransformAABB(const AABB& box, const Matrix3x4& matrix) {
+    f32x4 c0 = F32x4FromVector4(matrix.data[0]);
+    f32x4 c1 = F32x4FromVector4(matrix.data[1]);
+    f32x4 c2 = F32x4FromVector4(matrix.data[2]);
+    f32x4 translation = F32x4Set(0.0f, 0.0f, 0.0f, 1.0f);
+    F32x4Transpose(&c0, &c1, &c2, &translation);
+
+    f32x4 center = F32x4MulAdd(c0, F32x4Splat(box.center.x), translation);
+    center = F32x4MulAdd(c1, F32x4Splat(box.center.y), center);
+    center = F32x4MulAdd(c2, F32x4Splat(box.center.z), center);
+
+    f32x4 zero = F32x4Zero();
+    f32x4 extents = F32x4Mul(F32x4Max(c0, F32x4Sub(zero, c0)), F32x4Splat(box.extents.x));
+    extents = F32x4MulAdd(F32x4Max(c1, F32x4Sub(zero, c1)), F32x4Splat(box.extents.y), extents);
+    extents = F32x4MulAdd(F32x4Max(c2, F32x4Sub(zero, c2)), F32x4Splat(box.extents.z), extents);
+
+    f32 c[4], e[4];
+    F32x4Store(c, center);
+    F32x4Store(e, extents);
+
+    AABB result;
+    result.center = Vector3(c[0], c[1], c[2]);
+    result.extents = Vector3(e[0], e[1], e[2]);
+    return result;
+}
+
+// Input and output arrays can be strided, so box fields of components can be passed directly
+inline void TransformAABBs(const AABB* boxes, u32 boxStride, const Matrix3x4* matrices, u32 matrixStride,
+                           AABB* outBoxes, u32 outBoxStride, u32 count) {
+    const u8* boxData = (const u8*) boxes;
+    const u8* matrixData = (const u8*) matrices;
+    u8* outBoxData = (u8*) outBoxes;
+    for (u32 index = 0; index < count; ++index) {
+        const AABB* box = (const AABB*) (boxData + index * boxStride);
+        const Matrix3x4* matrix = (const Matrix3x4*) (matrixData + index * matrixStride);
+        *((AABB*) (outBoxData + index * outBoxStride)) = TransformAABB(*box, *matrix);
+    }
+}
+
+inline BoundingSphere BoundingSphereFromAABB(const AABB& box) {
+    BoundingSphere result;
+    result.center = box.center;
+    result.radius = Lenght(box.extents);
+    return result;
+}
+
+// Non-uniform scale grows the radius by the largest axis scale
+inline BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const Matrix3x4& matrix) {
+    f32x4 c0 = F32x4FromVector4(matrix.data[0]);
+    f32x4 c1 = F32x4FromVector4(matrix.data[1]);
+    f32x4 c2 = F32x4FromVector4(matrix.data[2]);
+    f32x4 translation = F32x4Set(0.0f, 0.0f, 0.0f, 1.0f);
+    F32x4Transpose(&c0, &c1, &c2, &translation);
+
+    f32x4 center = F32x4MulAdd(c0, F32x4Splat(sphere.center.x), translation);
+    center = F32x4MulAdd(c1, F32x4Splat(sphere.center.y), center);
+    center = F32x4MulAdd(c2, F32x4Splat(sphere.center.z), center);
+
+    f32x4 maxScaleSq = F32x4Max(F32x4Dot(c0, c0), F32x4Max(F32x4Dot(c1, c1), F32x4Dot(c2, c2)));
+
+    f32 c[4];
+    F32x4Store(c, center);
+
+    BoundingSphere result;
+    result.center = Vector3(c[0], c[1], c[2]);
+    result.radius = sphere.radius * sqrtf(F32x4GetX(maxScaleSq));
+    return result;
+}
+
+// Gribb-Hartmann plane extraction for column vectors and D3D [0, 1] clip depth.
+// Pass projection * view for world space planes.
+inline Frustum ExtractFrustumPlanes(const Matrix4& projView) {
+    f32x4 row0 = F32x4FromVector4(projView.data[0]);
+    f32x4 row1 = F32x4FromVector4(projView.data[1]);
+    f32x4 row2 = F32x4FromVector4(projView.data[2]);
+    f32x4 row3 = F32x4FromVector4(projView.data[3]);
+
+    f32x4 planes[FRUSTUM_PLANE_COUNT];
+    planes[FRUSTUM_PLANE_LEFT] = F32x4Add(row3, row0);
+    planes[FRUSTUM_PLANE_RIGHT] = F32x4Sub(row3, row0);
+    planes[FRUSTUM_PLANE_BOTTOM] = F32x4Add(row3, row1);
+    planes[FRUSTUM_PLANE_TOP] = F32x4Sub(row3, row1);
+    planes[FRUSTUM_PLANE_NEAR] = row2;
+    planes[FRUSTUM_PLANE_FAR] = F32x4Sub(row3, row2);
+
+    Frustum result;
+    f32x4 normalMask = F32x4Set(1.0f, 1.0f, 1.0f, 0.0f);
+    for (u32 planeIndex = 0; planeIndex < FRUSTUM_PLANE_COUNT; ++planeIndex) {
+        f32x4 plane = planes[planeIndex];
+        f32x4 normal = F32x4Mul(plane, normalMask);
+        f32x4 length = F32x4Sqrt(F32x4Dot(normal, normal));
+        result.planes[planeIndex] = Vector4FromF32x4(F32x4Div(plane, length));
+    }
+
+    return result;
+}
+
+inline bool IsAABBInFrustum(const Frustum& frustum, const AABB& box) {
+    for (u32 planeIndex = 0; planeIndex < FRUSTUM_PLANE_COUNT; ++planeIndex) {
+        const Vector4& plane = frustum.planes[planeIndex];
+        f32 distance = plane.x * box.center.x + plane.y * box.center.y + plane.z * box.center.z + plane.w;
+        f32 radius = fabsf(plane.x) * box.extents.x + fabsf(plane.y) * box.extents.y + fabsf(plane.z) * box.extents.z;
+        if (distance + radius < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline bool IsSphereInFrustum(const Frustum& frustum, const BoundingSphere& sphere) {
+    for (u32 planeIndex = 0; planeIndex < FRUSTUM_PLANE_COUNT; ++planeIndex) {
+        const Vector4& plane = frustum.planes[planeIndex];
+        f32 distance = plane.x * sphere.center.x + plane.y * sphere.center.y + plane.z * sphere.center.z + plane.w;
+        if (distance + sphere.radius < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Normal cone test of a triangle cluster (Shirman and Abi-Ezzi 1993, in the form meshoptimizer uses). The cone holds the normals of the
+// triangles within the sphere, coneCutoff is the sine of its half angle. True when every triangle faces away from viewPosition.
+inline bool IsConeBackFacing(const BoundingSphere& sphere, const Vector3& coneAxis, f32 coneCutoff, const Vector3& viewPosition) {
+    Vector3 toCenter = sphere.center - viewPosition;
+    return DotProduct(toCenter, coneAxis) >= coneCutoff * Lenght(toCenter) + sphere.radius;
+}
+
+// Tests 8 boxes per iteration against the frustum with the boxes transposed into SoA registers.
+// Writes the indices of the visible boxes into outVisibleIndices, which must have room for count indices.
+// Returns the number of visible boxes.
+inline u32 CullAABBs(const Frustum& frustum, const AABB* boxes, u32 boxStride, u32 count, u32* outVisibleIndices) {
+    const u8* boxData = (const u8*) boxes;
+
+    // Splat the planes once, they are the same for every box
+    f32x8 planeX[FRUSTUM_PLANE_COUNT], planeY[FRUSTUM_PLANE_COUNT], planeZ[FRUSTUM_PLANE_COUNT], planeW[FRUSTUM_PLANE_COUNT];
+    f32x8 absPlaneX[FRUSTUM_PLANE_COUNT], absPlaneY[FRUSTUM_PLANE_COUNT], absPlaneZ[FRUSTUM_PLANE_COUNT];
+    for (u32 planeIndex = 0; planeIndex < FRUSTUM_PLANE_COUNT; ++planeIndex) {
+        const Vector4& plane = frustum.planes[planeIndex];
+        planeX[planeIndex] = F32x8Splat(plane.x);
+        planeY[planeIndex] = F32x8Splat(plane.y);
+        planeZ[planeIndex] = F32x8Splat(plane.z);
+        planeW[planeIndex] = F32x8Splat(plane.w);
+        absPlaneX[planeIndex] = F32x8Splat(fabsf(plane.x));
+        absPlaneY[planeIndex] = F32x8Splat(fabsf(plane.y));
+        absPlaneZ[planeIndex] = F32x8Splat(fabsf(plane.z));
+    }
+
+    u32 visibleCount = 0;
+    u32 index = 0;
+    for (; index + 8 <= count; index += 8) {
+        f32 lanes[6][8];
+        for (u32 lane = 0; lane < 8; ++lane) {
+            const f32* box = (const f32*) (boxData + (index + lane) * boxStride);
+            lanes[0][lane] = box[0];
+            lanes[1][lane] = box[1];
+            lanes[2][lane] = box[2];
+            lanes[3][lane] = box[3];
+            lanes[4][lane] = box[4];
+            lanes[5][lane] = box[5];
+        }
+
+        f32x8 centerX = F32x8Load(lanes[0]);
+        f32x8 centerY = F32x8Load(lanes[1]);
+        f32x8 centerZ = F32x8Load(lanes[2]);
+        f32x8 extentX = F32x8Load(lanes[3]);
+        f32x8 extentY = F32x8Load(lanes[4]);
+        f32x8 extentZ = F32x8Load(lanes[5]);
+
+        // A box is outside when it is fully behind any plane, so we only need the smallest signed distance
+        f32x8 minDistance = F32x8Splat(F32Max);
+        for (u32 planeIndex = 0; planeIndex < FRUSTUM_PLANE_COUNT; ++planeIndex) {
+            f32x8 distance = F32x8MulAdd(planeX[planeIndex], centerX,
+                             F32x8MulAdd(planeY[planeIndex], centerY,
+                             F32x8MulAdd(planeZ[planeIndex], centerZ, planeW[planeIndex])));
+            f32x8 radius = F32x8MulAdd(absPlaneX[planeIndex], extentX,
+                           F32x8MulAdd(absPlaneY[planeIndex], extentY, F32x8Mul(absPlaneZ[planeIndex], extentZ)));
+            minDistance = F32x8Min(minDistance, F32x8Add(distance, radius));
+        }
+
+        f32 distances[8];
+        F32x8Store(distances, minDistance);
+        for (u32 lane = 0; lane < 8; ++lane) {
+            // Branchless compaction, the slot is overwritten when the box is culled
+            outVisibleIndices[visibleCount] = index + lane;
+            visibleCount += distances[lane] >= 0.0f ? 1 : 0;
+        }
+    }
+
+    for (; index < count; ++index) {
+        const AABB* box = (const AABB*) (boxData + index * boxStride);
+        if (IsAABBInFrustum(frustum, *box)) {
+            outVisibleIndices[visibleCount++] = index;
+        }
+    }
+
+    return visibleCount;
+}
+
+#endif
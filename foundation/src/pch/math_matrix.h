@@ -47,51 +47,106 @@ inline Vector4& Matrix4::operator[](int index) {
     return data[index];
 }
 
-inline Vector4 operator*(Matrix4& left, Vector4& right) {
-    Vector4 result;
-    result.x = DotProduct(left[0], right);
-    result.y = DotProduct(left[1], right);
-    result.z = DotProduct(left[2], right);
-    result.w = DotProduct(left[3], right);
+// Affine transform matrix. Same layout as the first three rows of Matrix4, the last row is implicitly (0, 0, 0, 1).
+struct Matrix3x4 {
+    Vector4 data[3];
 
-    return result;
+    Matrix3x4();
+    Matrix3x4(Vector4 v1, Vector4 v2, Vector4 v3);
+    explicit Matrix3x4(const Matrix4& m);
+
+    Vector4& operator[](int index);
+};
+
+inline Matrix3x4::Matrix3x4() {
+    data[0] = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+    data[1] = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+    data[2] = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
 }
 
-inline Vector4 operator*(const Matrix4& left, const Vector4& right) {
-    Vector4 result;
-    result.x = DotProduct(left.data[0], right);
-    result.y = DotProduct(left.data[1], right);
-    result.z = DotProduct(left.data[2], right);
-    result.w = DotProduct(left.data[3], right);
+inline Matrix3x4::Matrix3x4(Vector4 v1, Vector4 v2, Vector4 v3) {
+    data[0] = v1;
+    data[1] = v2;
+    data[2] = v3;
+}
 
-    return result;
+// Drops the last row, so m must be affine
+inline Matrix3x4::Matrix3x4(const Matrix4& m) {
+    data[0] = m.data[0];
+    data[1] = m.data[1];
+    data[2] = m.data[2];
 }
 
-inline Matrix4 operator*(Matrix4 left, Matrix4 right) {
-    Matrix4 result;
-    for (uint32_t row = 0; row < 4; ++row) {
-        Vector4 rowVector = left[row];
-        for (uint32_t column = 0; column < 4; ++column) {
-            Vector4 columnVector = Vector4(right[0][column], right[1][column], right[2][column], right[3][column]);
-            float value = DotProduct(rowVector, columnVector);
+inline Vector4& Matrix3x4::operator[](int index) {
+    return data[index];
+}
 
-            result[row][column] = value;
-        }
-    }
+inline Matrix4 ToMatrix4(const Matrix3x4& m) {
+    return Matrix4(m.data[0], m.data[1], m.data[2], Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+}
 
-    return result;
+inline Vector4 operator*(const Matrix4& left, const Vector4& right) {
+    f32x4 vector = F32x4FromVector4(right);
+    f32x4 r0 = F32x4Mul(F32x4FromVector4(left.data[0]), vector);
+    f32x4 r1 = F32x4Mul(F32x4FromVector4(left.data[1]), vector);
+    f32x4 r2 = F32x4Mul(F32x4FromVector4(left.data[2]), vector);
+    f32x4 r3 = F32x4Mul(F32x4FromVector4(left.data[3]), vector);
+
+    // Transpose the products so that every lane sums up one row
+    F32x4Transpose(&r0, &r1, &r2, &r3);
+    return Vector4FromF32x4(F32x4Add(F32x4Add(r0, r1), F32x4Add(r2, r3)));
 }
 
-inline Matrix4 Transpose(Matrix4& mat) {
+inline Matrix4 operator*(const Matrix4& left, const Matrix4& right) {
     Matrix4 result;
+#if defined(MATH_SIMD_AVX)
+    // Two result rows per iteration. Each 128-bit lane broadcasts its own row element.
+    f32x4 right0 = F32x4FromVector4(right.data[0]);
+    f32x4 right1 = F32x4FromVector4(right.data[1]);
+    f32x4 right2 = F32x4FromVector4(right.data[2]);
+    f32x4 right3 = F32x4FromVector4(right.data[3]);
+    __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(right0), right0, 1);
+    __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(right1), right1, 1);
+    __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(right2), right2, 1);
+    __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(right3), right3, 1);
+
+    for (uint32_t row = 0; row < 4; row += 2) {
+        __m256 leftRows = _mm256_loadu_ps(&left.data[row].x);
+        __m256 value = _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, 0x00), r0);
+        value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, 0x55), r1));
+        value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, 0xAA), r2));
+        value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, 0xFF), r3));
+        _mm256_storeu_ps(&result.data[row].x, value);
+    }
+#else
+    f32x4 r0 = F32x4FromVector4(right.data[0]);
+    f32x4 r1 = F32x4FromVector4(right.data[1]);
+    f32x4 r2 = F32x4FromVector4(right.data[2]);
+    f32x4 r3 = F32x4FromVector4(right.data[3]);
+
     for (uint32_t row = 0; row < 4; ++row) {
-        for (uint32_t column = 0; column < 4; ++column) {
-            result[row][column] = mat[column][row];
-        }
+        f32x4 leftRow = F32x4FromVector4(left.data[row]);
+        f32x4 value = F32x4Mul(F32x4SplatX(leftRow), r0);
+        value = F32x4MulAdd(F32x4SplatY(leftRow), r1, value);
+        value = F32x4MulAdd(F32x4SplatZ(leftRow), r2, value);
+        value = F32x4MulAdd(F32x4SplatW(leftRow), r3, value);
+        result.data[row] = Vector4FromF32x4(value);
     }
+#endif
+
     return result;
 }
 
+inline Matrix4 Transpose(const Matrix4& mat) {
+    f32x4 r0 = F32x4FromVector4(mat.data[0]);
+    f32x4 r1 = F32x4FromVector4(mat.data[1]);
+    f32x4 r2 = F32x4FromVector4(mat.data[2]);
+    f32x4 r3 = F32x4FromVector4(mat.data[3]);
+    F32x4Transpose(&r0, &r1, &r2, &r3);
+
+    return Matrix4(Vector4FromF32x4(r0), Vector4FromF32x4(r1), Vector4FromF32x4(r2), Vector4FromF32x4(r3));
+}
+
 inline Matrix4 PerspectiveMatrixLH(uint32_t width, uint32_t height, float nearDistance, float farDistance, float fov) {
     Matrix4 result;
     const float ar = (float) width / (float) height;
@@ -244,106 +299,210 @@ inline Matrix4 TransformLookAtLH(const Vector3& position, const Vector3& target,
 
 
 
-inline Matrix4 Inverse(Matrix4& mat) {
-    // Matrix inverse code copied from Doom3 source
-    // Using adjugate formula to calculate inverse of matrix
+// 2x2 sub-matrix helpers for Inverse. A 2x2 matrix is stored in one register as (m00, m01, m10, m11).
+// A * B
+inline f32x4 Matrix2Mul(f32x4 a, f32x4 b) {
+    return F32x4Add(F32x4Mul(a, F32X4_SWIZZLE(b, 0, 3, 0, 3)),
+                    F32x4Mul(F32X4_SWIZZLE(a, 1, 0, 3, 2), F32X4_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// Adjugate(A) * B
+inline f32x4 Matrix2AdjMul(f32x4 a, f32x4 b) {
+    return F32x4Sub(F32x4Mul(F32X4_SWIZZLE(a, 3, 3, 0, 0), b),
+                    F32x4Mul(F32X4_SWIZZLE(a, 1, 1, 2, 2), F32X4_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A * Adjugate(B)
+inline f32x4 Matrix2MulAdj(f32x4 a, f32x4 b) {
+    return F32x4Sub(F32x4Mul(a, F32X4_SWIZZLE(b, 3, 0, 3, 0)),
+                    F32x4Mul(F32X4_SWIZZLE(a, 1, 0, 3, 2), F32X4_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+inline Matrix4 Inverse(const Matrix4& mat) {
+    // Block-wise inverse. We split the matrix into 2x2 sub-matrices
+    // | A B |
+    // | C D |
+    // and compute the inverse using adjugates of the sub-matrices.
     // TODO: We should check the matrix is invertible!!
-    Matrix4 result;
-    float det, invDet;
-
-    // 2x2 sub-determinants required to calculate 4x4 determinant
-    float det2_01_01 = mat[0][0] * mat[1][1] - mat[0][1] * mat[1][0];
-    float det2_01_02 = mat[0][0] * mat[1][2] - mat[0][2] * mat[1][0];
-    float det2_01_03 = mat[0][0] * mat[1][3] - mat[0][3] * mat[1][0];
-    float det2_01_12 = mat[0][1] * mat[1][2] - mat[0][2] * mat[1][1];
-    float det2_01_13 = mat[0][1] * mat[1][3] - mat[0][3] * mat[1][1];
-    float det2_01_23 = mat[0][2] * mat[1][3] - mat[0][3] * mat[1][2];
-
-    // 3x3 sub-determinants required to calculate 4x4 determinant
-    float det3_201_012 = mat[2][0] * det2_01_12 - mat[2][1] * det2_01_02 + mat[2][2] * det2_01_01;
-    float det3_201_013 = mat[2][0] * det2_01_13 - mat[2][1] * det2_01_03 + mat[2][3] * det2_01_01;
-    float det3_201_023 = mat[2][0] * det2_01_23 - mat[2][2] * det2_01_03 + mat[2][3] * det2_01_02;
-    float det3_201_123 = mat[2][1] * det2_01_23 - mat[2][2] * det2_01_13 + mat[2][3] * det2_01_12;
-
-    det = (-det3_201_123 * mat[3][0] + det3_201_023 * mat[3][1] - det3_201_013 * mat[3][2] + det3_201_012 * mat[3][3]);
-    invDet = 1.0f / det;
-
-    // remaining 2x2 sub-determinants
-    float det2_03_01 = mat[0][0] * mat[3][1] - mat[0][1] * mat[3][0];
-    float det2_03_02 = mat[0][0] * mat[3][2] - mat[0][2] * mat[3][0];
-    float det2_03_03 = mat[0][0] * mat[3][3] - mat[0][3] * mat[3][0];
-    float det2_03_12 = mat[0][1] * mat[3][2] - mat[0][2] * mat[3][1];
-    float det2_03_13 = mat[0][1] * mat[3][3] - mat[0][3] * mat[3][1];
-    float det2_03_23 = mat[0][2] * mat[3][3] - mat[0][3] * mat[3][2];
-
-    float det2_13_01 = mat[1][0] * mat[3][1] - mat[1][1] * mat[3][0];
-    float det2_13_02 = mat[1][0] * mat[3][2] - mat[1][2] * mat[3][0];
-    float det2_13_03 = mat[1][0] * mat[3][3] - mat[1][3] * mat[3][0];
-    float det2_13_12 = mat[1][1] * mat[3][2] - mat[1][2] * mat[3][1];
-    float det2_13_13 = mat[1][1] * mat[3][3] - mat[1][3] * mat[3][1];
-    float det2_13_23 = mat[1][2] * mat[3][3] - mat[1][3] * mat[3][2];
-
-    // remaining 3x3 sub-determinants
-    float det3_203_012 = mat[2][0] * det2_03_12 - mat[2][1] * det2_03_02 + mat[2][2] * det2_03_01;
-    float det3_203_013 = mat[2][0] * det2_03_13 - mat[2][1] * det2_03_03 + mat[2][3] * det2_03_01;
-    float det3_203_023 = mat[2][0] * det2_03_23 - mat[2][2] * det2_03_03 + mat[2][3] * det2_03_02;
-    float det3_203_123 = mat[2][1] * det2_03_23 - mat[2][2] * det2_03_13 + mat[2][3] * det2_03_12;
-
-    float det3_213_012 = mat[2][0] * det2_13_12 - mat[2][1] * det2_13_02 + mat[2][2] * det2_13_01;
-    float det3_213_013 = mat[2][0] * det2_13_13 - mat[2][1] * det2_13_03 + mat[2][3] * det2_13_01;
-    float det3_213_023 = mat[2][0] * det2_13_23 - mat[2][2] * det2_13_03 + mat[2][3] * det2_13_02;
-    float det3_213_123 = mat[2][1] * det2_13_23 - mat[2][2] * det2_13_13 + mat[2][3] * det2_13_12;
-
-    float det3_301_012 = mat[3][0] * det2_01_12 - mat[3][1] * det2_01_02 + mat[3][2] * det2_01_01;
-    float det3_301_013 = mat[3][0] * det2_01_13 - mat[3][1] * det2_01_03 + mat[3][3] * det2_01_01;
-    float det3_301_023 = mat[3][0] * det2_01_23 - mat[3][2] * det2_01_03 + mat[3][3] * det2_01_02;
-    float det3_301_123 = mat[3][1] * det2_01_23 - mat[3][2] * det2_01_13 + mat[3][3] * det2_01_12;
-
-    result[0][0] = -det3_213_123 * invDet;
-    result[1][0] = +det3_213_023 * invDet;
-    result[2][0] = -det3_213_013 * invDet;
-    result[3][0] = +det3_213_012 * invDet;
-
-    result[0][1] = +det3_203_123 * invDet;
-    result[1][1] = -det3_203_023 * invDet;
-    result[2][1] = +det3_203_013 * invDet;
-    result[3][1] = -det3_203_012 * invDet;
-
-    result[0][2] = +det3_301_123 * invDet;
-    result[1][2] = -det3_301_023 * invDet;
-    result[2][2] = +det3_301_013 * invDet;
-    result[3][2] = -det3_301_012 * invDet;
-
-    result[0][3] = -det3_201_123 * invDet;
-    result[1][3] = +det3_201_023 * invDet;
-    result[2][3] = -det3_201_013 * invDet;
-    result[3][3] = +det3_201_012 * invDet;
+    f32x4 row0 = F32x4FromVector4(mat.data[0]);
+    f32x4 row1 = F32x4FromVector4(mat.data[1]);
+    f32x4 row2 = F32x4FromVector4(mat.data[2]);
+    f32x4 row3 = F32x4FromVector4(mat.data[3]);
+
+    f32x4 A = F32X4_SHUFFLE(row0, row1, 0, 1, 0, 1);
+    f32x4 B = F32X4_SHUFFLE(row0, row1, 2, 3, 2, 3);
+    f32x4 C = F32X4_SHUFFLE(row2, row3, 0, 1, 0, 1);
+    f32x4 D = F32X4_SHUFFLE(row2, row3, 2, 3, 2, 3);
+
+    // Sub-matrix determinants as (|A|, |B|, |C|, |D|)
+    f32x4 detSub = F32x4Sub(F32x4Mul(F32X4_SHUFFLE(row0, row2, 0, 2, 0, 2), F32X4_SHUFFLE(row1, row3, 1, 3, 1, 3)),
+                            F32x4Mul(F32X4_SHUFFLE(row0, row2, 1, 3, 1, 3), F32X4_SHUFFLE(row1, row3, 0, 2, 0, 2)));
+    f32x4 detA = F32x4SplatX(detSub);
+    f32x4 detB = F32x4SplatY(detSub);
+    f32x4 detC = F32x4SplatZ(detSub);
+    f32x4 detD = F32x4SplatW(detSub);
+
+    f32x4 DC = Matrix2AdjMul(D, C);
+    f32x4 AB = Matrix2AdjMul(A, B);
+
+    // Adjugates of the result blocks
+    f32x4 X = F32x4Sub(F32x4Mul(detD, A), Matrix2Mul(B, DC));
+    f32x4 W = F32x4Sub(F32x4Mul(detA, D), Matrix2Mul(C, AB));
+    f32x4 Y = F32x4Sub(F32x4Mul(detB, C), Matrix2MulAdj(D, AB));
+    f32x4 Z = F32x4Sub(F32x4Mul(detC, B), Matrix2MulAdj(A, DC));
+
+    // |M| = |A|*|D| + |B|*|C| - trace(Adj(A)B * Adj(D)C)
+    f32x4 trace = F32x4HorizontalSum(F32x4Mul(AB, F32X4_SWIZZLE(DC, 0, 2, 1, 3)));
+    f32x4 det = F32x4Sub(F32x4Add(F32x4Mul(detA, detD), F32x4Mul(detB, detC)), trace);
+
+    f32x4 invDet = F32x4Div(F32x4Set(1.0f, -1.0f, -1.0f, 1.0f), det);
+    X = F32x4Mul(X, invDet);
+    Y = F32x4Mul(Y, invDet);
+    Z = F32x4Mul(Z, invDet);
+    W = F32x4Mul(W, invDet);
+
+    // Apply the final adjugate shuffle while we are gathering the rows
+    return Matrix4(Vector4FromF32x4(F32X4_SHUFFLE(X, Y, 3, 1, 3, 1)),
+                   Vector4FromF32x4(F32X4_SHUFFLE(X, Y, 2, 0, 2, 0)),
+                   Vector4FromF32x4(F32X4_SHUFFLE(Z, W, 3, 1, 3, 1)),
+                   Vector4FromF32x4(F32X4_SHUFFLE(Z, W, 2, 0, 2, 0)));
+}
+
+// Affine operations. These skip the last row, so a compose is 48 multiply-adds instead of 64.
+inline Matrix3x4 operator*(const Matrix3x4& left, const Matrix3x4& right) {
+    f32x4 r0 = F32x4FromVector4(right.data[0]);
+    f32x4 r1 = F32x4FromVector4(right.data[1]);
+    f32x4 r2 = F32x4FromVector4(right.data[2]);
+    f32x4 r3 = F32x4Set(0.0f, 0.0f, 0.0f, 1.0f);
+
+    Matrix3x4 result;
+    for (u32 row = 0; row < 3; ++row) {
+        f32x4 l = F32x4FromVector4(left.data[row]);
+        f32x4 sum = F32x4Mul(F32x4SplatX(l), r0);
+        sum = F32x4MulAdd(F32x4SplatY(l), r1, sum);
+        sum = F32x4MulAdd(F32x4SplatZ(l), r2, sum);
+        sum = F32x4MulAdd(F32x4SplatW(l), r3, sum);
+        result.data[row] = Vector4FromF32x4(sum);
+    }
 
     return result;
 }
 
-// Transform operations
-inline Matrix4 ScaleMatrix(const Vector3& scaleFactors) {
+// For projection * view * model
+inline Matrix4 operator*(const Matrix4& left, const Matrix3x4& right) {
+    f32x4 r0 = F32x4FromVector4(right.data[0]);
+    f32x4 r1 = F32x4FromVector4(right.data[1]);
+    f32x4 r2 = F32x4FromVector4(right.data[2]);
+
     Matrix4 result;
-    result[0][0] = scaleFactors.x;
-    result[1][1] = scaleFactors.y;
-    result[2][2] = scaleFactors.z;
-    result[3][3] = 1.0f;
+    for (u32 row = 0; row < 4; ++row) {
+        f32x4 l = F32x4FromVector4(left.data[row]);
+        f32x4 sum = F32x4Mul(F32x4SplatX(l), r0);
+        sum = F32x4MulAdd(F32x4SplatY(l), r1, sum);
+        sum = F32x4MulAdd(F32x4SplatZ(l), r2, sum);
+        sum = F32x4Add(sum, F32x4Mul(l, F32x4Set(0.0f, 0.0f, 0.0f, 1.0f)));
+        result.data[row] = Vector4FromF32x4(sum);
+    }
 
     return result;
 }
 
+inline Vector3 operator*(const Matrix3x4& left, const Vector4& right) {
+    f32x4 v = F32x4FromVector4(right);
+    return Vector3(F32x4GetX(F32x4Dot(F32x4FromVector4(left.data[0]), v)),
+                   F32x4GetX(F32x4Dot(F32x4FromVector4(left.data[1]), v)),
+                   F32x4GetX(F32x4Dot(F32x4FromVector4(left.data[2]), v)));
+}
+
+// Inverse of the 3x3 part with cross products of its columns, then the translation is rotated back.
+inline Matrix3x4 Inverse(const Matrix3x4& mat) {
+    f32x4 c0 = F32x4FromVector4(mat.data[0]);
+    f32x4 c1 = F32x4FromVector4(mat.data[1]);
+    f32x4 c2 = F32x4FromVector4(mat.data[2]);
+    f32x4 translation = F32x4Set(0.0f, 0.0f, 0.0f, 1.0f);
+    F32x4Transpose(&c0, &c1, &c2, &translation);
+
+    f32x4 r0 = F32x4Cross3(c1, c2);
+    f32x4 r1 = F32x4Cross3(c2, c0);
+    f32x4 r2 = F32x4Cross3(c0, c1);
+    f32x4 invDeterminant = F32x4Div(F32x4Splat(1.0f), F32x4Dot(c0, r0));
+    r0 = F32x4Mul(r0, invDeterminant);
+    r1 = F32x4Mul(r1, invDeterminant);
+    r2 = F32x4Mul(r2, invDeterminant);
+
+    // W lanes of the rows are zero, so the dot products only see xyz of the translation
+    f32x4 wMask = F32x4Set(0.0f, 0.0f, 0.0f, -1.0f);
+    r0 = F32x4MulAdd(F32x4Dot(r0, translation), wMask, r0);
+    r1 = F32x4MulAdd(F32x4Dot(r1, translation), wMask, r1);
+    r2 = F32x4MulAdd(F32x4Dot(r2, translation), wMask, r2);
+
+    return Matrix3x4(Vector4FromF32x4(r0), Vector4FromF32x4(r1), Vector4FromF32x4(r2));
+}
+
+// Transform operations
+inline Matrix4 ScaleMatrix(const Vector3& scaleFactors) {
+    return Matrix4(Vector4FromF32x4(F32x4Set(scaleFactors.x, 0.0f, 0.0f, 0.0f)),
+                   Vector4FromF32x4(F32x4Set(0.0f, scaleFactors.y, 0.0f, 0.0f)),
+                   Vector4FromF32x4(F32x4Set(0.0f, 0.0f, scaleFactors.z, 0.0f)),
+                   Vector4FromF32x4(F32x4Set(0.0f, 0.0f, 0.0f, 1.0f)));
+}
+
 inline Matrix4 TranslateMatrix(const Vector3& translateVector) {
-    Matrix4 result;
-    result[0][0] = 1.0f;
-    result[0][3] = translateVector.x;
-    result[1][1] = 1.0f;
-    result[1][3] = translateVector.y;
-    result[2][2] = 1.0f;
-    result[2][3] = translateVector.z;
-    result[3][3] = 1.0f;
+    return Matrix4(Vector4FromF32x4(F32x4Set(1.0f, 0.0f, 0.0f, translateVector.x)),
+                   Vector4FromF32x4(F32x4Set(0.0f, 1.0f, 0.0f, translateVector.y)),
+                   Vector4FromF32x4(F32x4Set(0.0f, 0.0f, 1.0f, translateVector.z)),
+                   Vector4FromF32x4(F32x4Set(0.0f, 0.0f, 0.0f, 1.0f)));
+}
 
-    return result;
+// Writes upper 3x3 rotation rows of the quaternion into rows. W components of the rows are zero.
+// Non-unit quaternions are normalized by the 2 / |q|^2 factor.
+inline void QuaternionRotationRows(const Quaternion& quaternion, f32x4* row0, f32x4* row1, f32x4* row2) {
+    f32x4 q = F32x4FromQuaternion(quaternion);
+    f32x4 norm = F32x4Dot(q, q);
+    f32 normSq = F32x4GetX(norm);
+    f32x4 q2 = F32x4Mul(q, F32x4Splat(normSq > 0.0f ? 2.0f / normSq : 0.0f));
+
+    // (yy, xx, xx) + (zz, zz, yy)
+    f32x4 diagonal = F32x4Sub(F32x4Splat(1.0f), F32x4MulAdd(F32X4_SWIZZLE(q, 1, 0, 0, 3), F32X4_SWIZZLE(q2, 1, 0, 0, 3),
+                                                            F32x4Mul(F32X4_SWIZZLE(q, 2, 2, 1, 3), F32X4_SWIZZLE(q2, 2, 2, 1, 3))));
+    // (xy, yz, xz) and (wz, wx, wy)
+    f32x4 products = F32x4Mul(F32X4_SWIZZLE(q, 0, 1, 0, 3), F32X4_SWIZZLE(q2, 1, 2, 2, 3));
+    f32x4 wProducts = F32x4Mul(F32x4SplatW(q), F32X4_SWIZZLE(q2, 2, 0, 1, 3));
+
+    f32 d[4], p[4], m[4];
+    F32x4Store(d, diagonal);
+    F32x4Store(p, F32x4Add(products, wProducts));
+    F32x4Store(m, F32x4Sub(products, wProducts));
+
+    *row0 = F32x4Set(d[0], m[0], p[2], 0.0f);
+    *row1 = F32x4Set(p[0], d[1], m[1], 0.0f);
+    *row2 = F32x4Set(m[2], p[1], d[2], 0.0f);
+}
+
+inline Matrix4 QuaternionToRotationMatrix(const Quaternion& quaternion) {
+    f32x4 row0, row1, row2;
+    QuaternionRotationRows(quaternion, &row0, &row1, &row2);
+
+    return Matrix4(Vector4FromF32x4(row0), Vector4FromF32x4(row1), Vector4FromF32x4(row2),
+                   Vector4FromF32x4(F32x4Set(0.0f, 0.0f, 0.0f, 1.0f)));
+}
+
+// Same as TranslateMatrix(translation) * QuaternionToRotationMatrix(orientation) * ScaleMatrix(scale)
+// without the two 4x4 matrix multiplications.
+inline Matrix3x4 ComposeAffineTransform(const Vector3& translation, const Quaternion& orientation, const Vector3& scale) {
+    f32x4 row0, row1, row2;
+    QuaternionRotationRows(orientation, &row0, &row1, &row2);
+
+    f32x4 scaleVector = F32x4Set(scale.x, scale.y, scale.z, 0.0f);
+    row0 = F32x4MulAdd(row0, scaleVector, F32x4Set(0.0f, 0.0f, 0.0f, translation.x));
+    row1 = F32x4MulAdd(row1, scaleVector, F32x4Set(0.0f, 0.0f, 0.0f, translation.y));
+    row2 = F32x4MulAdd(row2, scaleVector, F32x4Set(0.0f, 0.0f, 0.0f, translation.z));
+
+    return Matrix3x4(Vector4FromF32x4(row0), Vector4FromF32x4(row1), Vector4FromF32x4(row2));
+}
+
+inline Matrix4 ComposeTransformMatrix(const Vector3& translation, const Quaternion& orientation, const Vector3& scale) {
+    return ToMatrix4(ComposeAffineTransform(translation, orientation, scale));
 }
 
 inline Matrix4 RotateMatrixXAxis(float radians) {
@@ -382,6 +541,148 @@ inline Matrix4 RotateMatrixZAxis(float radians) {
     return result;
 }
 
+// Batched version of ComposeAffineTransform. Works on 8 transforms per iteration with the inputs transposed into SoA registers.
+// The input columns can be strided, so fields of an array of structs can be passed directly.
+// Output matrices are matrixRowCount consecutive rows, 3 for Matrix3x4 and 4 for Matrix4 where the last row is filled.
+inline void ComposeTransformRows(const Vector3* translations, u32 translationStride,
+                                 const Quaternion* orientations, u32 orientationStride,
+                                 const Vector3* scales, u32 scaleStride,
+                                 Vector4* outRows, u32 matrixRowCount, u32 count) {
+    const u8* translationData = (const u8*) translations;
+    const u8* orientationData = (const u8*) orientations;
+    const u8* scaleData = (const u8*) scales;
+
+    u32 index = 0;
+    for (; index + 8 <= count; index += 8) {
+        // Gather 8 transforms into SoA lanes
+        f32 lanes[10][8];
+        for (u32 lane = 0; lane < 8; ++lane) {
+            const f32* translation = (const f32*) (translationData + (index + lane) * translationStride);
+            const f32* orientation = (const f32*) (orientationData + (index + lane) * orientationStride);
+            const f32* scale = (const f32*) (scaleData + (index + lane) * scaleStride);
+            lanes[0][lane] = translation[0];
+            lanes[1][lane] = translation[1];
+            lanes[2][lane] = translation[2];
+            lanes[3][lane] = orientation[0];
+            lanes[4][lane] = orientation[1];
+            lanes[5][lane] = orientation[2];
+            lanes[6][lane] = orientation[3];
+            lanes[7][lane] = scale[0];
+            lanes[8][lane] = scale[1];
+            lanes[9][lane] = scale[2];
+        }
+
+        f32x8 x = F32x8Load(lanes[3]);
+        f32x8 y = F32x8Load(lanes[4]);
+        f32x8 z = F32x8Load(lanes[5]);
+        f32x8 w = F32x8Load(lanes[6]);
+        f32x8 scaleX = F32x8Load(lanes[7]);
+        f32x8 scaleY = F32x8Load(lanes[8]);
+        f32x8 scaleZ = F32x8Load(lanes[9]);
+
+        // Zero quaternions stay zero with a clamped norm, so we don't need a select here
+        f32x8 normSq = F32x8MulAdd(x, x, F32x8MulAdd(y, y, F32x8MulAdd(z, z, F32x8Mul(w, w))));
+        f32x8 s = F32x8Div(F32x8Splat(2.0f), F32x8Max(normSq, F32x8Splat(F32Min)));
+        f32x8 x2 = F32x8Mul(x, s);
+        f32x8 y2 = F32x8Mul(y, s);
+        f32x8 z2 = F32x8Mul(z, s);
+
+        f32x8 xx = F32x8Mul(x, x2);
+        f32x8 yy = F32x8Mul(y, y2);
+        f32x8 zz = F32x8Mul(z, z2);
+        f32x8 xy = F32x8Mul(x, y2);
+        f32x8 xz = F32x8Mul(x, z2);
+        f32x8 yz = F32x8Mul(y, z2);
+        f32x8 wx = F32x8Mul(w, x2);
+        f32x8 wy = F32x8Mul(w, y2);
+        f32x8 wz = F32x8Mul(w, z2);
+        f32x8 one = F32x8Splat(1.0f);
+
+        f32 m[12][8];
+        F32x8Store(m[0], F32x8Mul(F32x8Sub(one, F32x8Add(yy, zz)), scaleX));
+        F32x8Store(m[1], F32x8Mul(F32x8Sub(xy, wz), scaleY));
+        F32x8Store(m[2], F32x8Mul(F32x8Add(xz, wy), scaleZ));
+        memcpy(m[3], lanes[0], sizeof(m[3]));
+
+        F32x8Store(m[4], F32x8Mul(F32x8Add(xy, wz), scaleX));
+        F32x8Store(m[5], F32x8Mul(F32x8Sub(one, F32x8Add(xx, zz)), scaleY));
+        F32x8Store(m[6], F32x8Mul(F32x8Sub(yz, wx), scaleZ));
+        memcpy(m[7], lanes[1], sizeof(m[7]));
+
+        F32x8Store(m[8], F32x8Mul(F32x8Sub(xz, wy), scaleX));
+        F32x8Store(m[9], F32x8Mul(F32x8Add(yz, wx), scaleY));
+        F32x8Store(m[10], F32x8Mul(F32x8Sub(one, F32x8Add(xx, yy)), scaleZ));
+        memcpy(m[11], lanes[2], sizeof(m[11]));
+
+        // Transpose back to one matrix per entity, 4 entities at a time
+        f32x4 lastRow = F32x4Set(0.0f, 0.0f, 0.0f, 1.0f);
+        for (u32 half = 0; half < 8; half += 4) {
+            Vector4* out = outRows + (index + half) * matrixRowCount;
+            for (u32 row = 0; row < 3; ++row) {
+                f32x4 r0 = F32x4Load(m[row * 4 + 0] + half);
+                f32x4 r1 = F32x4Load(m[row * 4 + 1] + half);
+                f32x4 r2 = F32x4Load(m[row * 4 + 2] + half);
+                f32x4 r3 = F32x4Load(m[row * 4 + 3] + half);
+                F32x4Transpose(&r0, &r1, &r2, &r3);
+                F32x4Store(&out[0 * matrixRowCount + row].x, r0);
+                F32x4Store(&out[1 * matrixRowCount + row].x, r1);
+                F32x4Store(&out[2 * matrixRowCount + row].x, r2);
+                F32x4Store(&out[3 * matrixRowCount + row].x, r3);
+            }
+            if (matrixRowCount == 4) {
+                for (u32 i = 0; i < 4; ++i) {
+                    F32x4Store(&out[i * 4 + 3].x, lastRow);
+                }
+            }
+        }
+    }
+
+    for (; index < count; ++index) {
+        const Vector3* translation = (const Vector3*) (translationData + index * translationStride);
+        const Quaternion* orientation = (const Quaternion*) (orientationData + index * orientationStride);
+        const Vector3* scale = (const Vector3*) (scaleData + index * scaleStride);
+        Matrix3x4 matrix = ComposeAffineTransform(*translation, *orientation, *scale);
+
+        Vector4* out = outRows + index * matrixRowCount;
+        out[0] = matrix.data[0];
+        out[1] = matrix.data[1];
+        out[2] = matrix.data[2];
+        if (matrixRowCount == 4) {
+            out[3] = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+}
+
+inline void ComposeTransformMatrices(const Vector3* translations, u32 translationStride,
+                                     const Quaternion* orientations, u32 orientationStride,
+                                     const Vector3* scales, u32 scaleStride,
+                                     Matrix3x4* outMatrices, u32 count) {
+    ComposeTransformRows(translations, translationStride, orientations, orientationStride, scales, scaleStride,
+                         outMatrices->data, 3, count);
+}
+
+inline void ComposeTransformMatrices(const Vector3* translations, u32 translationStride,
+                                     const Quaternion* orientations, u32 orientationStride,
+                                     const Vector3* scales, u32 scaleStride,
+                                     Matrix4* outMatrices, u32 count) {
+    ComposeTransformRows(translations, translationStride, orientations, orientationStride, scales, scaleStride,
+                         outMatrices->data, 4, count);
+}
+
+// Batched QuaternionToRotationMatrix. Zero strides broadcast the identity translation and scale into the SoA kernel.
+inline void QuaternionsToRotationMatrices(const Quaternion* quaternions, u32 quaternionStride, Matrix4* outMatrices, u32 count) {
+    const Vector3 zeroTranslation = Vector3(0.0f);
+    const Vector3 unitScale = Vector3(1.0f);
+    ComposeTransformMatrices(&zeroTranslation, 0, quaternions, quaternionStride, &unitScale, 0, outMatrices, count);
+}
+
+inline void QuaternionsToRotationMatrices(const Quaternion* quaternions, u32 quaternionStride, Matrix3x4* outMatrices, u32 count) {
+    const Vector3 zeroTranslation = Vector3(0.0f);
+    const Vector3 unitScale = Vector3(1.0f);
+    ComposeTransformMatrices(&zeroTranslation, 0, quaternions, quaternionStride, &unitScale, 0, outMatrices, count);
+}
+
 static const Matrix4 IdentityMatrix(Vector4(1.0f, 0.0f, 0.0f, 0.0f), Vector4(0.0f, 1.0f, 0.0f, 0.0f), Vector4(0.0f, 0.0f, 1.0f, 0.0f), Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+static const Matrix3x4 IdentityAffine(Vector4(1.0f, 0.0f, 0.0f, 0.0f), Vector4(0.0f, 1.0f, 0.0f, 0.0f), Vector4(0.0f, 0.0f, 1.0f, 0.0f));
 
 #endif
\ No newline at end of file
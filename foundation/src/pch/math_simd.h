@@ -0,0 +1,212 @@
+#ifndef _MATH_SIMD_H_
+#define _MATH_SIMD_H_
+
+// SIMD backend selection.
+// Define MATH_SIMD_AVX, MATH_SIMD_SSE, MATH_SIMD_NEON or MATH_SIMD_SCALAR before including pch.h to force a backend.
+// Otherwise we pick the widest instruction set the compiler is targeting (/arch:AVX, -mavx, etc.).
+#if !defined(MATH_SIMD_AVX) && !defined(MATH_SIMD_SSE) && !defined(MATH_SIMD_NEON) && !defined(MATH_SIMD_SCALAR)
+    #if defined(__AVX__)
+        #define MATH_SIMD_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define MATH_SIMD_SSE
+    #elif defined(__ARM_NEON) || defined(_M_ARM64)
+        #define MATH_SIMD_NEON
+    #else
+        #define MATH_SIMD_SCALAR
+    #endif
+#endif
+
+// AVX builds use SSE for 4-wide operations and 256-bit registers where we can process two rows at once
+#if defined(MATH_SIMD_AVX) && !defined(MATH_SIMD_SSE)
+    #define MATH_SIMD_SSE
+#endif
+
+#if defined(MATH_SIMD_SSE)
+    #include <immintrin.h>
+#elif defined(MATH_SIMD_NEON)
+    #include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+// 4-wide float vector. Loads and stores are unaligned, so we don't impose any alignment on math types.
+#if defined(MATH_SIMD_SSE)
+
+typedef __m128 f32x4;
+
+inline f32x4 F32x4Load(const f32* p) { return _mm_loadu_ps(p); }
+inline void F32x4Store(f32* p, f32x4 v) { _mm_storeu_ps(p, v); }
+inline f32x4 F32x4Set(f32 x, f32 y, f32 z, f32 w) { return _mm_setr_ps(x, y, z, w); }
+inline f32x4 F32x4Splat(f32 v) { return _mm_set1_ps(v); }
+inline f32x4 F32x4Zero() { return _mm_setzero_ps(); }
+
+inline f32x4 F32x4Add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+inline f32x4 F32x4Sub(f32x4 a, f32x4 b) { return _mm_sub_ps(a, b); }
+inline f32x4 F32x4Mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+inline f32x4 F32x4Div(f32x4 a, f32x4 b) { return _mm_div_ps(a, b); }
+inline f32x4 F32x4Min(f32x4 a, f32x4 b) { return _mm_min_ps(a, b); }
+inline f32x4 F32x4Max(f32x4 a, f32x4 b) { return _mm_max_ps(a, b); }
+inline f32x4 F32x4Sqrt(f32x4 a) { return _mm_sqrt_ps(a); }
+
+// a * b + c
+inline f32x4 F32x4MulAdd(f32x4 a, f32x4 b, f32x4 c)
+{
+#if defined(__FMA__)
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+inline f32 F32x4GetX(f32x4 v) { return _mm_cvtss_f32(v); }
+
+// Result is (a[x], a[y], b[z], b[w]). Indices must be compile-time constants.
+#define F32X4_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), _MM_SHUFFLE((w), (z), (y), (x)))
+
+#elif defined(MATH_SIMD_NEON)
+
+typedef float32x4_t f32x4;
+
+inline f32x4 F32x4Load(const f32* p) { return vld1q_f32(p); }
+inline void F32x4Store(f32* p, f32x4 v) { vst1q_f32(p, v); }
+inline f32x4 F32x4Set(f32 x, f32 y, f32 z, f32 w) { f32 v[4] = { x, y, z, w }; return vld1q_f32(v); }
+inline f32x4 F32x4Splat(f32 v) { return vdupq_n_f32(v); }
+inline f32x4 F32x4Zero() { return vdupq_n_f32(0.0f); }
+
+inline f32x4 F32x4Add(f32x4 a, f32x4 b) { return vaddq_f32(a, b); }
+inline f32x4 F32x4Sub(f32x4 a, f32x4 b) { return vsubq_f32(a, b); }
+inline f32x4 F32x4Mul(f32x4 a, f32x4 b) { return vmulq_f32(a, b); }
+inline f32x4 F32x4Div(f32x4 a, f32x4 b) { return vdivq_f32(a, b); }
+inline f32x4 F32x4Min(f32x4 a, f32x4 b) { return vminq_f32(a, b); }
+inline f32x4 F32x4Max(f32x4 a, f32x4 b) { return vmaxq_f32(a, b); }
+inline f32x4 F32x4Sqrt(f32x4 a) { return vsqrtq_f32(a); }
+inline f32x4 F32x4MulAdd(f32x4 a, f32x4 b, f32x4 c) { return vfmaq_f32(c, a, b); }
+
+inline f32 F32x4GetX(f32x4 v) { return vgetq_lane_f32(v, 0); }
+
+#if defined(__clang__) || defined(__GNUC__)
+#define F32X4_SHUFFLE(a, b, x, y, z, w) __builtin_shufflevector((a), (b), (x), (y), (z) + 4, (w) + 4)
+#else
+#define F32X4_SHUFFLE(a, b, x, y, z, w) \
+    vsetq_lane_f32(vgetq_lane_f32((b), (w)), vsetq_lane_f32(vgetq_lane_f32((b), (z)), \
+    vsetq_lane_f32(vgetq_lane_f32((a), (y)), vdupq_n_f32(vgetq_lane_f32((a), (x))), 1), 2), 3)
+#endif
+
+#else // MATH_SIMD_SCALAR
+
+struct f32x4
+{
+    f32 v[4];
+};
+
+inline f32x4 F32x4Load(const f32* p) { return f32x4 { p[0], p[1], p[2], p[3] }; }
+inline void F32x4Store(f32* p, f32x4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+inline f32x4 F32x4Set(f32 x, f32 y, f32 z, f32 w) { return f32x4 { x, y, z, w }; }
+inline f32x4 F32x4Splat(f32 v) { return f32x4 { v, v, v, v }; }
+inline f32x4 F32x4Zero() { return f32x4 { 0.0f, 0.0f, 0.0f, 0.0f }; }
+
+inline f32x4 F32x4Add(f32x4 a, f32x4 b) { return f32x4 { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] }; }
+inline f32x4 F32x4Sub(f32x4 a, f32x4 b) { return f32x4 { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] }; }
+inline f32x4 F32x4Mul(f32x4 a, f32x4 b) { return f32x4 { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] }; }
+inline f32x4 F32x4Div(f32x4 a, f32x4 b) { return f32x4 { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] }; }
+inline f32x4 F32x4Min(f32x4 a, f32x4 b) { return f32x4 { fminf(a.v[0], b.v[0]), fminf(a.v[1], b.v[1]), fminf(a.v[2], b.v[2]), fminf(a.v[3], b.v[3]) }; }
+inline f32x4 F32x4Max(f32x4 a, f32x4 b) { return f32x4 { fmaxf(a.v[0], b.v[0]), fmaxf(a.v[1], b.v[1]), fmaxf(a.v[2], b.v[2]), fmaxf(a.v[3], b.v[3]) }; }
+inline f32x4 F32x4Sqrt(f32x4 a) { return f32x4 { sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3]) }; }
+inline f32x4 F32x4MulAdd(f32x4 a, f32x4 b, f32x4 c) { return F32x4Add(F32x4Mul(a, b), c); }
+
+inline f32 F32x4GetX(f32x4 v) { return v.v[0]; }
+
+#define F32X4_SHUFFLE(a, b, x, y, z, w) F32x4Set((a).v[(x)], (a).v[(y)], (b).v[(z)], (b).v[(w)])
+
+#endif
+
+#define F32X4_SWIZZLE(a, x, y, z, w) F32X4_SHUFFLE(a, a, x, y, z, w)
+
+inline f32x4 F32x4SplatX(f32x4 v) { return F32X4_SWIZZLE(v, 0, 0, 0, 0); }
+inline f32x4 F32x4SplatY(f32x4 v) { return F32X4_SWIZZLE(v, 1, 1, 1, 1); }
+inline f32x4 F32x4SplatZ(f32x4 v) { return F32X4_SWIZZLE(v, 2, 2, 2, 2); }
+inline f32x4 F32x4SplatW(f32x4 v) { return F32X4_SWIZZLE(v, 3, 3, 3, 3); }
+
+// Sum of all lanes, broadcasted to every lane
+inline f32x4 F32x4HorizontalSum(f32x4 v)
+{
+    f32x4 sum = F32x4Add(v, F32X4_SWIZZLE(v, 1, 0, 3, 2));
+    return F32x4Add(sum, F32X4_SWIZZLE(sum, 2, 3, 0, 1));
+}
+
+inline f32x4 F32x4Dot(f32x4 a, f32x4 b)
+{
+    return F32x4HorizontalSum(F32x4Mul(a, b));
+}
+
+// Cross product of the xyz lanes. W lane of the result is zero.
+inline f32x4 F32x4Cross3(f32x4 a, f32x4 b)
+{
+    return F32x4Sub(F32x4Mul(F32X4_SWIZZLE(a, 1, 2, 0, 3), F32X4_SWIZZLE(b, 2, 0, 1, 3)),
+                    F32x4Mul(F32X4_SWIZZLE(a, 2, 0, 1, 3), F32X4_SWIZZLE(b, 1, 2, 0, 3)));
+}
+
+inline void F32x4Transpose(f32x4* r0, f32x4* r1, f32x4* r2, f32x4* r3)
+{
+    f32x4 t0 = F32X4_SHUFFLE(*r0, *r1, 0, 1, 0, 1);
+    f32x4 t1 = F32X4_SHUFFLE(*r0, *r1, 2, 3, 2, 3);
+    f32x4 t2 = F32X4_SHUFFLE(*r2, *r3, 0, 1, 0, 1);
+    f32x4 t3 = F32X4_SHUFFLE(*r2, *r3, 2, 3, 2, 3);
+
+    *r0 = F32X4_SHUFFLE(t0, t2, 0, 2, 0, 2);
+    *r1 = F32X4_SHUFFLE(t0, t2, 1, 3, 1, 3);
+    *r2 = F32X4_SHUFFLE(t1, t3, 0, 2, 0, 2);
+    *r3 = F32X4_SHUFFLE(t1, t3, 1, 3, 1, 3);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+// 8-wide float vector for SoA kernels that process 8 elements per iteration.
+// Native on AVX, two 4-wide registers everywhere else.
+#if defined(MATH_SIMD_AVX)
+
+typedef __m256 f32x8;
+
+inline f32x8 F32x8Load(const f32* p) { return _mm256_loadu_ps(p); }
+inline void F32x8Store(f32* p, f32x8 v) { _mm256_storeu_ps(p, v); }
+inline f32x8 F32x8Splat(f32 v) { return _mm256_set1_ps(v); }
+
+inline f32x8 F32x8Add(f32x8 a, f32x8 b) { return _mm256_add_ps(a, b); }
+inline f32x8 F32x8Sub(f32x8 a, f32x8 b) { return _mm256_sub_ps(a, b); }
+inline f32x8 F32x8Mul(f32x8 a, f32x8 b) { return _mm256_mul_ps(a, b); }
+inline f32x8 F32x8Div(f32x8 a, f32x8 b) { return _mm256_div_ps(a, b); }
+inline f32x8 F32x8Min(f32x8 a, f32x8 b) { return _mm256_min_ps(a, b); }
+inline f32x8 F32x8Max(f32x8 a, f32x8 b) { return _mm256_max_ps(a, b); }
+
+inline f32x8 F32x8MulAdd(f32x8 a, f32x8 b, f32x8 c)
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+#else
+
+struct f32x8
+{
+    f32x4 lo;
+    f32x4 hi;
+};
+
+inline f32x8 F32x8Load(const f32* p) { return f32x8 { F32x4Load(p), F32x4Load(p + 4) }; }
+inline void F32x8Store(f32* p, f32x8 v) { F32x4Store(p, v.lo); F32x4Store(p + 4, v.hi); }
+inline f32x8 F32x8Splat(f32 v) { f32x4 s = F32x4Splat(v); return f32x8 { s, s }; }
+
+inline f32x8 F32x8Add(f32x8 a, f32x8 b) { return f32x8 { F32x4Add(a.lo, b.lo), F32x4Add(a.hi, b.hi) }; }
+inline f32x8 F32x8Sub(f32x8 a, f32x8 b) { return f32x8 { F32x4Sub(a.lo, b.lo), F32x4Sub(a.hi, b.hi) }; }
+inline f32x8 F32x8Mul(f32x8 a, f32x8 b) { return f32x8 { F32x4Mul(a.lo, b.lo), F32x4Mul(a.hi, b.hi) }; }
+inline f32x8 F32x8Div(f32x8 a, f32x8 b) { return f32x8 { F32x4Div(a.lo, b.lo), F32x4Div(a.hi, b.hi) }; }
+inline f32x8 F32x8Min(f32x8 a, f32x8 b) { return f32x8 { F32x4Min(a.lo, b.lo), F32x4Min(a.hi, b.hi) }; }
+inline f32x8 F32x8Max(f32x8 a, f32x8 b) { return f32x8 { F32x4Max(a.lo, b.lo), F32x4Max(a.hi, b.hi) }; }
+inline f32x8 F32x8MulAdd(f32x8 a, f32x8 b, f32x8 c) { return f32x8 { F32x4MulAdd(a.lo, b.lo, c.lo), F32x4MulAdd(a.hi, b.hi, c.hi) }; }
+
+#endif
+
+#endif
@@ -1,8 +1,10 @@
 #ifndef _MATH_H_
 #define _MATH_H_
 
+#include "math_simd.h"
 #include "math_vector.h"
 #include "math_matrix.h"
+#include "math_bounds.h"
 
 #define PI 3.141592654f
 #define TWOPI 6.283185307f
@@ -33,6 +35,41 @@ inline Vector4 Lerp(Vector4 left, float factor, Vector4 right) {
     return left * (1.0f - factor) + right * factor;
 }
 
+// Normalized lerp. Takes the shortest path but the angular velocity isn't constant,
+// which is fine for small steps like animation keys and blending.
+inline Quaternion Nlerp(Quaternion left, float factor, Quaternion right) {
+    f32x4 a = F32x4FromQuaternion(left);
+    f32x4 b = F32x4FromQuaternion(right);
+    float rightFactor = DotProduct(left, right) < 0.0f ? -factor : factor;
+
+    f32x4 result = F32x4MulAdd(a, F32x4Splat(1.0f - factor), F32x4Mul(b, F32x4Splat(rightFactor)));
+    f32x4 length = F32x4Sqrt(F32x4Dot(result, result));
+    return QuaternionFromF32x4(F32x4Div(result, length));
+}
+
+inline Quaternion Slerp(Quaternion left, float factor, Quaternion right) {
+    float cosTheta = DotProduct(left, right);
+    float sign = 1.0f;
+    if (cosTheta < 0.0f) {
+        cosTheta = -cosTheta;
+        sign = -1.0f;
+    }
+
+    // Nearly parallel quaternions, sinTheta goes to zero
+    if (cosTheta > 0.9995f) {
+        return Nlerp(left, factor, right);
+    }
+
+    float theta = acosf(cosTheta);
+    float invSinTheta = 1.0f / sinf(theta);
+    float leftFactor = sinf((1.0f - factor) * theta) * invSinTheta;
+    float rightFactor = sign * sinf(factor * theta) * invSinTheta;
+
+    f32x4 result = F32x4MulAdd(F32x4FromQuaternion(left), F32x4Splat(leftFactor),
+                               F32x4Mul(F32x4FromQuaternion(right), F32x4Splat(rightFactor)));
+    return QuaternionFromF32x4(result);
+}
+
 // The state must be initialized to non-zero value
 inline uint32_t XOrShift32(uint32_t *state)
 {
@@ -280,56 +280,66 @@ inline Vector3 Vector4::xyz() {
     return Vector3 {x, y, z};
 }
 
+inline f32x4 F32x4FromVector4(Vector4 v) {
+    return F32x4Load(&v.x);
+}
+
+inline Vector4 Vector4FromF32x4(f32x4 v) {
+    Vector4 result;
+    F32x4Store(&result.x, v);
+    return result;
+}
+
 inline Vector4 operator-(Vector4 v) {
-    return Vector4 {-v.x, -v.y, -v.z, -v.w};
+    return Vector4FromF32x4(F32x4Sub(F32x4Zero(), F32x4FromVector4(v)));
 }
 
 inline Vector4 operator+=(Vector4 v1, Vector4 v2) {
-    return Vector4 { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z, v1.w + v2.w};
+    return Vector4FromF32x4(F32x4Add(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator*=(Vector4 v1, Vector4 v2) {
-    return Vector4 { v1.x * v2.x, v1.y * v2.y, v1.z * v2.z, v1.w * v2.w};
+    return Vector4FromF32x4(F32x4Mul(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator-=(Vector4 v1, Vector4 v2) {
-    return Vector4 { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z, v1.w - v2.w};
+    return Vector4FromF32x4(F32x4Sub(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator/=(Vector4 v1, Vector4 v2) {
-    return Vector4 { v1.x / v2.x, v1.y / v2.y, v1.z / v2.z, v1.w / v2.w};
+    return Vector4FromF32x4(F32x4Div(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator*(Vector4 v1, Vector4 v2) {
-    return Vector4 {v1.x * v2.x, v1.y * v2.y, v1.z * v2.z, v1.w * v2.w};
+    return Vector4FromF32x4(F32x4Mul(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator/(Vector4 v1, Vector4 v2) {
-    return Vector4 {v1.x / v2.x, v1.y / v2.y, v1.z / v2.z, v1.w / v2.w};
+    return Vector4FromF32x4(F32x4Div(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator+(Vector4 v1, Vector4 v2) {
-    return Vector4 {v1.x + v2.x, v1.y + v2.y, v1.z + v2.z, v1.w + v2.w};
+    return Vector4FromF32x4(F32x4Add(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator-(Vector4 v1, Vector4 v2) {
-    return Vector4 {v1.x - v2.x, v1.y - v2.y, v1.z - v2.z, v1.w - v2.w};
+    return Vector4FromF32x4(F32x4Sub(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline Vector4 operator*(Vector4 v1, float factor) {
-    return Vector4 {v1.x * factor, v1.y * factor, v1.z * factor, v1.w * factor};
+    return Vector4FromF32x4(F32x4Mul(F32x4FromVector4(v1), F32x4Splat(factor)));
 }
 
 inline Vector4 operator+(Vector4 v1, float factor) {
-    return Vector4 {v1.x + factor, v1.y + factor, v1.z + factor, v1.w + factor};
+    return Vector4FromF32x4(F32x4Add(F32x4FromVector4(v1), F32x4Splat(factor)));
 }
 
 inline Vector4 operator-(Vector4 v1, float factor) {
-    return Vector4 {v1.x - factor, v1.y - factor, v1.z - factor, v1.w - factor};
+    return Vector4FromF32x4(F32x4Sub(F32x4FromVector4(v1), F32x4Splat(factor)));
 }
 
 inline Vector4 operator/(Vector4 v1, float factor) {
-    return Vector4 {v1.x / factor, v1.y / factor, v1.z / factor, v1.w / factor};
+    return Vector4FromF32x4(F32x4Div(F32x4FromVector4(v1), F32x4Splat(factor)));
 }
 
 inline bool operator==(Vector4 v1, Vector4 v2) {
@@ -341,7 +351,7 @@ inline bool operator!=(Vector4 v1, Vector4 v2) {
 }
 
 inline float DotProduct(Vector4 v1, Vector4 v2) {
-    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+    return F32x4GetX(F32x4Dot(F32x4FromVector4(v1), F32x4FromVector4(v2)));
 }
 
 inline float Lenght(Vector4 v) {
@@ -349,11 +359,119 @@ inline float Lenght(Vector4 v) {
 }
 
 inline Vector4 Normalize(Vector4 v) {
-    const float dot = DotProduct(v, v);
-    const float factor = 1 / sqrtf(dot);
-    return Vector4 {v.x * factor, v.y * factor, v.z * factor, v.w * factor};
+    f32x4 vector = F32x4FromVector4(v);
+    f32x4 length = F32x4Sqrt(F32x4Dot(vector, vector));
+    return Vector4FromF32x4(F32x4Div(vector, length));
 }
 
 inline Vector4 Floor(Vector4 v) {
     return Vector4 {floorf(v.x), floorf(v.y), floorf(v.z), floorf(v.w)};
 }
+
+////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+// Rotation quaternion (x, y, z, w) where w is the scalar part. Same memory layout as Vector4 and glTF rotations.
+struct Quaternion {
+    f32 x, y, z, w = 1.0f;
+
+    Quaternion();
+    Quaternion(f32 x, f32 y, f32 z, f32 w);
+    Quaternion(Vector3 axis, f32 radians);
+
+    Vector3 xyz();
+};
+
+inline Quaternion::Quaternion() {
+    this->x = 0.0f;
+    this->y = 0.0f;
+    this->z = 0.0f;
+    this->w = 1.0f;
+}
+
+inline Quaternion::Quaternion(f32 x, f32 y, f32 z, f32 w) {
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->w = w;
+}
+
+// Axis must be normalized
+inline Quaternion::Quaternion(Vector3 axis, f32 radians) {
+    const f32 halfSin = sinf(radians * 0.5f);
+    this->x = axis.x * halfSin;
+    this->y = axis.y * halfSin;
+    this->z = axis.z * halfSin;
+    this->w = cosf(radians * 0.5f);
+}
+
+inline Vector3 Quaternion::xyz() {
+    return Vector3 {x, y, z};
+}
+
+inline f32x4 F32x4FromQuaternion(Quaternion q) {
+    return F32x4Load(&q.x);
+}
+
+inline Quaternion QuaternionFromF32x4(f32x4 v) {
+    Quaternion result;
+    F32x4Store(&result.x, v);
+    return result;
+}
+
+// Hamilton product. Rotating with (left * right) applies right first, then left.
+inline Quaternion operator*(Quaternion left, Quaternion right) {
+    f32x4 a = F32x4FromQuaternion(left);
+    f32x4 b = F32x4FromQuaternion(right);
+
+    // aw * (bx, by, bz, bw) + ax * (bw, -bz, by, -bx) + ay * (bz, bw, -bx, -by) + az * (-by, bx, bw, -bz)
+    f32x4 result = F32x4Mul(F32x4SplatW(a), b);
+    result = F32x4MulAdd(F32x4Mul(F32x4SplatX(a), F32X4_SWIZZLE(b, 3, 2, 1, 0)), F32x4Set(1.0f, -1.0f, 1.0f, -1.0f), result);
+    result = F32x4MulAdd(F32x4Mul(F32x4SplatY(a), F32X4_SWIZZLE(b, 2, 3, 0, 1)), F32x4Set(1.0f, 1.0f, -1.0f, -1.0f), result);
+    result = F32x4MulAdd(F32x4Mul(F32x4SplatZ(a), F32X4_SWIZZLE(b, 1, 0, 3, 2)), F32x4Set(-1.0f, 1.0f, 1.0f, -1.0f), result);
+
+    return QuaternionFromF32x4(result);
+}
+
+inline Quaternion operator-(Quaternion q) {
+    return QuaternionFromF32x4(F32x4Sub(F32x4Zero(), F32x4FromQuaternion(q)));
+}
+
+inline bool operator==(Quaternion q1, Quaternion q2) {
+    return ((q1.x == q2.x) && (q1.y == q2.y) && (q1.z == q2.z) && (q1.w == q2.w));
+}
+
+inline bool operator!=(Quaternion q1, Quaternion q2) {
+    return ((q1.x != q2.x) || (q1.y != q2.y) || (q1.z != q2.z) || (q1.w != q2.w));
+}
+
+inline float DotProduct(Quaternion q1, Quaternion q2) {
+    return F32x4GetX(F32x4Dot(F32x4FromQuaternion(q1), F32x4FromQuaternion(q2)));
+}
+
+inline float Lenght(Quaternion q) {
+    return sqrtf(DotProduct(q, q));
+}
+
+inline Quaternion Normalize(Quaternion q) {
+    f32x4 quaternion = F32x4FromQuaternion(q);
+    f32x4 length = F32x4Sqrt(F32x4Dot(quaternion, quaternion));
+    return QuaternionFromF32x4(F32x4Div(quaternion, length));
+}
+
+inline Quaternion Conjugate(Quaternion q) {
+    return QuaternionFromF32x4(F32x4Mul(F32x4FromQuaternion(q), F32x4Set(-1.0f, -1.0f, -1.0f, 1.0f)));
+}
+
+// Conjugate is enough for unit quaternions
+inline Quaternion Inverse(Quaternion q) {
+    f32x4 quaternion = F32x4FromQuaternion(q);
+    f32x4 conjugate = F32x4Mul(quaternion, F32x4Set(-1.0f, -1.0f, -1.0f, 1.0f));
+    return QuaternionFromF32x4(F32x4Div(conjugate, F32x4Dot(quaternion, quaternion)));
+}
+
+// Rotates the vector with a unit quaternion: v + 2w * (u x v) + 2 * (u x (u x v))
+inline Vector3 Rotate(Quaternion q, Vector3 v) {
+    Vector3 u = Vector3 {q.x, q.y, q.z};
+    Vector3 t = CrossProduct(u, v) * 2.0f;
+    return v + t * q.w + CrossProduct(u, t);
+}
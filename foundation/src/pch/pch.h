@@ -28,6 +28,7 @@ typedef XXH64_hash_t Hash64;
 #include "HashTable.h"
 #include "Keycode.h"
 #include "math_util.h"
+#include "Atomic.h"
 
 
 // Memory
@@ -125,12 +126,13 @@ inline const char* PathGetExtension(const char* path)
 }
 
 #define NULL_INDEX 0xFFFFFFFF
-#define INVALID_HANDLE_INDEX 0xFFFF
+#define INVALID_HANDLE_INDEX 0xFFFFFF
 
+// Generations are stored as u8 in the pools
 struct Handle
 {
-    u32 index : 16;
-    u32 generation : 16;
+    u32 index : 24;
+    u32 generation : 8;
 };
 
 inline bool operator==(Handle h1, Handle h2)
@@ -143,15 +145,21 @@ inline bool operator!=(Handle h1, Handle h2)
     return h1.index != h2.index || h1.generation != h2.generation;
 }
 
-const Handle INVALID_HANDLE = { .index = INVALID_HANDLE_INDEX, .generation = 0xFFFF };
+const Handle INVALID_HANDLE = { .index = INVALID_HANDLE_INDEX, .generation = 0xFF };
 
 struct HandlePool 
 {
     u8* data;
     u8* generations;
     u32 freeIndex;
+    // Elements after this index were never used. We take them when the free list is empty,
+    // so big pools don't need to initialize the whole free list up front.
+    u32 usedCount;
     u32 elementCount;
     u32 resourceSize;
+    // Growing pools commit memory for elements when usedCount reaches them, otherwise these are null
+    ILinearAllocator* dataAllocator;
+    ILinearAllocator* generationAllocator;
 };
 
 struct EmptyPoolData
@@ -161,42 +169,71 @@ struct EmptyPoolData
 
 inline HandlePool InitHandlePool(ILinearAllocator* allocator, u32 elementCount, u32 resourceSize)
 {
-    ASSERT(elementCount < 0xFFFF, "The element count cannot be more than max 24 bit value");
+    ASSERT(elementCount < INVALID_HANDLE_INDEX, "The element count cannot be more than max 24 bit value");
     ASSERT(resourceSize >= 4, "Element size cannot be less than 4 bytes");
 
     HandlePool handlePool = {};
     handlePool.elementCount = elementCount;
-    handlePool.data = (u8*) allocator->Alloc(allocator->instance, elementCount * resourceSize);
+    handlePool.data = (u8*) allocator->Alloc(allocator->instance, (u64) elementCount * resourceSize);
     handlePool.generations = (u8*) allocator->Alloc(allocator->instance, elementCount);
+    memset(handlePool.generations, 0, elementCount);
     handlePool.resourceSize = resourceSize;
-    handlePool.freeIndex = 0;
+    handlePool.freeIndex = NULL_INDEX;
+    handlePool.usedCount = 0;
 
-    for (u32 i = 0; i < (elementCount - 1); ++i)
-    {
-        EmptyPoolData* emptyData = (EmptyPoolData*) (handlePool.data + (i * resourceSize));
-        emptyData->nextFreeIndex = i + 1;
-    }
+    return handlePool;
+}
 
-    // Last element
-    EmptyPoolData* emptyData = (EmptyPoolData*) (handlePool.data + ((elementCount - 1) * resourceSize));
-    emptyData->nextFreeIndex = NULL_INDEX;
+// Only reserves memory for elementCount elements, so big pools that are mostly empty stay cheap
+inline HandlePool InitGrowingHandlePool(AllocatorAPI* allocatorAPI, u32 elementCount, u32 resourceSize)
+{
+    ASSERT(elementCount < INVALID_HANDLE_INDEX, "The element count cannot be more than max 24 bit value");
+    ASSERT(resourceSize >= 4, "Element size cannot be less than 4 bytes");
+
+    HandlePool handlePool = {};
+    handlePool.elementCount = elementCount;
+    handlePool.dataAllocator = allocatorAPI->CreateLinearAllocator((u64) elementCount * resourceSize, VM_PAGE_SIZE);
+    handlePool.generationAllocator = allocatorAPI->CreateLinearAllocator(elementCount, VM_PAGE_SIZE);
+    handlePool.data = handlePool.dataAllocator->instance->pointer;
+    handlePool.generations = handlePool.generationAllocator->instance->pointer;
+    handlePool.resourceSize = resourceSize;
+    handlePool.freeIndex = NULL_INDEX;
+    handlePool.usedCount = 0;
 
     return handlePool;
 }
 
-inline Handle ObtainNewHandleFromPool(HandlePool* pool)
+inline void DestroyGrowingHandlePool(HandlePool* pool, AllocatorAPI* allocatorAPI)
 {
-    ASSERT(pool->freeIndex < pool->elementCount && pool->freeIndex != NULL_INDEX, "Not enough space in handle pool");
+    allocatorAPI->DestroyLinearAllocator(pool->dataAllocator);
+    allocatorAPI->DestroyLinearAllocator(pool->generationAllocator);
+    *pool = {};
+}
 
+inline Handle ObtainNewHandleFromPool(HandlePool* pool)
+{
     u32 freeIndex = pool->freeIndex;
+    if (freeIndex != NULL_INDEX)
+    {
+        EmptyPoolData* emptyData = (EmptyPoolData*) (pool->data + ((u64) freeIndex * pool->resourceSize));
+        pool->freeIndex = emptyData->nextFreeIndex;
+    }
+    else
+    {
+        ASSERT(pool->usedCount < pool->elementCount, "Not enough space in handle pool");
+        freeIndex = pool->usedCount++;
+        if (pool->dataAllocator)
+        {
+            pool->dataAllocator->Alloc(pool->dataAllocator->instance, pool->resourceSize);
+            pool->generationAllocator->Alloc(pool->generationAllocator->instance, 1);
+            pool->generations[freeIndex] = 0;
+        }
+    }
+
     Handle result;
     result.index = freeIndex;
     result.generation = pool->generations[freeIndex];
 
-    EmptyPoolData* emptyData = (EmptyPoolData*) (pool->data + (freeIndex * pool->resourceSize));
-    u32 newFreeIndex = emptyData->nextFreeIndex;
-    pool->freeIndex = newFreeIndex;
-
     return result;
 }
 
@@ -206,7 +243,7 @@ inline void* AccessDataFromHandlePool(HandlePool* pool, Handle handle)
     {
         u8 generationCount = pool->generations[handle.index];
         ASSERT(generationCount == handle.generation, "Accessing deleted data in HandePool");
-        return (pool->data + (handle.index * pool->resourceSize));
+        return (pool->data + ((u64) handle.index * pool->resourceSize));
     }
 
     return nullptr;
@@ -215,7 +252,7 @@ inline void* AccessDataFromHandlePool(HandlePool* pool, Handle handle)
 inline void ReleaseHandle(HandlePool* pool, Handle handle)
 {
     pool->generations[handle.index]++;
-    EmptyPoolData* emptyData = (EmptyPoolData*) (pool->data + (handle.index * pool->resourceSize));
+    EmptyPoolData* emptyData = (EmptyPoolData*) (pool->data + ((u64) handle.index * pool->resourceSize));
     emptyData->nextFreeIndex = pool->freeIndex;
     pool->freeIndex = handle.index;
 }
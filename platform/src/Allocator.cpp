@@ -9,7 +9,8 @@ void* LinearAlloc(LinearAllocator* inst, u64 size)
 {
     ASSERT((inst->startOffset + size) <= inst->reservedSize, "Requested size is bigger than reserved memory");
 
-    if ((inst->startOffset + size) > inst->commitedSize)
+    // Double the committed memory until the allocation fits
+    while ((inst->startOffset + size) > inst->commitedSize)
     {
         u64 commitSize = inst->commitedSize;
         if ((commitSize + inst->commitedSize) > inst->reservedSize)
@@ -110,12 +110,61 @@ struct TimeAPI
     u64 (*GetPerformanceCounterTimeNanoseconds)();
 };
 
+// Threading
+struct PlatformThread;
+struct PlatformSemaphore;
+
+typedef void (*ThreadFunction)(void* userData);
+
+struct ThreadAPI
+{
+    PlatformThread* (*CreatePlatformThread)(ILinearAllocator* allocator, ThreadFunction function, void* userData, const char* name);
+    // Waits until the thread function returns
+    void (*JoinPlatformThread)(PlatformThread* thread);
+    u32 (*GetProcessorCount)();
+    void (*YieldThread)();
+
+    PlatformSemaphore* (*CreatePlatformSemaphore)(ILinearAllocator* allocator, u32 initialCount, u32 maxCount);
+    void (*DestroyPlatformSemaphore)(PlatformSemaphore* semaphore);
+    void (*SignalSemaphore)(PlatformSemaphore* semaphore, u32 count);
+    void (*WaitSemaphore)(PlatformSemaphore* semaphore);
+};
+
+// Files
+struct PlatformFileInfo
+{
+    u64 size;
+    // Only meaningful for comparing with other write times of the same platform
+    u64 lastWriteTime;
+};
+
+struct PlatformMappedFile
+{
+    const u8* data;
+    u64 size;
+};
+
+// Path is the directory of the pattern followed by the file name
+typedef void (*FileFoundCallback)(const char* path, void* userData);
+
+struct FileAPI
+{
+    bool (*GetFileInfo)(const char* path, PlatformFileInfo* outInfo);
+    // Maps the whole file read only. Fails for empty files.
+    bool (*MapFile)(const char* path, PlatformMappedFile* outFile);
+    void (*UnmapFile)(PlatformMappedFile* file);
+    // Calls the callback for every file matching the pattern, * and ? wildcards only in the file name. Returns the match count.
+    u32 (*FindFiles)(const char* pattern, FileFoundCallback callback, void* userData);
+};
+
 struct PlatformAPI
 {
     VirtualMemoryAPI* virtualMemoryAPI;
     WindowAPI* windowAPI;
     InputAPI* inputAPI;
     TimeAPI* timeAPI;
+    ThreadAPI* threadAPI;
+    FileAPI* fileAPI;
 
     void (*LoadPlugin)(APIRegistry* registry, const char* moduleName);
 };
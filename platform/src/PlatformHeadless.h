@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ApiRegistry.h"
+#include "Allocator.h"
+#include "Platform.h"
+
+// Everything the platform provides except windowing and input. The platform
+// executable adds those on top, tools like the ECS benchmark run with this alone.
+struct HeadlessPlatform
+{
+    VirtualMemoryAPI virtualMemoryAPI;
+    TimeAPI timeAPI;
+    ThreadAPI threadAPI;
+    FileAPI fileAPI;
+    AllocatorAPI allocatorAPI;
+    PlatformAPI platformAPI;
+
+    APIRegistry registry;
+    ILinearAllocator* applicationAllocator;
+};
+
+// Sets up the APIs and registers PlatformAPI and AllocatorAPI. The platform must stay alive
+// while the registry is in use, the registered PlatformAPI points into it.
+void InitHeadlessPlatform(HeadlessPlatform* platform, const char* executableFilePath);
+
+void LoadPlugin(APIRegistry* registry, const char* moduleName);
+void HotLoadPlugins(APIRegistry* registry);
@@ -5,6 +5,7 @@
 #include "Allocator.h"
 #include "System.h"
 #include "Keycode.h"
+#include "PlatformHeadless.h"
 
 #include <Windows.h>
 #include <windowsx.h>
@@ -13,122 +14,10 @@
 #include <time.h>
 #include <stdio.h>
 
-struct WindowsPlatformData
+struct WindowsWindowData
 {
-    char executablePath[MAX_PATH];
     HINSTANCE hInstance;
-    u64 performanceFrequency;
-} gWindowsPlatformData;
-
-struct DLLInfo
-{
-    HMODULE moduleHandle;
-    char moduleName[100];
-    char dllPath[MAX_PATH];
-    char dllTempPath[MAX_PATH];
-    FILETIME lastWriteTime;
-};
-
-DLLInfo pluginDlls[100];
-u32 numPluginDlls = 0;
-
-typedef void (*PluginFunction)(APIRegistry* registry, bool reload);
-void LoadPlugin(APIRegistry* registry, const char* moduleName)
-{
-    TempAllocator tempAllocator = {};
-
-    char* dllPath = tempAllocator.Printf("%s/%s.dll", gWindowsPlatformData.executablePath, moduleName);
-    char* dllTempPath = tempAllocator.Printf("%s/%s_hotreload.dll", gWindowsPlatformData.executablePath, moduleName);
-
-    CopyFile(dllPath, dllTempPath, FALSE);
-    HMODULE module = LoadLibrary(dllTempPath);
-
-    WIN32_FILE_ATTRIBUTE_DATA data = {};
-    GetFileAttributesEx(dllPath, GetFileExInfoStandard, &data);
-
-    DLLInfo dllInfo = {};
-    dllInfo.moduleHandle = module;
-    memcpy(dllInfo.moduleName, moduleName, 100);
-    memcpy(dllInfo.dllPath, dllPath, MAX_PATH);
-    memcpy(dllInfo.dllTempPath, dllTempPath, MAX_PATH);
-    dllInfo.lastWriteTime = data.ftLastWriteTime;
-    pluginDlls[numPluginDlls++] = dllInfo;
-
-    PluginFunction Load = (PluginFunction) GetProcAddress(module, "LoadPlugin");
-
-    Load(registry, false);
-}
-
-void HotLoadPlugins(APIRegistry* registry)
-{
-    for (u32 i = 0; i < numPluginDlls; ++i)
-    {
-        DLLInfo* info = pluginDlls + i;
-
-        WIN32_FILE_ATTRIBUTE_DATA data = {};
-        BOOL attributeResult = GetFileAttributesEx(info->dllPath, GetFileExInfoStandard, &data);
-
-        FILETIME previousWriteTime = info->lastWriteTime;
-        FILETIME newWriteTime = data.ftLastWriteTime;
-
-        LONG result = CompareFileTime(&newWriteTime, &previousWriteTime);
-        if (result == 1 && attributeResult != 0)
-        {
-            FreeLibrary(info->moduleHandle);
-
-            const char* loadPath = info->dllTempPath;
-            CopyFile(info->dllPath, loadPath, FALSE);
-            HMODULE newModule = LoadLibrary(loadPath);
-
-            // Load new plugin
-            PluginFunction Load = (PluginFunction) GetProcAddress(newModule, "LoadPlugin");
-            Load(registry, true);
-
-            info->moduleHandle = newModule;
-            info->lastWriteTime = newWriteTime;
-        }
-    }
-}
-
-void* WindowsVirtualMemoryAlloc(void* baseAddress, u64 size, u32 flags)
-{
-    DWORD allocationType = 0;
-    if (flags & VA_COMMIT) {
-        allocationType |= MEM_COMMIT;
-    }
-    if (flags & VA_RESERVE) {
-        allocationType |= MEM_RESERVE;
-    }
-    if (flags & VA_LARGE_PAGES) {
-        allocationType |= MEM_LARGE_PAGES;
-    }
-
-    printf("VirtualAlloc baseAddress:%llu, size:%lu, flags:%d\n", baseAddress, size, flags);
-    void* ptr = VirtualAlloc((LPVOID) baseAddress, (SIZE_T) size, allocationType, PAGE_READWRITE);
-    if (!ptr)
-    {
-        printf("VirtualAllocError: %d\n", GetLastError());
-    }
-    return ptr;
-}
-
-void WindowsVirtualMemoryFree(void* baseAddress, u64 size, u32 flags)
-{
-    DWORD freeType = 0;
-    if (flags & VF_DECOMMIT) {
-        freeType |= MEM_DECOMMIT;
-    }
-    if (flags & VF_RELEASE) {
-        freeType |= MEM_RELEASE;
-    }
-
-    printf("VirtualFree baseAddress:%llu, size:%lu, flags:%d\n", baseAddress, size, flags);
-    BOOL result = VirtualFree((LPVOID) baseAddress, (SIZE_T) size, freeType);
-    if (!result)
-    {
-        printf("VirtualFreeError: %d\n", GetLastError());
-    }
-}
+} gWindowsWindowData;
 
 // Window API
 #define EVENT_BUFFER_COUNT 512
@@ -286,7 +175,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 PlatformWindow* WindowsCreateWindow(ILinearAllocator* allocator, const char* name, WindowSize size)
 {
-    HINSTANCE hInstance = gWindowsPlatformData.hInstance;
+    HINSTANCE hInstance = gWindowsWindowData.hInstance;
 
     const char* windowClassName = "WindowClass";
     WNDCLASS windowClass = {};
@@ -376,77 +265,20 @@ u32 WindowsPullEvents(PlatformWindow* window, ILinearAllocator* allocator, Input
     return eventCount;
 }
 
-// Date-time
-inline u64 ConvertSystemTimeToU64(const SYSTEMTIME* systemTime)
-{
-    FILETIME fileTime;
-    SystemTimeToFileTime(systemTime, &fileTime);
-    ULARGE_INTEGER largeInteger;
-    largeInteger.LowPart = fileTime.dwLowDateTime;
-    largeInteger.HighPart = fileTime.dwHighDateTime;
-
-    return (u64) largeInteger.QuadPart;
-}
-
-inline void ConvertU64ToSystemTime(u64 time, SYSTEMTIME* outSystemTime)
-{
-    ULARGE_INTEGER largeInteger;
-    largeInteger.QuadPart = time;
-
-    FILETIME fileTime;
-    fileTime.dwLowDateTime = largeInteger.LowPart;
-    fileTime.dwHighDateTime = largeInteger.HighPart;
-
-    FileTimeToSystemTime(&fileTime, outSystemTime);
-}
-
-PlatformTime WindowsGetLocalTime()
-{
-    SYSTEMTIME systemTime;
-    GetLocalTime(&systemTime);
-    u64 time = ConvertSystemTimeToU64(&systemTime);
-
-    return PlatformTime{ time };
-}
-
-i32 WindowsFormatTime(char* outBuffer, u32 outBufferSize, PlatformTime time, const char* format)
-{
-    SYSTEMTIME systemTime;
-    ConvertU64ToSystemTime(time.time, &systemTime);
-    return GetTimeFormat(LOCALE_NAME_USER_DEFAULT, TIME_FORCE24HOURFORMAT, &systemTime, format, outBuffer, outBufferSize) - 1;
-}
-
 InputState* WindowsGetInputState(PlatformWindow* window)
 {
     return window->inputState;
 }
 
-u64 WindowsPerformanceCounterNanoseconds()
-{
-    LARGE_INTEGER integer;
-    QueryPerformanceCounter(&integer);
-
-    integer.QuadPart *= 1000000000;
-    return (u64) integer.QuadPart / gWindowsPlatformData.performanceFrequency;
-}
 
 int main(int argc, char* argv[])
 {
     HINSTANCE hInstance = GetModuleHandle(0);
     SetProcessDPIAware();
-    gWindowsPlatformData.hInstance = hInstance;
-
-    LARGE_INTEGER frequency;
-    QueryPerformanceFrequency(&frequency);
-    gWindowsPlatformData.performanceFrequency = (u64) frequency.QuadPart;
+    gWindowsWindowData.hInstance = hInstance;
 
-    size_t len = strlen(argv[0]);
-    memcpy(gWindowsPlatformData.executablePath, argv[0], len + 1);
-    PathRemoveFilename(gWindowsPlatformData.executablePath, true);
-
-    VirtualMemoryAPI virtualMemoryAPI = {};
-    virtualMemoryAPI.Alloc = &WindowsVirtualMemoryAlloc;
-    virtualMemoryAPI.Free = &WindowsVirtualMemoryFree;
+    HeadlessPlatform platform;
+    InitHeadlessPlatform(&platform, argv[0]);
 
     WindowAPI windowAPI = {};
     windowAPI.CreatePlatformWindow = WindowsCreateWindow;
@@ -459,25 +291,12 @@ int main(int argc, char* argv[])
     inputAPI.PullEvents = WindowsPullEvents;
     inputAPI.GetState = WindowsGetInputState;
 
-    TimeAPI timeAPI = {};
-    timeAPI.FormatTime = WindowsFormatTime;
-    timeAPI.GetLocalTime = WindowsGetLocalTime;
-    timeAPI.GetPerformanceCounterTimeNanoseconds = WindowsPerformanceCounterNanoseconds;
-
-    AllocatorAPI allocatorAPI = CreateAllocatorAPI(&virtualMemoryAPI);
-    ILinearAllocator* applicationAllocator = allocatorAPI.CreateLinearAllocator(Megabyte(100), Megabyte(1));
+    APIRegistry registry = platform.registry;
+    ILinearAllocator* applicationAllocator = platform.applicationAllocator;
 
-    APIRegistry registry = CreateApiRegistry(&allocatorAPI, applicationAllocator);
-
-    PlatformAPI platformAPI = {};
-    platformAPI.virtualMemoryAPI = &virtualMemoryAPI;
-    platformAPI.windowAPI = &windowAPI;
-    platformAPI.inputAPI = &inputAPI;
-    platformAPI.LoadPlugin = &LoadPlugin;
-    platformAPI.timeAPI = &timeAPI;
-
-    registry.Set(PLATFORM_API_NAME, &platformAPI, sizeof(PlatformAPI));
-    registry.Set(ALLOCATOR_API_NAME, &allocatorAPI, sizeof(AllocatorAPI));
+    platform.platformAPI.windowAPI = &windowAPI;
+    platform.platformAPI.inputAPI = &inputAPI;
+    registry.Set(PLATFORM_API_NAME, &platform.platformAPI, sizeof(PlatformAPI));
 
     LoadPlugin(&registry, "Foundation");
     LoadPlugin(&registry, "System");
@@ -496,5 +315,3 @@ int main(int argc, char* argv[])
 
     return 0;
 }
-
-
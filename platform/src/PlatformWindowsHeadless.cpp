@@ -0,0 +1,390 @@
+#include "pch.h"
+
+#include "ApiRegistry.h"
+#include "Platform.h"
+#include "Allocator.h"
+#include "PlatformHeadless.h"
+
+#include <Windows.h>
+#include <datetimeapi.h>
+#include <stdio.h>
+
+struct WindowsPlatformData
+{
+    char executablePath[MAX_PATH];
+    u64 performanceFrequency;
+} gWindowsPlatformData;
+
+struct DLLInfo
+{
+    HMODULE moduleHandle;
+    char moduleName[100];
+    char dllPath[MAX_PATH];
+    char dllTempPath[MAX_PATH];
+    FILETIME lastWriteTime;
+};
+
+DLLInfo pluginDlls[100];
+u32 numPluginDlls = 0;
+
+typedef void (*PluginFunction)(APIRegistry* registry, bool reload);
+void LoadPlugin(APIRegistry* registry, const char* moduleName)
+{
+    TempAllocator tempAllocator = {};
+
+    char* dllPath = tempAllocator.Printf("%s/%s.dll", gWindowsPlatformData.executablePath, moduleName);
+    char* dllTempPath = tempAllocator.Printf("%s/%s_hotreload.dll", gWindowsPlatformData.executablePath, moduleName);
+
+    CopyFile(dllPath, dllTempPath, FALSE);
+    HMODULE module = LoadLibrary(dllTempPath);
+
+    WIN32_FILE_ATTRIBUTE_DATA data = {};
+    GetFileAttributesEx(dllPath, GetFileExInfoStandard, &data);
+
+    DLLInfo dllInfo = {};
+    dllInfo.moduleHandle = module;
+    memcpy(dllInfo.moduleName, moduleName, 100);
+    memcpy(dllInfo.dllPath, dllPath, MAX_PATH);
+    memcpy(dllInfo.dllTempPath, dllTempPath, MAX_PATH);
+    dllInfo.lastWriteTime = data.ftLastWriteTime;
+    pluginDlls[numPluginDlls++] = dllInfo;
+
+    PluginFunction Load = (PluginFunction) GetProcAddress(module, "LoadPlugin");
+
+    Load(registry, false);
+}
+
+void HotLoadPlugins(APIRegistry* registry)
+{
+    for (u32 i = 0; i < numPluginDlls; ++i)
+    {
+        DLLInfo* info = pluginDlls + i;
+
+        WIN32_FILE_ATTRIBUTE_DATA data = {};
+        BOOL attributeResult = GetFileAttributesEx(info->dllPath, GetFileExInfoStandard, &data);
+
+        FILETIME previousWriteTime = info->lastWriteTime;
+        FILETIME newWriteTime = data.ftLastWriteTime;
+
+        LONG result = CompareFileTime(&newWriteTime, &previousWriteTime);
+        if (result == 1 && attributeResult != 0)
+        {
+            FreeLibrary(info->moduleHandle);
+
+            const char* loadPath = info->dllTempPath;
+            CopyFile(info->dllPath, loadPath, FALSE);
+            HMODULE newModule = LoadLibrary(loadPath);
+
+            // Load new plugin
+            PluginFunction Load = (PluginFunction) GetProcAddress(newModule, "LoadPlugin");
+            Load(registry, true);
+
+            info->moduleHandle = newModule;
+            info->lastWriteTime = newWriteTime;
+        }
+    }
+}
+
+void* WindowsVirtualMemoryAlloc(void* baseAddress, u64 size, u32 flags)
+{
+    DWORD allocationType = 0;
+    if (flags & VA_COMMIT) {
+        allocationType |= MEM_COMMIT;
+    }
+    if (flags & VA_RESERVE) {
+        allocationType |= MEM_RESERVE;
+    }
+    if (flags & VA_LARGE_PAGES) {
+        allocationType |= MEM_LARGE_PAGES;
+    }
+
+    return VirtualAlloc((LPVOID) baseAddress, (SIZE_T) size, allocationType, PAGE_READWRITE);
+}
+
+void WindowsVirtualMemoryFree(void* baseAddress, u64 size, u32 flags)
+{
+    DWORD freeType = 0;
+    if (flags & VF_DECOMMIT) {
+        freeType |= MEM_DECOMMIT;
+    }
+    if (flags & VF_RELEASE) {
+        freeType |= MEM_RELEASE;
+    }
+
+    VirtualFree((LPVOID) baseAddress, (SIZE_T) size, freeType);
+}
+
+// Date-time
+inline u64 ConvertSystemTimeToU64(const SYSTEMTIME* systemTime)
+{
+    FILETIME fileTime;
+    SystemTimeToFileTime(systemTime, &fileTime);
+    ULARGE_INTEGER largeInteger;
+    largeInteger.LowPart = fileTime.dwLowDateTime;
+    largeInteger.HighPart = fileTime.dwHighDateTime;
+
+    return (u64) largeInteger.QuadPart;
+}
+
+inline void ConvertU64ToSystemTime(u64 time, SYSTEMTIME* outSystemTime)
+{
+    ULARGE_INTEGER largeInteger;
+    largeInteger.QuadPart = time;
+
+    FILETIME fileTime;
+    fileTime.dwLowDateTime = largeInteger.LowPart;
+    fileTime.dwHighDateTime = largeInteger.HighPart;
+
+    FileTimeToSystemTime(&fileTime, outSystemTime);
+}
+
+PlatformTime WindowsGetLocalTime()
+{
+    SYSTEMTIME systemTime;
+    GetLocalTime(&systemTime);
+    u64 time = ConvertSystemTimeToU64(&systemTime);
+
+    return PlatformTime{ time };
+}
+
+i32 WindowsFormatTime(char* outBuffer, u32 outBufferSize, PlatformTime time, const char* format)
+{
+    SYSTEMTIME systemTime;
+    ConvertU64ToSystemTime(time.time, &systemTime);
+    return GetTimeFormat(LOCALE_NAME_USER_DEFAULT, TIME_FORCE24HOURFORMAT, &systemTime, format, outBuffer, outBufferSize) - 1;
+}
+
+u64 WindowsPerformanceCounterNanoseconds()
+{
+    LARGE_INTEGER integer;
+    QueryPerformanceCounter(&integer);
+
+    integer.QuadPart *= 1000000000;
+    return (u64) integer.QuadPart / gWindowsPlatformData.performanceFrequency;
+}
+
+struct PlatformThread
+{
+    HANDLE handle;
+    ThreadFunction function;
+    void* userData;
+};
+
+struct PlatformSemaphore
+{
+    HANDLE handle;
+};
+
+static DWORD WINAPI WindowsThreadProc(LPVOID parameter)
+{
+    PlatformThread* thread = (PlatformThread*) parameter;
+    thread->function(thread->userData);
+    return 0;
+}
+
+PlatformThread* WindowsCreateThread(ILinearAllocator* allocator, ThreadFunction function, void* userData, const char* name)
+{
+    PlatformThread* thread = (PlatformThread*) allocator->Alloc(allocator->instance, sizeof(PlatformThread));
+    thread->function = function;
+    thread->userData = userData;
+    thread->handle = CreateThread(NULL, 0, WindowsThreadProc, thread, 0, NULL);
+    ASSERT(thread->handle, "Couldn't create thread");
+
+    // Shows up in the debugger and profilers
+    wchar_t threadName[64];
+    MultiByteToWideChar(CP_UTF8, 0, name, -1, threadName, 64);
+    SetThreadDescription(thread->handle, threadName);
+
+    return thread;
+}
+
+void WindowsJoinThread(PlatformThread* thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = NULL;
+}
+
+u32 WindowsGetProcessorCount()
+{
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return (u32) systemInfo.dwNumberOfProcessors;
+}
+
+void WindowsYieldThread()
+{
+    SwitchToThread();
+}
+
+PlatformSemaphore* WindowsCreateSemaphore(ILinearAllocator* allocator, u32 initialCount, u32 maxCount)
+{
+    PlatformSemaphore* semaphore = (PlatformSemaphore*) allocator->Alloc(allocator->instance, sizeof(PlatformSemaphore));
+    semaphore->handle = CreateSemaphoreA(NULL, (LONG) initialCount, (LONG) maxCount, NULL);
+    ASSERT(semaphore->handle, "Couldn't create semaphore");
+
+    return semaphore;
+}
+
+void WindowsDestroySemaphore(PlatformSemaphore* semaphore)
+{
+    CloseHandle(semaphore->handle);
+    semaphore->handle = NULL;
+}
+
+void WindowsSignalSemaphore(PlatformSemaphore* semaphore, u32 count)
+{
+    ReleaseSemaphore(semaphore->handle, (LONG) count, NULL);
+}
+
+void WindowsWaitSemaphore(PlatformSemaphore* semaphore)
+{
+    WaitForSingleObject(semaphore->handle, INFINITE);
+}
+
+bool WindowsGetFileInfo(const char* path, PlatformFileInfo* outInfo)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes))
+    {
+        return false;
+    }
+
+    outInfo->size = ((u64) attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    outInfo->lastWriteTime = ((u64) attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+bool WindowsMapFile(const char* path, PlatformMappedFile* outFile)
+{
+    *outFile = {};
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    // The view keeps the file and the mapping object alive
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+    {
+        return false;
+    }
+
+    outFile->data = (const u8*) data;
+    outFile->size = (u64) size.QuadPart;
+    return true;
+}
+
+void WindowsUnmapFile(PlatformMappedFile* file)
+{
+    if (file->data)
+    {
+        UnmapViewOfFile(file->data);
+    }
+    *file = {};
+}
+
+u32 WindowsFindFiles(const char* pattern, FileFoundCallback callback, void* userData)
+{
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA(pattern, &findData);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+
+    // Found names are without the directory
+    const char* nameStart = pattern;
+    for (const char* c = pattern; *c; ++c)
+    {
+        if (*c == '/' || *c == '\\')
+        {
+            nameStart = c + 1;
+        }
+    }
+    size_t directoryLength = nameStart - pattern;
+
+    char path[MAX_PATH];
+    u32 count = 0;
+    do
+    {
+        size_t nameLength = strlen(findData.cFileName);
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || directoryLength + nameLength >= MAX_PATH)
+        {
+            continue;
+        }
+
+        memcpy(path, pattern, directoryLength);
+        memcpy(path + directoryLength, findData.cFileName, nameLength + 1);
+        callback(path, userData);
+        count++;
+    } while (FindNextFileA(find, &findData));
+    FindClose(find);
+
+    return count;
+}
+
+void InitHeadlessPlatform(HeadlessPlatform* platform, const char* executableFilePath)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    gWindowsPlatformData.performanceFrequency = (u64) frequency.QuadPart;
+
+    size_t len = strlen(executableFilePath);
+    memcpy(gWindowsPlatformData.executablePath, executableFilePath, len + 1);
+    PathRemoveFilename(gWindowsPlatformData.executablePath, true);
+
+    platform->virtualMemoryAPI = {};
+    platform->virtualMemoryAPI.Alloc = &WindowsVirtualMemoryAlloc;
+    platform->virtualMemoryAPI.Free = &WindowsVirtualMemoryFree;
+
+    platform->timeAPI = {};
+    platform->timeAPI.FormatTime = WindowsFormatTime;
+    platform->timeAPI.GetLocalTime = WindowsGetLocalTime;
+    platform->timeAPI.GetPerformanceCounterTimeNanoseconds = WindowsPerformanceCounterNanoseconds;
+
+    platform->threadAPI = {};
+    platform->threadAPI.CreatePlatformThread = WindowsCreateThread;
+    platform->threadAPI.JoinPlatformThread = WindowsJoinThread;
+    platform->threadAPI.GetProcessorCount = WindowsGetProcessorCount;
+    platform->threadAPI.YieldThread = WindowsYieldThread;
+    platform->threadAPI.CreatePlatformSemaphore = WindowsCreateSemaphore;
+    platform->threadAPI.DestroyPlatformSemaphore = WindowsDestroySemaphore;
+    platform->threadAPI.SignalSemaphore = WindowsSignalSemaphore;
+    platform->threadAPI.WaitSemaphore = WindowsWaitSemaphore;
+
+    platform->fileAPI = {};
+    platform->fileAPI.GetFileInfo = WindowsGetFileInfo;
+    platform->fileAPI.MapFile = WindowsMapFile;
+    platform->fileAPI.UnmapFile = WindowsUnmapFile;
+    platform->fileAPI.FindFiles = WindowsFindFiles;
+
+    platform->allocatorAPI = CreateAllocatorAPI(&platform->virtualMemoryAPI);
+    platform->applicationAllocator = platform->allocatorAPI.CreateLinearAllocator(Megabyte(100), Megabyte(1));
+
+    platform->registry = CreateApiRegistry(&platform->allocatorAPI, platform->applicationAllocator);
+
+    platform->platformAPI = {};
+    platform->platformAPI.virtualMemoryAPI = &platform->virtualMemoryAPI;
+    platform->platformAPI.LoadPlugin = &LoadPlugin;
+    platform->platformAPI.timeAPI = &platform->timeAPI;
+    platform->platformAPI.threadAPI = &platform->threadAPI;
+    platform->platformAPI.fileAPI = &platform->fileAPI;
+
+    platform->registry.Set(PLATFORM_API_NAME, &platform->platformAPI, sizeof(PlatformAPI));
+    platform->registry.Set(ALLOCATOR_API_NAME, &platform->allocatorAPI, sizeof(AllocatorAPI));
+}
@@ -12,6 +12,34 @@ if _ACTION:startswith("vs") then
     end)
 end
 
+newoption
+{
+    trigger = "simd",
+    value = "ISA",
+    description = "Instruction set used by the math library",
+    default = "sse",
+    allowed =
+    {
+        { "scalar", "Plain C++ math" },
+        { "sse", "SSE (default)" },
+        { "avx", "AVX2 and FMA" },
+    }
+}
+
+newoption
+{
+    trigger = "ecs-components",
+    value = "COUNT",
+    description = "Maximum number of ECS component types",
+    default = "256",
+    allowed =
+    {
+        { "256", "256 (default)" },
+        { "512", "512" },
+        { "1024", "1024" },
+    }
+}
+
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
 solution "imge"
@@ -42,6 +70,15 @@ solution "imge"
     filter "system:windows"
         defines { "PLATFORM_WINDOWS" }
 
+    filter "options:simd=scalar"
+        defines { "MATH_SIMD_SCALAR" }
+
+    filter "options:simd=avx"
+        vectorextensions "AVX2"
+
+    filter {}
+        defines { "MAX_COMPONENT_TYPE_COUNT=" .. _OPTIONS["ecs-components"] }
+
 project "platform"
     kind "ConsoleApp"
     pchheader "pch.h"
@@ -169,6 +206,27 @@ project "ecs"
 
     dependson { "sharedpch" }
 
+project "ecs_benchmark"
+    kind "ConsoleApp"
+    pchheader "pch.h"
+
+    -- Runs on the headless part of the platform, ecs is loaded as a plugin like in the engine
+    files
+    {
+        "%{prj.name}/src/**.h",
+        "%{prj.name}/src/**.cpp",
+        "platform/src/PlatformWindowsHeadless.cpp",
+        "platform/src/Allocator.cpp",
+        "platform/src/ApiRegistry.cpp"
+    }
+
+    includedirs 
+    {
+        "**"
+    }
+
+    dependson { "sharedpch", "ecs" }
+
 project "asset_loading"
     kind "SharedLib"
     pchheader "pch.h"
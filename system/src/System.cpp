@@ -8,10 +8,15 @@
 #include "imgui_api.h"
 #include "Log.h"
 #include "Profiler.h"
+#include "Jobs.h"
 #include "ecs.h"
 #include "AssetLoading.h"
+#include "TransformSystem.h"
 #include "ShaderDefinitions.h"
 
+// Main thread time spent on creating entities of streamed assets per frame
+#define ASSET_LOADING_FRAME_BUDGET_NANOSECONDS 2000000
+
 #include <d3dcompiler.h>
 
 struct SystemState
@@ -50,6 +55,25 @@ struct BooComponent
     float x, y, z;
 } boo;
 
+// Mesh LODs are picked by their error projected to the screen
+#define MESH_LOD_MAX_SCREEN_ERROR_PIXELS 1.0f
+
+// Meshes loaded by the same scene batch bind the same buffers, they aren't bound again
+static bool HasSameGeometryBindings(const MeshComponentData* mesh, const MeshComponentData* boundMesh)
+{
+    for (u32 stream = 0; stream < VERTEX_BUFFER_COUNT; ++stream)
+    {
+        if (mesh->vertexBuffers[stream].handle != boundMesh->vertexBuffers[stream].handle || mesh->vertexStrides[stream] != boundMesh->vertexStrides[stream] ||
+            mesh->vertexOffsets[stream] != boundMesh->vertexOffsets[stream])
+        {
+            return false;
+        }
+    }
+
+    return mesh->indexBuffer.handle == boundMesh->indexBuffer.handle && mesh->indexBufferStride == boundMesh->indexBufferStride &&
+           mesh->indexBufferOffset == boundMesh->indexBufferOffset;
+}
+
 // Demo rendering with ECS
 // TODO: This is just for demo. I will be implementing a proper scene rendering system
 void RenderSystemUpdate(EntityContext* context, EntitySystemUpdateSet* updateData, void* userData)
@@ -95,109 +119,154 @@ void RenderSystemUpdate(EntityContext* context, EntitySystemUpdateSet* updateDat
         rhiAPI->UnmapBuffer(systemState->perViewGlobalConstantBuffer);
     }
 
+    Matrix4 projView = systemState->cameraProjection * systemState->cameraView;
+    Frustum frustum = ExtractFrustumPlanes(projView);
+    // World space size at unit distance to pixels
+    f32 lodProjectionScale = systemState->cameraProjection[1][1] * systemState->viewport.height * 0.5f;
+    AssetAPI* assetAPI = (AssetAPI*) gAPIRegistry->Get(ASSET_API_NAME);
+    const Meshlet* meshletTable = assetAPI->GetMeshlets();
+    const MeshComponentData* boundMesh = nullptr;
+
     for (u32 arrayIndex = 0; arrayIndex < updateData->numArrays; ++arrayIndex)
     {
         EntitySystemUpdateArray* updateArray = updateData->arrays + arrayIndex;
-        for (u32 index = 0; index < updateArray->length; ++index)
-        {
-
-            MeshComponentData* mesh = (MeshComponentData*) updateArray->componentData[0];
-            MaterialComponentData* material = (MaterialComponentData*) updateArray->componentData[1];
-            TransformComponentData* transform = (TransformComponentData*) updateArray->componentData[2];
 
-            Matrix4 translateMatrix = TranslateMatrix(transform->translation);
-            Matrix4 scaleMatrix = ScaleMatrix(transform->scale);
-            Matrix4 rotationMatrix;
-            float w, x, y, z,
-            xx, yy, zz,
-            xy, yz, xz,
-            wx, wy, wz, norm, s;
-
-            norm = sqrtf(DotProduct(transform->orientation, transform->orientation));
-            s = norm > 0.0f ? 2.0f / norm : 0.0f;
-
-            x = transform->orientation[0];
-            y = transform->orientation[1];
-            z = transform->orientation[2];
-            w = transform->orientation[3];
-
-            xx = s * x * x;   xy = s * x * y;   wx = s * w * x;
-            yy = s * y * y;   yz = s * y * z;   wy = s * w * y;
-            zz = s * z * z;   xz = s * x * z;   wz = s * w * z;
+        BoundsComponentData* bounds = (BoundsComponentData*) updateArray->componentData[3];
+        u32* visibleIndices = (u32*) systemState->frameAllocator->Alloc(systemState->frameAllocator->instance, updateArray->length * sizeof(u32));
+        u32 visibleCount = CullAABBs(frustum, &bounds->worldBounds, sizeof(BoundsComponentData), updateArray->length, visibleIndices);
+        if (visibleCount == 0)
+        {
+            continue;
+        }
 
-            rotationMatrix[0][0] = 1.0f - yy - zz;
-            rotationMatrix[1][1] = 1.0f - xx - zz;
-            rotationMatrix[2][2] = 1.0f - xx - yy;
+        // Material is shared, every entity of the array has the same one. Bind it once.
+        MaterialComponentData* material = (MaterialComponentData*) updateArray->componentData[1];
+        {
+            DrawMaterial drawMaterial = {};
+            drawMaterial.diffuseColor = material->baseColor;
+            drawMaterial.emissiveColor = material->emissiveColor;
+            drawMaterial.metallic = material->metallic;
+            drawMaterial.roughness = material->roughness;
+            drawMaterial.hasAlbedoTexture = material->baseColorTexture.handle != INVALID_HANDLE;
+            drawMaterial.hasMetallicTexture = material->metallicTexture.handle != INVALID_HANDLE;
+            drawMaterial.hasRoughnessTexture = material->roughnessTexture.handle != INVALID_HANDLE;
+            drawMaterial.hasMetallicRoughnessTexture = material->roughnessMetallicTexture.handle != INVALID_HANDLE;
+            drawMaterial.hasAOTexture = material->occlusionTexture.handle != INVALID_HANDLE;
+            drawMaterial.hasEmissiveTexture = material->emissiveTexture.handle != INVALID_HANDLE;
+
+            PerMaterialGlobalConstantBuffer perMaterialData = {};
+            perMaterialData.g_Material = drawMaterial;
+            void* perMaterialPointer = rhiAPI->MapBuffer(systemState->perMaterialGlobalConstantBuffer);
+            memcpy(perMaterialPointer, &perMaterialData, sizeof(PerMaterialGlobalConstantBuffer));
+            rhiAPI->UnmapBuffer(systemState->perMaterialGlobalConstantBuffer);
 
-            rotationMatrix[0][1] = xy + wz;
-            rotationMatrix[1][2] = yz + wx;
-            rotationMatrix[2][0] = xz + wy;
+            GPUShaderResourceView resourceViews[16] = {};
+            resourceViews[ALBEDO_TEXTURE2D_SLOT] = material->baseColorTexture;
+            resourceViews[ROUGHNESS_TEXTURE2D_SLOT] = material->roughnessTexture;
+            resourceViews[METALLIC_TEXTURE2D_SLOT] = material->metallicTexture;
+            resourceViews[AO_TEXTURE2D_SLOT] = material->occlusionTexture;
+            resourceViews[METALLIC_ROUGHNESS_TEXTURE2D_SLOT] = material->roughnessMetallicTexture;
+            resourceViews[NORMAL_TEXTURE2D_SLOT] = material->normalMapTexture;
+            resourceViews[EMISSIVE_TEXTURE2D_SLOT] = material->emissiveTexture;
 
-            rotationMatrix[1][0] = xy - wz;
-            rotationMatrix[2][1] = yz - wx;
-            rotationMatrix[0][2] = xz - wy;
+            rhiAPI->SetShaderResourcesPS(0, resourceViews, 16);
+        }
 
-            rotationMatrix[0][3] = 0.0f;
-            rotationMatrix[1][3] = 0.0f;
-            rotationMatrix[2][3] = 0.0f;
-            rotationMatrix[3][0] = 0.0f;
-            rotationMatrix[3][1] = 0.0f;
-            rotationMatrix[3][2] = 0.0f;
-            rotationMatrix[3][3] = 1.0f;
+        for (u32 visibleIndex = 0; visibleIndex < visibleCount; ++visibleIndex)
+        {
+            u32 index = visibleIndices[visibleIndex];
 
-            Matrix4 transformMatrix =  translateMatrix * rotationMatrix * scaleMatrix;
+            MeshComponentData* mesh = (MeshComponentData*) updateArray->componentData[0] + index;
+            WorldMatrixComponentData* worldMatrix = (WorldMatrixComponentData*) updateArray->componentData[2] + index;
 
             {
                 PerDrawGlobalConstantBuffer perDrawData = {};
-                perDrawData.g_ModelMatrix = transformMatrix;
+                perDrawData.g_ModelMatrix = worldMatrix->worldMatrix;
+                perDrawData.g_PositionScale = Vector4(mesh->positionScale, 0.0f);
+                perDrawData.g_PositionOffset = Vector4(mesh->positionOffset, 0.0f);
                 void* perDrawPointer = rhiAPI->MapBuffer(systemState->perDrawGlobalConstantBuffer);
                 memcpy(perDrawPointer, &perDrawData, sizeof(PerDrawGlobalConstantBuffer));
                 rhiAPI->UnmapBuffer(systemState->perDrawGlobalConstantBuffer);
             }
 
+            u32 indexStart = mesh->indexStart;
+            u32 indexCount = mesh->indexCount;
+            if (mesh->lodCount)
             {
-                DrawMaterial drawMaterial = {};
-                drawMaterial.diffuseColor = material->baseColor;
-                drawMaterial.emissiveColor = material->emissiveColor;
-                drawMaterial.metallic = material->metallic;
-                drawMaterial.roughness = material->roughness;
-                drawMaterial.hasAlbedoTexture = material->baseColorTexture.handle != INVALID_HANDLE;
-                drawMaterial.hasMetallicTexture = material->metallicTexture.handle != INVALID_HANDLE;
-                drawMaterial.hasRoughnessTexture = material->roughnessTexture.handle != INVALID_HANDLE;
-                drawMaterial.hasMetallicRoughnessTexture = material->roughnessMetallicTexture.handle != INVALID_HANDLE;
-                drawMaterial.hasAOTexture = material->occlusionTexture.handle != INVALID_HANDLE;
-                drawMaterial.hasEmissiveTexture = material->emissiveTexture.handle != INVALID_HANDLE;
-
-                PerMaterialGlobalConstantBuffer perMaterialData = {};
-                perMaterialData.g_Material = drawMaterial;
-                void* perMaterialPointer = rhiAPI->MapBuffer(systemState->perMaterialGlobalConstantBuffer);
-                memcpy(perMaterialPointer, &perMaterialData, sizeof(PerMaterialGlobalConstantBuffer));
-                rhiAPI->UnmapBuffer(systemState->perMaterialGlobalConstantBuffer);
+                // Distance to the bounding sphere of the world bounds, errors are scaled by the largest axis scale
+                AABB worldBounds = bounds[index].worldBounds;
+                f32 distance = Lenght(worldBounds.center - systemState->cameraPos) - Lenght(worldBounds.extents);
+                Matrix3x4& matrix = worldMatrix->worldMatrix;
+                f32 scaleX = Lenght(Vector3(matrix[0][0], matrix[1][0], matrix[2][0]));
+                f32 scaleY = Lenght(Vector3(matrix[0][1], matrix[1][1], matrix[2][1]));
+                f32 scaleZ = Lenght(Vector3(matrix[0][2], matrix[1][2], matrix[2][2]));
+                f32 errorScale = fmaxf(scaleX, fmaxf(scaleY, scaleZ)) * lodProjectionScale;
+                for (u32 lod = 0; lod < mesh->lodCount && distance > 0.0f; ++lod)
+                {
+                    if (mesh->lods[lod].error * errorScale > MESH_LOD_MAX_SCREEN_ERROR_PIXELS * distance)
+                    {
+                        break;
+                    }
+                    indexStart = mesh->lods[lod].indexStart;
+                    indexCount = mesh->lods[lod].indexCount;
+                }
             }
 
-            rhiAPI->SetVertexBuffers(mesh->vertexBuffers, 0, VERTEX_BUFFER_COUNT, mesh->vertexStrides, mesh->vertexOffsets);
-            rhiAPI->SetIndexBuffer(mesh->indexBuffer, mesh->indexBufferStride, mesh->indexBufferOffset);
+            if (!boundMesh || !HasSameGeometryBindings(mesh, boundMesh))
+            {
+                rhiAPI->SetVertexBuffers(mesh->vertexBuffers, 0, VERTEX_BUFFER_COUNT, mesh->vertexStrides, mesh->vertexOffsets);
+                rhiAPI->SetIndexBuffer(mesh->indexBuffer, mesh->indexBufferStride, mesh->indexBufferOffset);
+                boundMesh = mesh;
+            }
+            if (indexStart != mesh->indexStart || mesh->meshletCount == 0)
+            {
+                rhiAPI->DrawIndexed(indexCount, indexStart, mesh->baseVertex);
+                continue;
+            }
 
-            GPUShaderResourceView resourceViews[16] = {};
-            resourceViews[ALBEDO_TEXTURE2D_SLOT] = material->baseColorTexture;
-            resourceViews[ROUGHNESS_TEXTURE2D_SLOT] = material->roughnessTexture;
-            resourceViews[METALLIC_TEXTURE2D_SLOT] = material->metallicTexture;
-            resourceViews[AO_TEXTURE2D_SLOT] = material->occlusionTexture;
-            resourceViews[METALLIC_ROUGHNESS_TEXTURE2D_SLOT] = material->roughnessMetallicTexture;
-            resourceViews[NORMAL_TEXTURE2D_SLOT] = material->normalMapTexture;
-            resourceViews[EMISSIVE_TEXTURE2D_SLOT] = material->emissiveTexture;
+            // Meshlets of the full mesh are culled in object space, with the frustum planes transformed and the camera moved into it.
+            // Facing doesn't change with the transform, but mirroring flips the winding, so cones of mirrored meshes aren't tested.
+            Matrix3x4& matrix = worldMatrix->worldMatrix;
+            Frustum objectFrustum = ExtractFrustumPlanes(projView * matrix);
+            Vector3 objectCameraPos = Inverse(matrix) * Vector4(systemState->cameraPos, 1.0f);
+            Vector3 column0 = Vector3(matrix[0][0], matrix[1][0], matrix[2][0]);
+            Vector3 column1 = Vector3(matrix[0][1], matrix[1][1], matrix[2][1]);
+            Vector3 column2 = Vector3(matrix[0][2], matrix[1][2], matrix[2][2]);
+            bool cullBackFacing = DotProduct(CrossProduct(column0, column1), column2) > 0.0f;
+
+            // Consecutive visible meshlets are drawn together
+            const Meshlet* meshlets = meshletTable + mesh->firstMeshlet;
+            u32 drawStart = 0;
+            u32 drawCount = 0;
+            for (u32 meshletIndex = 0; meshletIndex < mesh->meshletCount; ++meshletIndex)
+            {
+                const Meshlet& meshlet = meshlets[meshletIndex];
+                if (!IsSphereInFrustum(objectFrustum, meshlet.bounds) ||
+                    (cullBackFacing && IsConeBackFacing(meshlet.bounds, meshlet.coneAxis, meshlet.coneCutoff, objectCameraPos)))
+                {
+                    continue;
+                }
 
-            rhiAPI->SetShaderResourcesPS(0, resourceViews, 16);
-            rhiAPI->DrawIndexed(mesh->indexCount, mesh->indexStart, 0);
+                if (drawCount > 0 && drawStart + drawCount == meshlet.indexStart)
+                {
+                    drawCount += meshlet.indexCount;
+                    continue;
+                }
+                if (drawCount > 0)
+                {
+                    rhiAPI->DrawIndexed(drawCount, drawStart, mesh->baseVertex);
+                }
+                drawStart = meshlet.indexStart;
+                drawCount = meshlet.indexCount;
+            }
+            if (drawCount > 0)
+            {
+                rhiAPI->DrawIndexed(drawCount, drawStart, mesh->baseVertex);
+            }
         }
     }
 }
 
-bool RenderSystemFilter(EntityContext* context, Component* components, u32 numComponents, EntitySignature signature)
-{
-    return HasEntitySignatureComponent(&signature, components[0]) && HasEntitySignatureComponent(&signature, components[1]);
-}
-
 void SystemInitialize(ILinearAllocator* applicationAllocator)
 {
 
@@ -211,6 +280,9 @@ void SystemInitialize(ILinearAllocator* applicationAllocator)
 
     gProfilerAPI->Init(allocatorAPI, applicationAllocator);
 
+    JobAPI* jobAPI = (JobAPI*) gAPIRegistry->Get(JOB_API_NAME);
+    jobAPI->Init(allocatorAPI, applicationAllocator, 0);
+
     // Update registry
     SystemAPI* api = (SystemAPI*) gAPIRegistry->Get(SYSTEM_API_NAME);
     api->state = (void*) gState;
@@ -233,7 +305,8 @@ void SystemInitialize(ILinearAllocator* applicationAllocator)
 
     platformAPI->LoadPlugin(gAPIRegistry, "asset_loading");
     AssetAPI* assetAPI = (AssetAPI*) gAPIRegistry->Get(ASSET_API_NAME);
-    assetAPI->LoadAsset(context, "DamagedHelmet/DamagedHelmet.gltf");
+    assetAPI->Init(allocatorAPI, applicationAllocator);
+    assetAPI->RequestAsset(context, "DamagedHelmet/DamagedHelmet.gltf", ASSET_REQUEST_PRIORITY_HIGH, nullptr, nullptr);
 
     FooComponent foo = { 31, 13};
     Component fooComponent = entityAPI->RegisterComponent(context, "FooComponent", sizeof(FooComponent));
@@ -254,18 +327,29 @@ void SystemInitialize(ILinearAllocator* applicationAllocator)
 
 
     Component meshComponent = entityAPI->RegisterComponent(context, MESH_COMPONENT_NAME, sizeof(MeshComponentData));
-    Component materialComponent = entityAPI->RegisterComponent(context, MATERIAL_COMPONENT_NAME, sizeof(MaterialComponentData));
-    Component transformComponent = entityAPI->RegisterComponent(context, TRANSFORM_COMPONENT_NAME, sizeof(TransformComponentData));
+    Component materialComponent = entityAPI->RegisterSharedComponent(context, MATERIAL_COMPONENT_NAME, sizeof(MaterialComponentData));
+    Component worldMatrixComponent = entityAPI->RegisterComponent(context, WORLD_MATRIX_COMPONENT_NAME, sizeof(WorldMatrixComponentData));
+
+    Component boundsComponent = entityAPI->RegisterComponent(context, BOUNDS_COMPONENT_NAME, sizeof(BoundsComponentData));
 
-    // TODO: We create this system struct with Update and Filter function pointers. BUT these functions will be invalidated when we do a hotreload.
+    IEntitySystem transformSystem = CreateTransformSystem(entityAPI, context);
+    entityAPI->PushSystem(context, &transformSystem);
+
+    IEntitySystem hierarchySystem = CreateHierarchySystem(entityAPI, context, gAPIRegistry, applicationAllocator, gState->frameAllocator);
+    entityAPI->PushSystem(context, &hierarchySystem);
+
+    IEntitySystem boundsSystem = CreateBoundsSystem(entityAPI, context);
+    entityAPI->PushSystem(context, &boundsSystem);
+
+    // TODO: We create this system struct with an Update function pointer. BUT these functions will be invalidated when we do a hotreload.
     // And this struct will be still pointing old Update function pointers.
     // Maybe use APIRegistry for this as well? When we do a hotreload update these functions?
     IEntitySystem demoSystem = {};
     demoSystem.components[0] = meshComponent;
     demoSystem.components[1] = materialComponent;
-    demoSystem.components[2] = transformComponent;
-    demoSystem.numComponent = 3;
-    demoSystem.Filter = RenderSystemFilter;
+    demoSystem.components[2] = worldMatrixComponent;
+    demoSystem.components[3] = boundsComponent;
+    demoSystem.numComponent = 4;
     demoSystem.Update = RenderSystemUpdate;
     demoSystem.userData = (void*) gState;
 
@@ -281,9 +365,14 @@ void SystemInitialize(ILinearAllocator* applicationAllocator)
 
     // Demo rendering initialization
     // TODO: Implement proper shader API and shader system.
+#if ASSET_QUANTIZE_VERTICES
+    D3D_SHADER_MACRO shaderDefines[] = { { "QUANTIZED_VERTICES", "1" }, { NULL, NULL } };
+#else
+    D3D_SHADER_MACRO* shaderDefines = NULL;
+#endif
     ID3DBlob* shaderBlob = nullptr;
     ID3DBlob* errorBlob = nullptr;
-    D3DCompileFromFile(L"Shaders/PBRForward.hlsl", NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, "VSMain", "vs_5_0", D3DCOMPILE_DEBUG, 0, &shaderBlob, &errorBlob);
+    D3DCompileFromFile(L"Shaders/PBRForward.hlsl", shaderDefines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "VSMain", "vs_5_0", D3DCOMPILE_DEBUG, 0, &shaderBlob, &errorBlob);
     if (errorBlob)
     {
         printf("Shader compilation errors: %s\n", (char*)errorBlob->GetBufferPointer());
@@ -297,7 +386,7 @@ void SystemInitialize(ILinearAllocator* applicationAllocator)
 
     ID3DBlob* pixelShaderBlob = nullptr;
     ID3DBlob* pixelErrorBlob = nullptr;
-    D3DCompileFromFile(L"Shaders/PBRForward.hlsl", NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, "PSMain", "ps_5_0", D3DCOMPILE_DEBUG, 0, &pixelShaderBlob, &pixelErrorBlob);
+    D3DCompileFromFile(L"Shaders/PBRForward.hlsl", shaderDefines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "PSMain", "ps_5_0", D3DCOMPILE_DEBUG, 0, &pixelShaderBlob, &pixelErrorBlob);
     if (pixelErrorBlob)
     {
         printf("Shader compilation errors: %s\n", (char*)pixelErrorBlob->GetBufferPointer());
@@ -310,21 +399,21 @@ void SystemInitialize(ILinearAllocator* applicationAllocator)
     pixelByteCode.bytecodeLength = pixelShaderBlob->GetBufferSize();
 
     GPUVertexInputElement inputElement = {};
-    inputElement.format = FORMAT_R32G32B32_FLOAT;
+    inputElement.format = ASSET_VERTEX_POSITION_FORMAT;
     inputElement.classification = GPUInputClassification::PER_VERTEX_DATA;
     inputElement.inputSlot = 0;
     inputElement.semanticIndex = 0;
     inputElement.semanticName = "POSITION";
 
     GPUVertexInputElement inputElementNormal = {};
-    inputElementNormal.format = FORMAT_R32G32B32_FLOAT;
+    inputElementNormal.format = ASSET_VERTEX_NORMAL_FORMAT;
     inputElementNormal.classification = GPUInputClassification::PER_VERTEX_DATA;
     inputElementNormal.inputSlot = 1;
     inputElementNormal.semanticIndex = 0;
     inputElementNormal.semanticName = "NORMAL";
 
     GPUVertexInputElement inputElementTexCoord = {};
-    inputElementTexCoord.format = FORMAT_R32G32_FLOAT;
+    inputElementTexCoord.format = ASSET_VERTEX_TEXCOORD_FORMAT;
     inputElementTexCoord.classification = GPUInputClassification::PER_VERTEX_DATA;
     inputElementTexCoord.inputSlot = 2;
     inputElementTexCoord.semanticIndex = 0;
@@ -519,6 +608,7 @@ bool SystemTick()
     ImguiAPI* imguiAPI = (ImguiAPI*) gAPIRegistry->Get(IMGUI_API_NAME);
     LogAPI* logAPI = (LogAPI*) gAPIRegistry->Get(LOG_API_NAME);
     EntityAPI* entityAPI = (EntityAPI*) gAPIRegistry->Get(ENTITY_API_NAME);
+    AssetAPI* assetAPI = (AssetAPI*) gAPIRegistry->Get(ASSET_API_NAME);
     WindowAPI* windowAPI = platformAPI->windowAPI;
     InputAPI* inputAPI = platformAPI->inputAPI;
 
@@ -528,6 +618,8 @@ bool SystemTick()
         return false;
     }
 
+    assetAPI->ProcessCompletedRequests(ASSET_LOADING_FRAME_BUDGET_NANOSECONDS);
+
     InputEvent* events = nullptr;
     u32 eventCount = inputAPI->PullEvents(gState->mainWindow, gState->frameAllocator, &events);
     {
@@ -624,7 +716,12 @@ bool SystemTick()
 
 void SystemQuitting()
 {
-
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) gAPIRegistry->Get(ALLOCATOR_API_NAME);
+    JobAPI* jobAPI = (JobAPI*) gAPIRegistry->Get(JOB_API_NAME);
+    AssetAPI* assetAPI = (AssetAPI*) gAPIRegistry->Get(ASSET_API_NAME);
+    // Cook jobs of the asset loader run on the job workers
+    assetAPI->Shutdown();
+    jobAPI->Shutdown(allocatorAPI);
 }
 
 extern "C"
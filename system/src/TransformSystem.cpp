@@ -0,0 +1,431 @@
+#include "pch.h"
+#include "TransformSystem.h"
+#include "ecs.h"
+#include "AssetLoading.h"
+#include "Allocator.h"
+#include "ApiRegistry.h"
+#include "Jobs.h"
+
+static void TransformSystemUpdate(EntityContext* context, EntitySystemUpdateSet* updateData, void* userData)
+{
+    for (u32 arrayIndex = 0; arrayIndex < updateData->numArrays; ++arrayIndex)
+    {
+        EntitySystemUpdateArray* updateArray = updateData->arrays + arrayIndex;
+        const TransformComponentData* transforms = (const TransformComponentData*) updateArray->componentData[0];
+        WorldMatrixComponentData* worldMatrices = (WorldMatrixComponentData*) updateArray->componentData[1];
+
+        ComposeTransformMatrices(&transforms->translation, sizeof(TransformComponentData),
+                                 &transforms->orientation, sizeof(TransformComponentData),
+                                 &transforms->scale, sizeof(TransformComponentData),
+                                 &worldMatrices->worldMatrix, updateArray->length);
+    }
+}
+
+IEntitySystem CreateTransformSystem(EntityAPI* entityAPI, EntityContext* context)
+{
+    Component transformComponent = entityAPI->RegisterComponent(context, TRANSFORM_COMPONENT_NAME, sizeof(TransformComponentData));
+    Component worldMatrixComponent = entityAPI->RegisterComponent(context, WORLD_MATRIX_COMPONENT_NAME, sizeof(WorldMatrixComponentData));
+    Component parentComponent = entityAPI->RegisterComponent(context, PARENT_COMPONENT_NAME, sizeof(ParentComponentData));
+
+    IEntitySystem transformSystem = {};
+    transformSystem.components[0] = transformComponent;
+    transformSystem.components[1] = worldMatrixComponent;
+    transformSystem.numComponent = 2;
+    // Child entities are updated by the hierarchy system
+    transformSystem.excludedComponents[0] = parentComponent;
+    transformSystem.numExcludedComponent = 1;
+    transformSystem.changedFilterMask = BIT(0);
+    transformSystem.writeMask = BIT(1);
+    transformSystem.Update = TransformSystemUpdate;
+    transformSystem.userData = nullptr;
+
+    return transformSystem;
+}
+
+// Hierarchy nodes are every entity with a parent. They are sorted by their subtree root and then by depth,
+// so a parent is always updated before its children and a subtree is a contiguous range.
+// Roots don't have a parent, the transform system computes their world matrices.
+// Nodes whose parent is destroyed or isn't a node itself are detached, they are updated under an invalid root.
+struct HierarchyNode
+{
+    Entity entity;
+    Entity parent;
+    Entity root;
+    u32 parentNodeIndex; // NULL_INDEX when the parent is the root or the node is detached
+    u32 depth;
+    u32 arrayIndex; // Update array of the node's archetype
+    // Rows of the node in its archetype, valid until the parent column changes
+    TransformComponentData* transform;
+    WorldMatrixComponentData* worldMatrix;
+};
+
+struct HierarchySubtree
+{
+    Entity root;
+    u32 firstNode;
+    u32 nodeCount;
+};
+
+// Subtrees are batched into jobs until they have this many nodes
+#define HIERARCHY_NODES_PER_JOB 256
+// Large hierarchies get bigger jobs, so there are at most this many jobs per worker
+#define HIERARCHY_JOBS_PER_WORKER 4
+
+struct HierarchySystemState
+{
+    EntityAPI* entityAPI;
+    JobAPI* jobAPI;
+    ILinearAllocator* frameAllocator;
+    Component transformComponent;
+    Component worldMatrixComponent;
+    Component parentComponent;
+
+    DynamicArray<HierarchyNode> nodes;
+    DynamicArray<HierarchySubtree> subtrees;
+    DynamicArray<u8> nodeDirtyFlags;
+
+    // Entity handle index to node index, used while building
+    DynamicArray<u32> nodeLookup;
+    bool forceUpdate;
+};
+
+struct HierarchyJobData
+{
+    HierarchySystemState* state;
+    EntityContext* context;
+    u32 firstSubtree;
+    u32 subtreeCount;
+    bool forceUpdate;
+};
+
+static inline u32 HandleKey(Handle handle)
+{
+    return handle.index | (handle.generation << 24);
+}
+
+static int CompareHierarchyNodes(const void* a, const void* b)
+{
+    const HierarchyNode* left = (const HierarchyNode*) a;
+    const HierarchyNode* right = (const HierarchyNode*) b;
+    u32 leftRoot = HandleKey(left->root.handle);
+    u32 rightRoot = HandleKey(right->root.handle);
+    if (leftRoot != rightRoot)
+    {
+        return leftRoot < rightRoot ? -1 : 1;
+    }
+    if (left->depth != right->depth)
+    {
+        return left->depth < right->depth ? -1 : 1;
+    }
+
+    return 0;
+}
+
+static void BuildHierarchy(HierarchySystemState* state, EntityContext* context, EntitySystemUpdateSet* updateData)
+{
+    EntityAPI* entityAPI = state->entityAPI;
+
+    // Entities that were nodes in the last build may not be nodes anymore
+    for (u32 nodeIndex = 0; nodeIndex < state->nodes.length; ++nodeIndex)
+    {
+        state->nodeLookup[state->nodes[nodeIndex].entity.handle.index] = NULL_INDEX;
+    }
+    state->nodes.Clear();
+    state->subtrees.Clear();
+    state->nodeDirtyFlags.Clear();
+
+    for (u32 arrayIndex = 0; arrayIndex < updateData->numArrays; ++arrayIndex)
+    {
+        EntitySystemUpdateArray* updateArray = updateData->arrays + arrayIndex;
+        const ParentComponentData* parents = (const ParentComponentData*) updateArray->componentData[0];
+        TransformComponentData* transforms = (TransformComponentData*) updateArray->componentData[1];
+        WorldMatrixComponentData* worldMatrices = (WorldMatrixComponentData*) updateArray->componentData[2];
+        for (u32 index = 0; index < updateArray->length; ++index)
+        {
+            HierarchyNode node = {};
+            node.entity = updateArray->entities[index];
+            node.parent = parents[index].parent;
+            node.parentNodeIndex = NULL_INDEX;
+            node.depth = 1;
+            node.arrayIndex = arrayIndex;
+            node.transform = transforms + index;
+            node.worldMatrix = worldMatrices + index;
+
+            // Walk up until we find an entity without a parent. Parents with a parent of their own have to be nodes.
+            Entity root = node.parent;
+            while (true)
+            {
+                if (!entityAPI->IsEntityAlive(context, root))
+                {
+                    root = Entity { INVALID_HANDLE };
+                    break;
+                }
+
+                ParentComponentData* parent = (ParentComponentData*) entityAPI->GetComponentData(context, root, state->parentComponent);
+                if (!parent)
+                {
+                    break;
+                }
+
+                if (!entityAPI->GetComponentData(context, root, state->transformComponent) ||
+                    !entityAPI->GetComponentData(context, root, state->worldMatrixComponent))
+                {
+                    root = Entity { INVALID_HANDLE };
+                    break;
+                }
+
+                root = parent->parent;
+                node.depth++;
+            }
+            node.root = root;
+
+            state->nodes.Append(node);
+            state->nodeDirtyFlags.Append(0);
+        }
+    }
+
+    u32 nodeCount = state->nodes.length;
+    qsort(state->nodes.data, nodeCount, sizeof(HierarchyNode), CompareHierarchyNodes);
+
+    for (u32 nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex)
+    {
+        u32 handleIndex = state->nodes[nodeIndex].entity.handle.index;
+        while (state->nodeLookup.length <= handleIndex)
+        {
+            state->nodeLookup.Append(NULL_INDEX);
+        }
+        state->nodeLookup[handleIndex] = nodeIndex;
+    }
+
+    for (u32 nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex)
+    {
+        HierarchyNode* node = &state->nodes[nodeIndex];
+        // Only parents deeper than the root passed the node checks above
+        if (node->depth > 1)
+        {
+            node->parentNodeIndex = state->nodeLookup[node->parent.handle.index];
+        }
+
+        if (state->subtrees.length == 0 || state->subtrees[state->subtrees.length - 1].root.handle != node->root.handle)
+        {
+            HierarchySubtree subtree = {};
+            subtree.root = node->root;
+            subtree.firstNode = nodeIndex;
+            subtree.nodeCount = 0;
+            state->subtrees.Append(subtree);
+        }
+        state->subtrees[state->subtrees.length - 1].nodeCount++;
+    }
+}
+
+static void UpdateHierarchySubtrees(void* userData)
+{
+    HierarchyJobData* jobData = (HierarchyJobData*) userData;
+    HierarchySystemState* state = jobData->state;
+    EntityContext* context = jobData->context;
+    EntityAPI* entityAPI = state->entityAPI;
+
+    for (u32 subtreeIndex = jobData->firstSubtree; subtreeIndex < jobData->firstSubtree + jobData->subtreeCount; ++subtreeIndex)
+    {
+        const HierarchySubtree* subtree = &state->subtrees[subtreeIndex];
+
+        TransformComponentData* rootTransform = (TransformComponentData*) entityAPI->GetComponentData(context, subtree->root, state->transformComponent);
+        WorldMatrixComponentData* rootWorldMatrix = (WorldMatrixComponentData*) entityAPI->GetComponentData(context, subtree->root, state->worldMatrixComponent);
+        const Matrix3x4* rootWorld = rootWorldMatrix ? &rootWorldMatrix->worldMatrix : &IdentityAffine;
+        bool rootDirty = jobData->forceUpdate || (rootTransform && rootTransform->dirty);
+
+        for (u32 nodeIndex = subtree->firstNode; nodeIndex < subtree->firstNode + subtree->nodeCount; ++nodeIndex)
+        {
+            const HierarchyNode* node = &state->nodes[nodeIndex];
+            TransformComponentData* transform = node->transform;
+            WorldMatrixComponentData* worldMatrix = node->worldMatrix;
+
+            bool parentDirty = rootDirty;
+            const Matrix3x4* parentWorld = rootWorld;
+            if (node->parentNodeIndex != NULL_INDEX)
+            {
+                parentDirty = state->nodeDirtyFlags[node->parentNodeIndex];
+                parentWorld = &state->nodes[node->parentNodeIndex].worldMatrix->worldMatrix;
+            }
+
+            // Static subtrees are skipped, their world matrices are still valid from the last update
+            bool dirty = parentDirty || transform->dirty;
+            state->nodeDirtyFlags[nodeIndex] = dirty;
+            if (dirty)
+            {
+                Matrix3x4 localMatrix = ComposeAffineTransform(transform->translation, transform->orientation, transform->scale);
+                worldMatrix->worldMatrix = (*parentWorld) * localMatrix;
+                transform->dirty = false;
+            }
+        }
+
+        if (rootTransform)
+        {
+            rootTransform->dirty = false;
+        }
+    }
+}
+
+static void HierarchySystemUpdate(EntityContext* context, EntitySystemUpdateSet* updateData, void* userData)
+{
+    HierarchySystemState* state = (HierarchySystemState*) userData;
+
+    // Adding, removing or moving rows also changes the parent column, so this catches every change that
+    // invalidates the nodes. Reparenting has to mark the parent component changed.
+    bool rebuild = false;
+    for (u32 arrayIndex = 0; arrayIndex < updateData->numArrays; ++arrayIndex)
+    {
+        if (updateData->arrays[arrayIndex].changedMask & BIT(0))
+        {
+            rebuild = true;
+            break;
+        }
+    }
+    // Roots don't have a parent column, destroying one doesn't change the column of its children
+    for (u32 subtreeIndex = 0; !rebuild && subtreeIndex < state->subtrees.length; ++subtreeIndex)
+    {
+        Entity root = state->subtrees[subtreeIndex].root;
+        rebuild = root.handle != INVALID_HANDLE && !state->entityAPI->IsEntityAlive(context, root);
+    }
+
+    bool forceUpdate = state->forceUpdate;
+    if (rebuild)
+    {
+        BuildHierarchy(state, context, updateData);
+        forceUpdate = true;
+    }
+    state->forceUpdate = false;
+
+    u32 subtreeCount = state->subtrees.length;
+    if (subtreeCount == 0)
+    {
+        return;
+    }
+
+    // Group subtrees into jobs, small hierarchies are updated on this thread
+    u32 maxJobCount = state->jobAPI->GetWorkerCount() * HIERARCHY_JOBS_PER_WORKER;
+    u32 nodesPerJob = (state->nodes.length + maxJobCount - 1) / maxJobCount;
+    if (nodesPerJob < HIERARCHY_NODES_PER_JOB)
+    {
+        nodesPerJob = HIERARCHY_NODES_PER_JOB;
+    }
+    // Every job but the last one has at least nodesPerJob nodes
+    u32 jobCapacity = state->nodes.length / nodesPerJob + 1;
+
+    ILinearAllocator* frameAllocator = state->frameAllocator;
+    HierarchyJobData* jobDatas = (HierarchyJobData*) frameAllocator->Alloc(frameAllocator->instance, sizeof(HierarchyJobData) * jobCapacity);
+    JobDecl* jobs = (JobDecl*) frameAllocator->Alloc(frameAllocator->instance, sizeof(JobDecl) * jobCapacity);
+    u32 jobCount = 0;
+    u32 jobNodeCount = 0;
+    for (u32 subtreeIndex = 0; subtreeIndex < subtreeCount; ++subtreeIndex)
+    {
+        if (jobNodeCount == 0)
+        {
+            HierarchyJobData* jobData = jobDatas + jobCount;
+            jobData->state = state;
+            jobData->context = context;
+            jobData->firstSubtree = subtreeIndex;
+            jobData->subtreeCount = 0;
+            jobData->forceUpdate = forceUpdate;
+            jobs[jobCount] = JobDecl { UpdateHierarchySubtrees, jobData };
+            jobCount++;
+        }
+
+        jobDatas[jobCount - 1].subtreeCount++;
+        jobNodeCount += state->subtrees[subtreeIndex].nodeCount;
+        if (jobNodeCount >= nodesPerJob)
+        {
+            jobNodeCount = 0;
+        }
+    }
+
+    if (jobCount == 1)
+    {
+        UpdateHierarchySubtrees(jobDatas);
+    }
+    else
+    {
+        JobCounter counter = {};
+        state->jobAPI->RunJobs(jobs, jobCount, &counter);
+        state->jobAPI->WaitForCounter(&counter);
+    }
+
+    // Changes are tracked per column, so only archetypes with an updated node are marked.
+    // Archetypes where every node is static keep their world matrix version.
+    u8* arrayDirtyFlags = (u8*) frameAllocator->Alloc(frameAllocator->instance, updateData->numArrays);
+    memset(arrayDirtyFlags, 0, updateData->numArrays);
+    for (u32 nodeIndex = 0; nodeIndex < state->nodes.length; ++nodeIndex)
+    {
+        if (state->nodeDirtyFlags[nodeIndex])
+        {
+            arrayDirtyFlags[state->nodes[nodeIndex].arrayIndex] = 1;
+        }
+    }
+
+    for (u32 arrayIndex = 0; arrayIndex < updateData->numArrays; ++arrayIndex)
+    {
+        if (arrayDirtyFlags[arrayIndex])
+        {
+            // Any entity of the archetype marks the whole column
+            state->entityAPI->MarkComponentChanged(context, updateData->arrays[arrayIndex].entities[0], state->worldMatrixComponent);
+        }
+    }
+}
+
+IEntitySystem CreateHierarchySystem(EntityAPI* entityAPI, EntityContext* context, APIRegistry* registry, ILinearAllocator* allocator, ILinearAllocator* frameAllocator)
+{
+    AllocatorAPI* allocatorAPI = (AllocatorAPI*) registry->Get(ALLOCATOR_API_NAME);
+
+    HierarchySystemState* state = (HierarchySystemState*) allocator->Alloc(allocator->instance, sizeof(HierarchySystemState));
+    state->entityAPI = entityAPI;
+    state->jobAPI = (JobAPI*) registry->Get(JOB_API_NAME);
+    state->frameAllocator = frameAllocator;
+    state->parentComponent = entityAPI->RegisterComponent(context, PARENT_COMPONENT_NAME, sizeof(ParentComponentData));
+    state->transformComponent = entityAPI->RegisterComponent(context, TRANSFORM_COMPONENT_NAME, sizeof(TransformComponentData));
+    state->worldMatrixComponent = entityAPI->RegisterComponent(context, WORLD_MATRIX_COMPONENT_NAME, sizeof(WorldMatrixComponentData));
+    state->nodes = CreateDynamicArray<HierarchyNode>(allocatorAPI);
+    state->subtrees = CreateDynamicArray<HierarchySubtree>(allocatorAPI);
+    state->nodeDirtyFlags = CreateDynamicArray<u8>(allocatorAPI);
+    state->nodeLookup = CreateDynamicArray<u32>(allocatorAPI);
+    state->forceUpdate = true;
+
+    IEntitySystem hierarchySystem = {};
+    hierarchySystem.components[0] = state->parentComponent;
+    hierarchySystem.components[1] = state->transformComponent;
+    hierarchySystem.components[2] = state->worldMatrixComponent;
+    hierarchySystem.numComponent = 3;
+    hierarchySystem.Update = HierarchySystemUpdate;
+    hierarchySystem.userData = (void*) state;
+
+    return hierarchySystem;
+}
+
+static void BoundsSystemUpdate(EntityContext* context, EntitySystemUpdateSet* updateData, void* userData)
+{
+    for (u32 arrayIndex = 0; arrayIndex < updateData->numArrays; ++arrayIndex)
+    {
+        EntitySystemUpdateArray* updateArray = updateData->arrays + arrayIndex;
+        const WorldMatrixComponentData* worldMatrices = (const WorldMatrixComponentData*) updateArray->componentData[0];
+        BoundsComponentData* bounds = (BoundsComponentData*) updateArray->componentData[1];
+
+        TransformAABBs(&bounds->localBounds, sizeof(BoundsComponentData), &worldMatrices->worldMatrix, sizeof(WorldMatrixComponentData),
+                       &bounds->worldBounds, sizeof(BoundsComponentData), updateArray->length);
+    }
+}
+
+IEntitySystem CreateBoundsSystem(EntityAPI* entityAPI, EntityContext* context)
+{
+    Component worldMatrixComponent = entityAPI->RegisterComponent(context, WORLD_MATRIX_COMPONENT_NAME, sizeof(WorldMatrixComponentData));
+    Component boundsComponent = entityAPI->RegisterComponent(context, BOUNDS_COMPONENT_NAME, sizeof(BoundsComponentData));
+
+    IEntitySystem boundsSystem = {};
+    boundsSystem.components[0] = worldMatrixComponent;
+    boundsSystem.components[1] = boundsComponent;
+    boundsSystem.numComponent = 2;
+    boundsSystem.changedFilterMask = BIT(0);
+    boundsSystem.writeMask = BIT(1);
+    boundsSystem.Update = BoundsSystemUpdate;
+    boundsSystem.userData = nullptr;
+
+    return boundsSystem;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+struct EntityAPI;
+struct EntityContext;
+struct IEntitySystem;
+struct APIRegistry;
+struct ILinearAllocator;
+
+// Computes WorldMatrixComponent from TransformComponent for every entity that has both.
+// Only archetypes with changed transforms are updated. Push it before any system that reads world matrices.
+IEntitySystem CreateTransformSystem(EntityAPI* entityAPI, EntityContext* context);
+
+// Computes WorldMatrixComponent of entities with a ParentComponent from their parent's world matrix.
+// Nodes are sorted by depth so parents are always updated first. Subtrees without dirty transforms are skipped.
+// Mark ParentComponent changed after reparenting. Push it after the transform system. Job data is allocated from frameAllocator, which the caller clears every frame.
+IEntitySystem CreateHierarchySystem(EntityAPI* entityAPI, EntityContext* context, APIRegistry* registry, ILinearAllocator* allocator, ILinearAllocator* frameAllocator);
+
+// Computes world space bounds of BoundsComponent from WorldMatrixComponent. Push it after the hierarchy system.
+IEntitySystem CreateBoundsSystem(EntityAPI* entityAPI, EntityContext* context);